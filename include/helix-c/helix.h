@@ -24,6 +24,18 @@ typedef enum {
     HELIX_ERROR_TRUNCATED_PACKET = -2,
     /*! An unknown error occurred. */
     HELIX_ERROR_UNKNOWN = -3,
+    /*! A checkpoint could not be read or written. */
+    HELIX_ERROR_CHECKPOINT = -4,
+    /*! An index could not be read or written, or does not match its input. */
+    HELIX_ERROR_INDEX = -5,
+    /*! A file could not be read. */
+    HELIX_ERROR_IO = -6,
+    /*! A capture file is not a valid pcap, pcapng or Helix capture file. */
+    HELIX_ERROR_CAPTURE = -7,
+    /*! A sizing hints file could not be read or written. */
+    HELIX_ERROR_SIZING_HINTS = -8,
+    /*! A symbol does not fit the symbol field of the protocol. */
+    HELIX_ERROR_SYMBOL = -9,
 } helix_result_t;
 
 /*!
@@ -86,6 +98,42 @@ typedef struct helix_opaque_trade *helix_trade_t;
  */
 typedef struct helix_opaque_event *helix_event_t;
 
+/*!
+ * @typedef  helix_channel_t
+ * @abstract Type of an event channel.
+ */
+typedef struct helix_opaque_channel *helix_channel_t;
+
+/*!
+ * @typedef  helix_index_writer_t
+ * @abstract Type of a replay index writer.
+ */
+typedef struct helix_opaque_index_writer *helix_index_writer_t;
+
+/*!
+ * @typedef  helix_capture_t
+ * @abstract Writer of a Helix capture file.
+ */
+typedef struct helix_opaque_capture *helix_capture_t;
+
+/*!
+ * @typedef  helix_column_writer_t
+ * @abstract Writer of a columnar binary file.
+ */
+typedef struct helix_opaque_column_writer *helix_column_writer_t;
+
+/*!
+ * @typedef  helix_batch_t
+ * @abstract Batch replay of many files.
+ */
+typedef struct helix_opaque_batch *helix_batch_t;
+
+/*!
+ * @typedef  helix_sizing_hints_t
+ * @abstract Order book sizing hints that sessions share.
+ */
+typedef struct helix_opaque_sizing_hints *helix_sizing_hints_t;
+
 /*!
  * @enum     helix_event_mask_t
  * @abstract Event mask.
@@ -147,6 +195,13 @@ typedef void (*helix_event_callback_t)(helix_session_t, helix_event_t);
  */
 typedef void (*helix_send_callback_t)(helix_session_t, char*, size_t);
 
+/*!
+ * @typedef  helix_batch_session_callback_t
+ * @abstract Type of a callback that creates the session that replays file
+ * @index of a batch. Returns NULL on failure.
+ */
+typedef helix_session_t (*helix_batch_session_callback_t)(helix_protocol_t, size_t index, const char *filename, void *data);
+
 /*!
  * @enum     helix_trading_state_t
  * @abstract Order book instrument trading state.
@@ -181,6 +236,159 @@ typedef enum {
     HELIX_TRADE_SIGN_NON_DISPLAYABLE,
 } helix_trade_sign_t;
 
+/*!
+ * @enum     helix_backpressure_t
+ * @abstract What an event channel publisher does when the channel is full.
+ */
+typedef enum {
+    /*! Wait for consumers to make room. */
+    HELIX_BACKPRESSURE_BLOCK,
+    /*! Discard the oldest record in the channel. */
+    HELIX_BACKPRESSURE_DROP_OLDEST,
+    /*! Keep only the latest record of every symbol in the channel. */
+    HELIX_BACKPRESSURE_CONFLATE,
+} helix_backpressure_t;
+
+/*!
+ * @enum     helix_read_mode_t
+ * @abstract How a historical market data file is read.
+ */
+typedef enum {
+    /*! Map a window of the file that slides over it. */
+    HELIX_READ_MMAP,
+    /*! Read with pread() on a reader thread into two buffers. */
+    HELIX_READ_PREAD,
+    /*! Read with reads queued in an io_uring, on Linux 5.6 or later. */
+    HELIX_READ_IO_URING,
+} helix_read_mode_t;
+
+/*!
+ * @enum     helix_pacing_clock_t
+ * @abstract Clock that a paced replay busy-waits on.
+ */
+typedef enum {
+    /*! The monotonic clock of the operating system. */
+    HELIX_PACING_CLOCK_MONOTONIC,
+    /*! The time-stamp counter of the CPU, on x86 only. */
+    HELIX_PACING_CLOCK_TSC,
+} helix_pacing_clock_t;
+
+/*!
+ * @struct   helix_event_record_t
+ * @abstract Event record that is passed to consumer threads over a channel.
+ */
+typedef struct {
+    /*! Symbol identifier returned by helix_channel_add_symbol(). */
+    uint32_t symbol_id;
+    /*! Event mask. */
+    uint32_t mask;
+    /*! Timestamp of the event. */
+    helix_timestamp_t timestamp;
+    /*! Best bid price, if HELIX_EVENT_ORDER_BOOK_UPDATE bit is set. */
+    helix_price_t bid_price;
+    /*! Best bid size, if HELIX_EVENT_ORDER_BOOK_UPDATE bit is set. */
+    uint64_t bid_size;
+    /*! Best ask price, if HELIX_EVENT_ORDER_BOOK_UPDATE bit is set. */
+    helix_price_t ask_price;
+    /*! Best ask size, if HELIX_EVENT_ORDER_BOOK_UPDATE bit is set. */
+    uint64_t ask_size;
+    /*! Trade price, if HELIX_EVENT_TRADE bit is set. */
+    helix_price_t trade_price;
+    /*! Trade size, if HELIX_EVENT_TRADE bit is set. */
+    uint64_t trade_size;
+    /*! Trade sign, if HELIX_EVENT_TRADE bit is set. */
+    uint32_t trade_sign;
+} helix_event_record_t;
+
+/*!
+ * @struct   helix_retransmit_stats_t
+ * @abstract Retransmission request and response counters of a session.
+ */
+typedef struct {
+    /*! Number of retransmission requests sent. */
+    uint64_t requests;
+    /*! Number of messages requested. */
+    uint64_t requested_messages;
+    /*! Number of received packets that carried requested messages. */
+    uint64_t responses;
+    /*! Number of requested messages received. */
+    uint64_t recovered_messages;
+} helix_retransmit_stats_t;
+
+/*!
+ * @struct   helix_line_stats_t
+ * @abstract Packet counters of a feed line.
+ */
+typedef struct {
+    /*! Number of packets received on the line. */
+    uint64_t packets;
+    /*! Number of packets that arrived on the line first and were processed. */
+    uint64_t forwarded;
+    /*! Number of packets that arrived after their copy on another line. */
+    uint64_t duplicates;
+    /*! Number of messages that the line skipped over. */
+    uint64_t lost_messages;
+    /*! Total time by which packets on the line led their copies, in nanoseconds. */
+    uint64_t lead_ns;
+    /*! Total time by which packets on the line lagged their copies, in nanoseconds. */
+    uint64_t lag_ns;
+    /*! Maximum time by which a packet on the line lagged its copy, in nanoseconds. */
+    uint64_t max_lag_ns;
+} helix_line_stats_t;
+
+/*!
+ * @struct   helix_pacing_stats_t
+ * @abstract Release counters and timing error of a paced replay.
+ */
+typedef struct {
+    /*! Number of paced messages or packets. */
+    uint64_t releases;
+    /*! Number of releases whose time had passed before they were reached. */
+    uint64_t late;
+    /*! Median time by which releases missed their time, in nanoseconds. */
+    uint64_t p50_ns;
+    /*! 90th percentile of the release error, in nanoseconds. */
+    uint64_t p90_ns;
+    /*! 99th percentile of the release error, in nanoseconds. */
+    uint64_t p99_ns;
+    /*! 99.9th percentile of the release error, in nanoseconds. */
+    uint64_t p999_ns;
+    /*! Maximum release error, in nanoseconds. */
+    uint64_t max_ns;
+} helix_pacing_stats_t;
+
+/*!
+ * @struct   helix_column_t
+ * @abstract Column of a columnar binary file.
+ */
+typedef struct {
+    /*! Name of the column, at most 16 characters. */
+    const char *name;
+    /*! Width of a value in bytes: 1, 2, 4 or 8. */
+    uint32_t width;
+    /*! Divisor that converts a value to its real value, or 1. */
+    uint32_t scale;
+} helix_column_t;
+
+/*!
+ * @struct   helix_batch_file_stats_t
+ * @abstract Outcome of the replay of a file of a batch.
+ */
+typedef struct {
+    /*! Size of the file on disk in bytes. */
+    uint64_t size;
+    /*! Number of bytes replayed, after decompression. */
+    uint64_t bytes;
+    /*! Time that the replay took, in nanoseconds. */
+    uint64_t duration_ns;
+    /*! Worker thread that replayed the file. */
+    size_t worker;
+    /*! True if the worker stole the file from another worker. */
+    bool stolen;
+    /*! Zero if the file was replayed, a negative error code otherwise. */
+    int error;
+} helix_batch_file_stats_t;
+
 /*!
  * @abstract Returns the order book trading state.
  * @param    ob  Order book.
@@ -267,6 +475,27 @@ void helix_protocol_destroy(helix_protocol_t proto);
  */
 helix_session_t helix_session_create(helix_protocol_t, helix_event_callback_t, void *data);
 
+/*!
+ * Create a new session that processes messages on multiple threads.
+ *
+ * Messages are sharded by symbol to @nr_threads worker threads, each of which
+ * owns a disjoint set of order books. The event callback is invoked from the
+ * worker threads concurrently, but events of one symbol are always delivered
+ * in feed order. Returns NULL if the protocol does not support parallel
+ * sessions.
+ */
+helix_session_t helix_session_create_parallel(helix_protocol_t, helix_event_callback_t, void *data, size_t nr_threads);
+
+/*!
+ * Create a new session that arbitrates between redundant feed lines.
+ *
+ * Packets are passed to the session with helix_session_process_line_packet()
+ * tagged with the line they were received on. The first copy of every packet
+ * is processed and later copies are dropped. Returns NULL if the protocol
+ * does not support line arbitration.
+ */
+helix_session_t helix_session_create_arbitrated(helix_protocol_t, helix_event_callback_t, void *data);
+
 /*!
  * Destroy a session object.
  */
@@ -274,8 +503,322 @@ void helix_session_destroy(helix_session_t session);
 
 /*!
  * @abstract Sets the session send callback.
+ *
+ * Returns zero, or an error code if the session cannot request
+ * retransmissions, which parallel sessions cannot.
+ */
+int helix_session_set_send_callback(helix_session_t, helix_send_callback_t);
+
+/*!
+ * @abstract Configure retransmission request pacing of a session.
+ *
+ * A requested range is requested again if no response arrives within
+ * @timeout_us microseconds. The timeout doubles on every attempt up to
+ * @max_timeout_us. Gaps that are at most @coalesce_distance messages apart
+ * are requested as one range.
+ */
+void helix_session_set_retransmit_config(helix_session_t, uint64_t timeout_us, uint64_t max_timeout_us, uint64_t coalesce_distance);
+
+/*!
+ * @abstract Returns retransmission request and response counters of a session.
+ */
+helix_retransmit_stats_t helix_session_retransmit_stats(helix_session_t);
+
+/*!
+ * @abstract Request the missing messages whose retransmission timeout has
+ * expired.
+ *
+ * A session checks its timeouts when a packet arrives. Call this
+ * periodically, at about the retransmission timeout, so that a lost
+ * response is requested again while the feed is quiet. Returns zero on
+ * success and a negative error code on failure.
+ */
+int helix_session_poll_retransmit(helix_session_t);
+
+/*!
+ * @abstract Pace the replay of historical data by message timestamps.
+ *
+ * Messages are held back until as much time, divided by @speed, has passed
+ * since the first message as had passed in the market. A @speed of zero
+ * disables pacing. The session busy-waits on @clock for the last part of
+ * every wait. If @per_packet is true, only the first message of every
+ * packet is paced. Returns zero on success and a negative error code on
+ * failure.
  */
-void helix_session_set_send_callback(helix_session_t, helix_send_callback_t);
+int helix_session_set_pacing(helix_session_t, double speed, helix_pacing_clock_t clock, bool per_packet);
+
+/*!
+ * @abstract Returns release counters and timing error of a paced replay.
+ */
+helix_pacing_stats_t helix_session_pacing_stats(helix_session_t);
+
+/*!
+ * @abstract Returns the position in the feed up to which a session has
+ * processed messages.
+ *
+ * The position is the next expected sequence number for MoldUDP sessions
+ * and the byte offset in the file for file sessions.
+ */
+uint64_t helix_session_position(helix_session_t);
+
+/*!
+ * @abstract Write the order books and the position of a session to a
+ * checkpoint file.
+ *
+ * Returns zero on success and a negative error code on failure.
+ */
+int helix_session_save_checkpoint(helix_session_t, const char *filename);
+
+/*!
+ * @abstract Restore the order books and the position of a session from a
+ * checkpoint file.
+ *
+ * Symbols are subscribed to before the checkpoint is loaded. A MoldUDP
+ * session then drops messages that are already applied to the order books
+ * and requests the messages it has missed since the checkpoint; the input
+ * of a file session has to continue from helix_session_position(). Returns
+ * zero on success and a negative error code on failure.
+ */
+int helix_session_load_checkpoint(helix_session_t, const char *filename);
+
+/*!
+ * @abstract Restore a session from the latest checkpoint in a replay index
+ * at or before @timestamp.
+ *
+ * The input of the session continues from helix_session_position(). If the
+ * index has no checkpoint before @timestamp, the session is left untouched
+ * and the input is replayed from the start. Messages between the checkpoint
+ * and @timestamp are replayed as usual. Returns zero on success and a
+ * negative error code on failure.
+ */
+int helix_session_seek(helix_session_t, const char *index_filename, helix_timestamp_t timestamp);
+
+/*!
+ * @abstract Create a replay index writer.
+ *
+ * A replay index holds checkpoints of a session at points of market time of
+ * a historical market data file. Returns NULL on failure.
+ */
+helix_index_writer_t helix_index_writer_create(const char *filename);
+
+/*!
+ * @abstract Add a checkpoint of a session to a replay index.
+ *
+ * The @timestamp is the market time of the last message that the session
+ * has processed. Returns zero on success and a negative error code on
+ * failure.
+ */
+int helix_index_writer_add(helix_index_writer_t, helix_session_t, helix_timestamp_t timestamp);
+
+/*!
+ * @abstract Finish a replay index and destroy the writer.
+ *
+ * Returns zero on success and a negative error code on failure.
+ */
+int helix_index_writer_close(helix_index_writer_t);
+
+/*!
+ * @abstract Build a per-symbol message index of a NASDAQ TotalView-ITCH 5.0
+ * BinaryFILE.
+ *
+ * The index records the frames of the messages of every stock in the file
+ * in @buf, so that the messages of a few symbols can be replayed without
+ * reading the rest of the file. Returns zero on success and a negative
+ * error code on failure.
+ */
+int helix_symbol_index_build(const char *index_filename, const char *buf, size_t len);
+
+/*!
+ * @abstract Replay only the messages of @symbols from a NASDAQ
+ * TotalView-ITCH 5.0 BinaryFILE through a session.
+ *
+ * The file in @buf must be the one the index was built from, and should be
+ * memory-mapped so that only the pages that hold the messages are read.
+ * The session must be a nasdaq-binaryfile-itch50 session. Returns zero on
+ * success and a negative error code on failure, which is HELIX_ERROR_INDEX
+ * if one of @symbols is not in the index.
+ */
+int helix_session_replay_symbols(helix_session_t, const char *index_filename, const char *const *symbols, size_t nr_symbols, const char *buf, size_t len);
+
+/*!
+ * @abstract Measure the peak order book sizes of every stock of a NASDAQ
+ * TotalView-ITCH 5.0 BinaryFILE and write them to a sizing hints file.
+ *
+ * The file in @buf is scanned once, simulating the live orders and price
+ * levels of every stock without building order books. Returns zero on
+ * success and a negative error code on failure.
+ */
+int helix_sizing_hints_build(const char *hints_filename, const char *buf, size_t len);
+
+/*!
+ * @abstract Size the order books of a session by a sizing hints file.
+ *
+ * Symbols that are subscribed to afterwards get order books sized for the
+ * peak number of orders in the hints, or for the number of orders they are
+ * subscribed with if it is larger or there is no hint. Returns zero on
+ * success and a negative error code on failure.
+ */
+int helix_session_load_sizing_hints(helix_session_t, const char *filename);
+
+/*!
+ * @abstract Read a sizing hints file once for many sessions.
+ *
+ * Stores the hints in @hints and returns zero on success, and returns a
+ * negative error code on failure.
+ */
+int helix_sizing_hints_load(const char *filename, helix_sizing_hints_t *hints);
+
+/*!
+ * @abstract Free sizing hints. Sessions that use them keep their own reference.
+ */
+void helix_sizing_hints_destroy(helix_sizing_hints_t);
+
+/*!
+ * @abstract Size the order books of a session by hints read with
+ * helix_sizing_hints_load(), like helix_session_load_sizing_hints() does.
+ */
+void helix_session_set_sizing_hints(helix_session_t, helix_sizing_hints_t);
+
+/*!
+ * @abstract Replay a historical market data file through a session.
+ *
+ * The file is streamed from @offset onwards through a window of
+ * @window_size bytes, or a default window if @window_size is zero, so that
+ * files larger than memory are replayed without mapping them whole. The
+ * session must be a file session. Returns zero on success and a negative
+ * error code on failure.
+ */
+int helix_session_replay_file(helix_session_t, const char *filename, helix_read_mode_t mode, size_t window_size, uint64_t offset);
+
+/*!
+ * @abstract Returns true if a file is compressed with gzip or zstd.
+ *
+ * Compression is detected from the contents of the file, the same way
+ * helix_session_replay_file() detects it. Returns false if the file cannot
+ * be read.
+ */
+bool helix_file_is_compressed(const char *filename);
+
+/*!
+ * @abstract Replay the UDP datagrams of a pcap or pcapng capture through a
+ * MoldUDP or MoldUDP64 session.
+ *
+ * Only datagrams sent to multicast group @addr and port @port are replayed;
+ * a NULL @addr or a zero @port matches any. Datagrams are replayed in
+ * capture order, at the pace they were captured if @honor_timestamps is
+ * true and as fast as possible otherwise. Returns zero on success and a
+ * negative error code on failure.
+ */
+int helix_session_replay_pcap(helix_session_t, const char *filename, const char *addr, int port, bool honor_timestamps);
+
+/*!
+ * @abstract Replay the packets of a Helix capture through a session.
+ *
+ * Packets are replayed in the order they were recorded, on the feed lines
+ * they were received on, at the pace they were received if
+ * @honor_timestamps is true and as fast as possible otherwise. Returns zero
+ * on success and a negative error code on failure.
+ */
+int helix_session_replay_capture(helix_session_t, const char *filename, bool honor_timestamps);
+
+/*!
+ * @abstract Open a Helix capture file for recording received packets.
+ *
+ * Packets are appended to the file, which is created if it does not exist.
+ * They are written out by a thread of the capture, so recording a packet
+ * never blocks. Returns NULL on failure.
+ */
+helix_capture_t helix_capture_open(const char *filename);
+
+/*!
+ * @abstract Record a packet received on feed line @line at @timestamp, in
+ * nanoseconds since the epoch.
+ */
+void helix_capture_record(helix_capture_t, helix_timestamp_t timestamp, size_t line, const char *buf, size_t len);
+
+/*!
+ * @abstract Returns the number of packets dropped because the capture could
+ * not write them out fast enough.
+ */
+uint64_t helix_capture_dropped(helix_capture_t);
+
+/*!
+ * @abstract Write out the recorded packets and destroy the capture.
+ *
+ * Returns zero on success and a negative error code on failure.
+ */
+int helix_capture_close(helix_capture_t);
+
+/*!
+ * @abstract Create a columnar binary file writer.
+ *
+ * Rows of fixed-width unsigned integers are stored column by column in
+ * blocks, which are written out by a thread of the writer. Returns NULL on
+ * failure.
+ */
+helix_column_writer_t helix_column_writer_create(const char *filename, const helix_column_t *columns, size_t nr_columns);
+
+/*!
+ * @abstract Returns the id of a string, such as a symbol, interning it if it
+ * is new. The strings are stored in the file.
+ */
+uint32_t helix_column_writer_intern(helix_column_writer_t, const char *s);
+
+/*!
+ * @abstract Append a row with one value per column.
+ */
+void helix_column_writer_append(helix_column_writer_t, const uint64_t *values);
+
+/*!
+ * @abstract Write out the appended rows and destroy the writer.
+ *
+ * Returns zero on success and a negative error code on failure.
+ */
+int helix_column_writer_close(helix_column_writer_t);
+
+/*!
+ * @abstract Create a batch replay of many files.
+ *
+ * Files are replayed on @nr_threads worker threads, or one per core if it
+ * is zero, with at most @max_sessions sessions alive at a time, or one per
+ * worker if it is zero. Returns NULL on failure.
+ */
+helix_batch_t helix_batch_create(size_t nr_threads, size_t max_sessions, helix_read_mode_t mode);
+
+/*!
+ * @abstract Add a file, which may be compressed, to be replayed with
+ * protocol @proto. Returns zero on success and a negative error code on
+ * failure.
+ */
+int helix_batch_add(helix_batch_t, helix_protocol_t proto, const char *filename);
+
+/*!
+ * @abstract Replay every file of a batch and wait for them.
+ *
+ * Every file is replayed from start to end by a session of its own, which
+ * @callback creates on the worker thread that replays the file, and which
+ * is destroyed once the file is replayed. Events of different files are
+ * delivered concurrently. The largest files are started first, and idle
+ * workers steal files from busy ones. Returns the number of files that
+ * failed.
+ */
+size_t helix_batch_run(helix_batch_t, helix_batch_session_callback_t callback, void *data);
+
+/*!
+ * @abstract Returns the outcome of the replay of file @index of a batch, in
+ * the order the files were added.
+ */
+helix_batch_file_stats_t helix_batch_file_stats(helix_batch_t, size_t index);
+
+/*!
+ * @abstract Returns the number of worker threads of a batch.
+ */
+size_t helix_batch_nr_workers(helix_batch_t);
+
+/*!
+ * @abstract Destroy a batch.
+ */
+void helix_batch_destroy(helix_batch_t);
 
 /*!
  * @abstract Returns session opaque context data.
@@ -294,16 +837,110 @@ bool helix_session_is_rth_timestamp(helix_session_t, helix_timestamp_t);
  */
 int helix_session_process_packet(helix_session_t, const char* buf, size_t len);
 
+/*!
+ * @abstract Finish processing the input of a session.
+ *
+ * Waits until every packet that was passed to the session is processed. A
+ * parallel session processes packets on worker threads and reports an
+ * error of a worker only here or on a later packet, so call this at the end
+ * of the input, before the results of the session are read. No packets may
+ * be processed afterwards. Returns zero on success and a negative error
+ * code on failure.
+ */
+int helix_session_finish(helix_session_t);
+
+/*!
+ * @abstract Process a packet received on a feed line for a session.
+ *
+ * Lines are numbered from zero. Sessions that do not arbitrate between lines
+ * process packets from every line.
+ */
+int helix_session_process_line_packet(helix_session_t, size_t line, const char* buf, size_t len);
+
+/*!
+ * @abstract Returns packet counters of a feed line of a session.
+ */
+helix_line_stats_t helix_session_line_stats(helix_session_t, size_t line);
+
 /*!
  * @abstract Subscribe to listening to market data updates for a symbol.
+ *
+ * Returns zero on success and a negative error code on failure, which is
+ * HELIX_ERROR_SYMBOL if the symbol is too long for the protocol.
  */
-void helix_session_subscribe(helix_session_t, const char *symbol, size_t max_orders);
+int helix_session_subscribe(helix_session_t, const char *symbol, size_t max_orders);
 
 /*!
  * @abstract Unsubscribe a subscription from session.
  */
 void helix_session_unsubscribe(helix_subscription_t);
 
+/*!
+ * @abstract Create an event channel.
+ *
+ * An event channel carries events from the event callbacks of sessions to
+ * consumer threads, every one of which sees every record. The @capacity is
+ * the number of records in the channel and must be a power of two. Returns
+ * NULL on failure.
+ */
+helix_channel_t helix_channel_create(size_t capacity, helix_backpressure_t policy);
+
+/*!
+ * @abstract Destroy an event channel.
+ */
+void helix_channel_destroy(helix_channel_t);
+
+/*!
+ * @abstract Register a symbol with a channel and return its identifier.
+ *
+ * Symbols must be registered before anything is published to the channel.
+ */
+uint32_t helix_channel_add_symbol(helix_channel_t, const char *symbol);
+
+/*!
+ * @abstract Returns the symbol for a symbol identifier.
+ */
+const char *helix_channel_symbol(helix_channel_t, uint32_t symbol_id);
+
+/*!
+ * @abstract Publish an event to a channel.
+ *
+ * This function is called from an event callback. Returns false if the
+ * symbol of the event is not registered with the channel.
+ */
+bool helix_channel_publish(helix_channel_t, helix_event_t);
+
+/*!
+ * @abstract Add a consumer to a channel and return its index.
+ *
+ * Consumers must be added before anything is published to the channel.
+ */
+size_t helix_channel_add_consumer(helix_channel_t);
+
+/*!
+ * @abstract Consume records from a channel at the cursor of a consumer.
+ *
+ * Returns the number of records copied to @records, which is at most
+ * @max_count.
+ */
+size_t helix_channel_consume(helix_channel_t, size_t consumer, helix_event_record_t *records, size_t max_count);
+
+/*!
+ * @abstract Mark a channel closed.
+ */
+void helix_channel_close(helix_channel_t);
+
+/*!
+ * @abstract Returns true if a channel is closed.
+ */
+bool helix_channel_is_closed(helix_channel_t);
+
+/*!
+ * @abstract Returns the number of records that a consumer missed because
+ * they were dropped or conflated.
+ */
+uint64_t helix_channel_dropped(helix_channel_t, size_t consumer);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "helix/file_reader.hh"
+#include "helix/helix.hh"
+
+#include <exception>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace helix {
+
+//! File of a batch and the protocol that it is replayed with.
+struct batch_file {
+    std::string filename;
+    protocol* proto;
+};
+
+//! Outcome of the replay of a file of a batch.
+struct batch_file_stats {
+    //! Size of the file on disk in bytes, which orders the files.
+    uint64_t size = 0;
+    //! Number of bytes replayed, after decompression.
+    uint64_t bytes = 0;
+    //! Time that the replay took, in nanoseconds.
+    uint64_t duration_ns = 0;
+    //! Worker thread that replayed the file.
+    size_t worker = 0;
+    //! True if the worker stole the file from the queue of another worker.
+    bool stolen = false;
+    //! Exception that the replay failed with, if any.
+    std::exception_ptr error;
+};
+
+//! Counters of a batch, merged from its files.
+struct batch_stats {
+    uint64_t files = 0;
+    uint64_t failed = 0;
+    uint64_t bytes = 0;
+    uint64_t steals = 0;
+    //! Time from the start of the first replay to the end of the last, in nanoseconds.
+    uint64_t duration_ns = 0;
+};
+
+//! Configuration of a batch runner.
+struct batch_config {
+    //! Number of worker threads, or zero for one per core.
+    size_t nr_threads = 0;
+    //! Largest number of sessions alive at a time, or zero for one per
+    //! worker thread. Every session holds its order books and a read window
+    //! of its file, so this bounds the memory that a batch uses.
+    size_t max_sessions = 0;
+    read_mode mode = read_mode::mmap;
+    size_t window_size = file_reader_window_size;
+};
+
+// Batch replay of many files on a work-stealing pool.
+//
+// Every file is replayed from start to end by a session of its own, which
+// the caller creates for it, so files are independent of each other and
+// their events are delivered on the worker threads concurrently. Files are
+// dealt to the queues of the workers largest first. A worker replays the
+// files of its own queue in order, and once its queue is empty, it steals
+// the largest file that is left in the queues of the others, so that a
+// large file is never left to start last.
+//
+// A worker holds one session at a time, and there are no more workers than
+// sessions that may be alive at a time.
+class batch_runner {
+public:
+    //! Creates the session that replays file @index of the batch, subscribed
+    //! to the symbols it needs. Called on the worker thread that replays the
+    //! file; the session is destroyed once the file is replayed.
+    using session_factory = std::function<std::unique_ptr<session>(size_t index, const batch_file& file)>;
+
+private:
+    batch_config _config;
+    std::vector<batch_file> _files;
+    std::vector<batch_file_stats> _file_stats;
+    batch_stats _stats;
+public:
+    explicit batch_runner(const batch_config& config = batch_config{});
+
+    void add(const batch_file& file);
+
+    //! Replay every file of the batch and wait for them.
+    //
+    // A file whose replay fails has its exception recorded in its
+    // statistics and does not stop the other files.
+    void run(session_factory factory);
+
+    size_t nr_workers() const;
+
+    const std::vector<batch_file>& files() const {
+        return _files;
+    }
+
+    const batch_file_stats& file_stats(size_t index) const {
+        return _file_stats.at(index);
+    }
+
+    const batch_stats& stats() const {
+        return _stats;
+    }
+};
+
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "helix/spsc_ring.hh"
+
+#include <type_traits>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace helix {
+
+// Bounded lock-free ring buffer that delivers every value to every consumer.
+//
+// Producers claim slots with a CAS on a shared cursor, and every consumer
+// reads the ring at a cursor of its own, which lives on its own cache line.
+// A producer makes the sequence number of a slot odd while it writes the
+// value and even when it is done, so that a consumer can tell whether the
+// slot holds the value at its cursor, and check after copying the value that
+// it was not overwritten in the meantime. Values are stored as atomic words
+// to make those concurrent copies well-defined.
+//
+// Producers either wait for the slowest consumer to make room with
+// try_publish(), or overwrite the oldest values with publish_overwrite(), in
+// which case a consumer that falls a lap behind skips to the oldest value in
+// the ring and counts the values it missed. Both sides work in batches.
+template<typename T>
+class broadcast_ring {
+    static_assert(std::is_trivially_copyable<T>::value, "ring values must be trivially copyable");
+
+    static constexpr size_t nr_words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    struct slot {
+        //! 2 * position + 1 while the value of a position is written,
+        //! 2 * position + 2 when it is ready.
+        std::atomic<size_t> seq;
+        std::atomic<uint64_t> words[nr_words];
+    };
+    struct consumer {
+        char _pad0[cache_line_size];
+        //! Position of the next value to consume.
+        std::atomic<size_t> pos;
+        //! Number of values that were overwritten before they were consumed.
+        std::atomic<uint64_t> missed{0};
+        char _pad1[cache_line_size];
+
+        explicit consumer(size_t pos)
+            : pos{pos}
+        { }
+    };
+    std::unique_ptr<slot[]> _slots;
+    size_t _mask;
+    std::vector<std::unique_ptr<consumer>> _consumers;
+    char _pad0[cache_line_size];
+    //! Position of the next slot to claim. Positions start at the capacity,
+    //! so that the slots look like they hold the values of a previous lap.
+    std::atomic<size_t> _claim_pos;
+    //! Producers' copy of the position of the slowest consumer.
+    std::atomic<size_t> _cached_min_pos;
+    char _pad1[cache_line_size];
+public:
+    explicit broadcast_ring(size_t capacity)
+        : _slots{new slot[capacity]}
+        , _mask{capacity - 1}
+        , _claim_pos{capacity}
+        , _cached_min_pos{capacity}
+    {
+        if (!capacity || (capacity & _mask)) {
+            throw std::invalid_argument("ring capacity must be a power of two");
+        }
+        for (size_t i = 0; i < capacity; i++) {
+            _slots[i].seq.store(2 * i + 2, std::memory_order_relaxed);
+            for (auto&& w : _slots[i].words) {
+                w.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t capacity() const {
+        return _mask + 1;
+    }
+
+    //! Add a consumer and return its index. Consumers are added before
+    //! anything is published.
+    size_t add_consumer() {
+        _consumers.emplace_back(new consumer{_claim_pos.load(std::memory_order_relaxed)});
+        return _consumers.size() - 1;
+    }
+
+    size_t nr_consumers() const {
+        return _consumers.size();
+    }
+
+    //! Publish up to @count values without overwriting values that a
+    //! consumer has yet to consume, returns the number of values published.
+    size_t try_publish(const T* values, size_t count) {
+        if (!count) {
+            return 0;
+        }
+        size_t pos = _claim_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t limit = _cached_min_pos.load(std::memory_order_relaxed) + capacity();
+            if (pos + count > limit) {
+                size_t min_pos = slowest_consumer(pos);
+                _cached_min_pos.store(min_pos, std::memory_order_relaxed);
+                limit = min_pos + capacity();
+                if (pos >= limit) {
+                    // The ring is full.
+                    return 0;
+                }
+            }
+            size_t n = std::min(count, limit - pos);
+            if (_claim_pos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+                write(pos, values, n);
+                return n;
+            }
+        }
+    }
+
+    //! Publish @count values, overwriting the oldest values in the ring.
+    void publish_overwrite(const T* values, size_t count) {
+        size_t pos = _claim_pos.fetch_add(count, std::memory_order_relaxed);
+        write(pos, values, count);
+    }
+
+    //! Consume up to @max_count values at the cursor of @consumer_idx,
+    //! returns the number of values consumed.
+    size_t consume(size_t consumer_idx, T* values, size_t max_count) {
+        auto& c = *_consumers.at(consumer_idx);
+        size_t pos = c.pos.load(std::memory_order_relaxed);
+        size_t n = 0;
+        while (n < max_count) {
+            auto& s = _slots[pos & _mask];
+            size_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq == 2 * pos + 2) {
+                uint64_t buf[nr_words];
+                for (size_t i = 0; i < nr_words; i++) {
+                    buf[i] = s.words[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s.seq.load(std::memory_order_relaxed) == seq) {
+                    std::memcpy(&values[n++], buf, sizeof(T));
+                    pos++;
+                    continue;
+                }
+            } else if (intptr_t(seq - (2 * pos + 2)) < 0) {
+                // The value is not published yet.
+                break;
+            }
+            // The value was overwritten, so skip to the oldest value in the ring.
+            size_t oldest = std::max(pos + 1, _claim_pos.load(std::memory_order_relaxed) - capacity());
+            c.missed.fetch_add(oldest - pos, std::memory_order_relaxed);
+            pos = oldest;
+        }
+        c.pos.store(pos, std::memory_order_release);
+        return n;
+    }
+
+    //! Number of values that @consumer_idx missed because they were overwritten.
+    uint64_t missed(size_t consumer_idx) const {
+        return _consumers.at(consumer_idx)->missed.load(std::memory_order_relaxed);
+    }
+private:
+    size_t slowest_consumer(size_t pos) const {
+        for (auto&& c : _consumers) {
+            pos = std::min(pos, c->pos.load(std::memory_order_acquire));
+        }
+        return pos;
+    }
+
+    void write(size_t pos, const T* values, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            auto& s = _slots[(pos + i) & _mask];
+            // Wait for the producer of the previous lap to finish with the slot.
+            size_t prev = 2 * (pos + i - capacity()) + 2;
+            while (s.seq.load(std::memory_order_acquire) != prev) {
+                std::this_thread::yield();
+            }
+            s.seq.store(prev + 2 * capacity() - 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            uint64_t buf[nr_words] = {};
+            std::memcpy(buf, &values[i], sizeof(T));
+            for (size_t j = 0; j < nr_words; j++) {
+                s.words[j].store(buf[j], std::memory_order_relaxed);
+            }
+            s.seq.store(prev + 2 * capacity(), std::memory_order_release);
+        }
+    }
+};
+
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "helix/spsc_ring.hh"
+#include "helix/helix.hh"
+#include "helix/net.hh"
+
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+
+namespace helix {
+
+//! Magic bytes at the start of a Helix capture file.
+constexpr char capture_magic[8] = {'H', 'E', 'L', 'I', 'X', 'C', 'A', 'P'};
+
+//! Version of the capture file format.
+constexpr uint32_t capture_version = 1;
+
+//! Size of a buffer that a capture writer fills before handing it to the
+//! writer thread.
+constexpr size_t capture_chunk_size = 1024 * 1024;
+
+//! Number of buffers between a capture writer and its writer thread.
+constexpr size_t capture_nr_chunks = 16;
+
+//! Time after its first packet that the writer thread takes a partly filled
+//! buffer from the receiving thread.
+constexpr std::chrono::milliseconds capture_flush_interval{100};
+
+//! Header of a capture file. Fields are little-endian.
+struct capture_file_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+} __attribute__ ((packed));
+
+//! Header of a packet in a capture file. Fields are little-endian.
+//
+// The header is followed by the payload, which is padded with zeros to a
+// multiple of eight bytes so that every header is aligned in a mapping of
+// the file.
+struct capture_packet_header {
+    //! Receive time in nanoseconds since the epoch.
+    uint64_t timestamp;
+    //! Feed line that the packet was received on.
+    uint16_t line;
+    uint16_t reserved;
+    //! Length of the payload.
+    uint32_t len;
+} __attribute__ ((packed));
+
+//! Error in the format of a capture file.
+class capture_error : public std::runtime_error {
+public:
+    explicit capture_error(const std::string& cause)
+        : std::runtime_error{cause}
+    { }
+};
+
+//! Packet of a capture file.
+struct capture_packet {
+    //! Receive time in nanoseconds since the epoch.
+    uint64_t timestamp;
+    //! Feed line that the packet was received on.
+    uint16_t line;
+    //! UDP payload, which points into the capture file.
+    net::packet_view payload;
+};
+
+//! Counters of a capture writer.
+struct capture_stats {
+    //! Number of packets recorded.
+    uint64_t packets = 0;
+    //! Number of bytes recorded, including packet headers and padding.
+    uint64_t bytes = 0;
+    //! Number of packets dropped because the writer thread fell behind.
+    uint64_t dropped = 0;
+};
+
+// Capture file writer.
+//
+// The writer appends received packets to a Helix capture file, which is
+// created if it does not exist. Packets are copied into a buffer on the
+// receiving thread and the buffers are written out in batches by a thread
+// of its own, so recording a packet is a copy and never a system call. The
+// buffers cycle between the two threads through a pair of rings. If the
+// writer thread falls behind so far that no buffer is free, packets are
+// dropped rather than delaying the receiving thread.
+//
+// A buffer is handed to the writer thread when it is full. The writer thread
+// polls for buffers, and takes a buffer that has held packets for longer
+// than capture_flush_interval even if the feed has gone quiet, so a
+// recording that is killed loses at most that much. A lock that the
+// receiving thread holds only while it copies a packet guards the buffer
+// that it is filling. A recording that is cut short leaves a truncated last
+// packet, which readers ignore and which is cut off when the file is opened
+// to append to.
+class capture_writer {
+    struct chunk {
+        std::unique_ptr<char[]> buf;
+        size_t len = 0;
+    };
+    int _fd;
+    std::unique_ptr<chunk[]> _chunks;
+    //! Buffers filled by the receiving thread for the writer thread.
+    spsc_ring<chunk*> _full{capture_nr_chunks};
+    //! Buffers written out by the writer thread for the receiving thread.
+    spsc_ring<chunk*> _free{capture_nr_chunks};
+    //! Guards the current buffer against the writer thread taking it.
+    std::mutex _lock;
+    //! Buffer that the receiving thread is filling, if any.
+    chunk* _current = nullptr;
+    //! Time of the first packet in the current buffer.
+    std::chrono::steady_clock::time_point _current_start;
+    capture_stats _stats;
+    std::atomic<bool> _closing{false};
+    //! Error number of the first failed write, or zero.
+    std::atomic<int> _error{0};
+    std::thread _thread;
+public:
+    explicit capture_writer(const std::string& filename);
+    ~capture_writer();
+
+    capture_writer(const capture_writer&) = delete;
+    capture_writer& operator=(const capture_writer&) = delete;
+
+    //! Record a packet received on feed line @line at @timestamp, in
+    //! nanoseconds since the epoch.
+    void record(uint64_t timestamp, uint16_t line, const net::packet_view& packet);
+
+    //! Hand the packets recorded so far to the writer thread.
+    void flush();
+
+    //! Write out the recorded packets and close the file.
+    void close();
+
+    const capture_stats& stats() const {
+        return _stats;
+    }
+
+private:
+    bool acquire();
+    void hand_over();
+    chunk* take_stale();
+    void run();
+    void write_chunks(chunk** chunks, size_t count);
+};
+
+// Capture file reader.
+//
+// The reader maps a Helix capture file and returns its packets in the order
+// they were recorded.
+class capture_reader {
+    int _fd;
+    const char* _buf;
+    size_t _len;
+    size_t _pos = sizeof(capture_file_header);
+    bool _truncated = false;
+public:
+    explicit capture_reader(const std::string& filename);
+    ~capture_reader();
+
+    capture_reader(const capture_reader&) = delete;
+    capture_reader& operator=(const capture_reader&) = delete;
+
+    //! Read the next packet. Returns false at the end of the capture.
+    bool next(capture_packet& packet);
+
+    //! Returns true if the capture ended in a truncated packet.
+    bool truncated() const {
+        return _truncated;
+    }
+};
+
+//! Replay the packets of a Helix capture through a session in the order
+//! they were recorded, on the feed lines they were received on.
+//
+// If @honor_timestamps is true, every packet is delivered when as much time
+// has passed since the first one as had passed when it was recorded.
+// Otherwise the capture is replayed as fast as the session processes it.
+// Returns the number of packets replayed.
+uint64_t replay(session& s, capture_reader& reader, bool honor_timestamps);
+
+}
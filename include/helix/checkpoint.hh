@@ -0,0 +1,72 @@
+#pragma once
+
+/// \defgroup checkpoint Order book checkpoints
+///
+/// A checkpoint captures the order books of a session together with the
+/// position in the feed up to which messages have been applied to them, so
+/// that a process that joins mid-day can restore the books and apply only
+/// the messages that follow instead of replaying the feed from the start.
+
+#include <stdexcept>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace helix {
+
+/// \addtogroup checkpoint
+/// @{
+
+/// \brief Checkpoint format version.
+constexpr uint32_t checkpoint_version = 1;
+
+/// \brief Error in reading or writing a checkpoint.
+class checkpoint_error : public std::runtime_error {
+public:
+    explicit checkpoint_error(const std::string& cause)
+        : std::runtime_error{cause}
+    { }
+};
+
+/// \brief Checkpoint writer.
+///
+/// Values are written in big-endian byte order after a header that
+/// identifies the format and its version. Every component of a session
+/// writes a tag before its state so that a checkpoint is never loaded into
+/// a session of a different kind.
+class checkpoint_writer {
+    std::ostream& _out;
+public:
+    explicit checkpoint_writer(std::ostream& out);
+
+    void write_u8(uint8_t value);
+    void write_u32(uint32_t value);
+    void write_u64(uint64_t value);
+    void write_string(const std::string& value);
+    void write_tag(const std::string& tag);
+    void write_bytes(const void* buf, size_t len);
+private:
+    void write(const void* buf, size_t len);
+};
+
+/// \brief Checkpoint reader.
+class checkpoint_reader {
+    std::istream& _in;
+public:
+    explicit checkpoint_reader(std::istream& in);
+
+    uint8_t read_u8();
+    uint32_t read_u32();
+    uint64_t read_u64();
+    std::string read_string();
+    /// Read a tag and throw checkpoint_error unless it is @tag.
+    void read_tag(const std::string& tag);
+    void read_bytes(void* buf, size_t len);
+private:
+    void read(void* buf, size_t len);
+};
+
+/// @}
+
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "helix/spsc_ring.hh"
+
+#include <unordered_map>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace helix {
+
+//! Magic bytes at the start of a column file.
+constexpr char column_magic[8] = {'H', 'E', 'L', 'I', 'X', 'C', 'O', 'L'};
+
+//! Version of the column file format.
+constexpr uint32_t column_version = 1;
+
+//! Magic number at the start of a block of a column file.
+constexpr uint32_t column_block_magic = 0x4b4c4248; // "HBLK"
+
+//! Default number of rows in a block.
+constexpr size_t column_block_rows = 64 * 1024;
+
+//! Number of blocks between a column writer and its writer thread.
+constexpr size_t column_nr_blocks = 4;
+
+//! Longest column name.
+constexpr size_t column_name_size = 16;
+
+//! Header of a column file. Fields are little-endian.
+//
+// The header is followed by a descriptor of every column and then by the
+// blocks of the file.
+struct column_file_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t nr_columns;
+    //! Number of rows in every block but the last.
+    uint32_t block_rows;
+    uint32_t reserved;
+} __attribute__ ((packed));
+
+//! Descriptor of a column in a column file. Fields are little-endian.
+struct column_descriptor {
+    //! Name of the column, padded with NULs.
+    char     name[column_name_size];
+    //! Width of a value in bytes: 1, 2, 4 or 8. Values are unsigned.
+    uint32_t width;
+    //! Divisor that converts a value to its real value, or 1.
+    uint32_t scale;
+} __attribute__ ((packed));
+
+//! Header of a block of a column file. Fields are little-endian.
+//
+// The header is followed by the strings that were interned since the
+// previous block, each terminated with a NUL and all padded with NULs to a
+// multiple of eight bytes, and then by the values of every column in
+// order, each column padded with zeros to a multiple of eight bytes.
+struct column_block_header {
+    uint32_t magic;
+    uint32_t nr_rows;
+    uint32_t nr_strings;
+    //! Length of the strings, including padding.
+    uint32_t strings_len;
+} __attribute__ ((packed));
+
+//! Column of a column file.
+struct column {
+    std::string name;
+    //! Width of a value in bytes: 1, 2, 4 or 8.
+    uint32_t width;
+    //! Divisor that converts a value to its real value.
+    uint32_t scale = 1;
+};
+
+// Columnar binary file writer.
+//
+// The writer stores rows of fixed-width unsigned integers column by column
+// in blocks, so that a reader can map every column of a block straight into
+// an array. Strings, such as symbols, are interned into dense ids that are
+// stored in integer columns; the strings themselves are written in the
+// block that follows their interning, in id order.
+//
+// Rows are appended into a block on the calling thread, and full blocks are
+// written out by a thread of the writer. The blocks cycle between the two
+// threads through a pair of rings; if every block is waiting to be written,
+// append() waits for one, because no row is ever dropped.
+class column_writer {
+    struct block {
+        std::unique_ptr<char[]> buf;
+        size_t nr_rows = 0;
+        //! Strings that were interned since the previous block.
+        std::string strings;
+        uint32_t nr_strings = 0;
+    };
+    int _fd;
+    std::vector<column> _columns;
+    //! Offset of every column in a block buffer.
+    std::vector<size_t> _offsets;
+    size_t _block_rows;
+    std::unique_ptr<block[]> _blocks;
+    //! Blocks filled by the appending thread for the writer thread.
+    spsc_ring<block*> _full{column_nr_blocks};
+    //! Blocks written out by the writer thread for the appending thread.
+    spsc_ring<block*> _free{column_nr_blocks};
+    //! Block that the appending thread is filling, if any.
+    block* _current = nullptr;
+    std::unordered_map<std::string, uint32_t> _string_ids;
+    //! Strings interned since the current block was handed over.
+    std::string _pending_strings;
+    uint32_t _nr_pending_strings = 0;
+    uint64_t _nr_rows = 0;
+    std::atomic<bool> _closing{false};
+    //! Error number of the first failed write, or zero.
+    std::atomic<int> _error{0};
+    std::thread _thread;
+public:
+    column_writer(const std::string& filename, const std::vector<column>& columns, size_t block_rows = column_block_rows);
+    ~column_writer();
+
+    column_writer(const column_writer&) = delete;
+    column_writer& operator=(const column_writer&) = delete;
+
+    //! Returns the id of @s, interning it if it is new.
+    uint32_t intern(const std::string& s);
+
+    //! Append a row with one value per column. Values are truncated to the
+    //! width of their column.
+    void append(const uint64_t* values);
+
+    //! Write out the appended rows and close the file.
+    void close();
+
+    uint64_t nr_rows() const {
+        return _nr_rows;
+    }
+
+private:
+    void acquire();
+    void flush();
+    void run();
+    void write_block(block* b);
+};
+
+}
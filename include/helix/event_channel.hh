@@ -0,0 +1,110 @@
+#pragma once
+
+#include "helix/broadcast_ring.hh"
+#include "helix/mpmc_ring.hh"
+#include "helix/helix.hh"
+
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace helix {
+
+/// \brief Normalized event record that is passed to consumer threads.
+///
+/// The record carries the top of book and the trade of an event by value,
+/// so consumers never touch order books owned by the feed thread.
+struct event_record {
+    uint32_t   symbol_id;
+    event_mask mask;
+    uint64_t   timestamp;
+    uint64_t   bid_price;
+    uint64_t   bid_size;
+    uint64_t   ask_price;
+    uint64_t   ask_size;
+    uint64_t   trade_price;
+    uint64_t   trade_size;
+    trade_sign sign;
+};
+
+/// \brief What a publisher does when the channel is full.
+enum class backpressure {
+    /// Wait for consumers to make room.
+    block,
+    /// Discard the oldest record in the channel.
+    drop_oldest,
+    /// Keep only the latest record of every symbol in the channel.
+    conflate,
+};
+
+/// \brief Bounded channel that carries events from sessions to consumer threads.
+///
+/// A session's event callback publishes events to the channel, which copies
+/// them into normalized records, and consumer threads consume the records in
+/// batches. Several sessions may publish to the same channel concurrently.
+/// Every consumer reads the channel at a cursor of its own and sees every
+/// record, so a slow consumer holds back publishers, or misses records, but
+/// does not take records away from the other consumers.
+///
+/// Symbols are identified by dense ids, which are assigned with add_symbol().
+/// Events of other symbols are ignored. Symbols and consumers are added
+/// before anything is published.
+///
+/// In the conflating mode, the latest record of a symbol is kept in a
+/// per-symbol slot and every consumer has a queue of symbol ids, in which a
+/// symbol is queued at most once, so a slow consumer sees the latest state of
+/// every symbol instead of every update. As a result, a trade may be
+/// superseded by a later update of the same symbol before it is consumed.
+class event_channel {
+    struct conflation_slot;
+    struct conflation_queue;
+
+    broadcast_ring<event_record> _ring;
+    backpressure _policy;
+    size_t _capacity;
+    std::unordered_map<std::string, uint32_t> _symbol_ids;
+    std::vector<std::string> _symbols;
+    std::vector<std::unique_ptr<conflation_slot>> _latest;
+    std::vector<std::unique_ptr<conflation_queue>> _queues;
+    std::atomic<bool> _closed{false};
+public:
+    event_channel(size_t capacity, backpressure policy);
+    ~event_channel();
+
+    //! Register a symbol and return its id.
+    uint32_t add_symbol(const std::string& symbol);
+
+    //! Returns the symbol for an id.
+    const std::string& symbol(uint32_t symbol_id) const;
+
+    //! Publish an event, returns false if its symbol is not registered.
+    bool publish(const event& ev);
+
+    //! Publish a batch of records.
+    void publish(const event_record* records, size_t count);
+
+    //! Add a consumer and return its index.
+    size_t add_consumer();
+
+    //! Consume up to @max_count records at the cursor of @consumer, returns
+    //! the number of records consumed.
+    size_t consume(size_t consumer, event_record* records, size_t max_count);
+
+    //! Mark the channel closed. Consumers drain the channel and stop.
+    void close();
+
+    bool is_closed() const;
+
+    //! Number of records that @consumer missed because they were discarded
+    //! or conflated.
+    uint64_t dropped(size_t consumer) const;
+
+private:
+    void publish_latest(const event_record& record);
+};
+
+}
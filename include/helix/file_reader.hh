@@ -0,0 +1,86 @@
+#pragma once
+
+#include "helix/helix.hh"
+#include "helix/net.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace helix {
+
+//! Size of the largest frame of a file format, which is the largest
+//! BinaryFILE frame: a 16-bit length followed by a payload of that length.
+constexpr size_t file_reader_max_frame_size = 2 + 65535;
+
+//! Default amount of input that a file reader keeps in memory.
+constexpr size_t file_reader_window_size = 8 * 1024 * 1024;
+
+//! Number of reads that an io_uring file reader keeps queued.
+constexpr size_t file_reader_queue_depth = 4;
+
+//! Number of buffers between a decompression thread and the consumer.
+constexpr size_t file_reader_ring_size = 4;
+
+//! How a file reader reads its input.
+enum class read_mode {
+    //! Map a window of the file that slides over it, with sequential access
+    //! advice and the next window prefetched.
+    mmap,
+    //! Read into two buffers with pread(), one filled by a reader thread
+    //! while the other is processed.
+    pread,
+    //! Read into buffers with reads queued in an io_uring. Available on Linux
+    //! 5.6 or later.
+    io_uring,
+};
+
+//! Compression of a file.
+enum class compression {
+    none,
+    gzip,
+    zstd,
+};
+
+// Streaming file reader.
+//
+// A file reader hands out its input in contiguous chunks without ever
+// holding the whole file in memory. A chunk that does not reach the end of
+// the file holds at least file_reader_max_frame_size bytes, so a frame that
+// starts in the first part of a chunk always ends in it. The caller consumes
+// whole frames from the chunk and asks for the next one; the unconsumed tail
+// of a chunk is the head of the next.
+class file_reader {
+public:
+    virtual ~file_reader()
+    { }
+
+    //! Returns the unconsumed input, which is empty at the end of the file.
+    virtual net::packet_view peek() = 0;
+
+    //! Returns true if the chunk returned by peek() ends at the end of the file.
+    virtual bool eof() const = 0;
+
+    //! Consume @len bytes from the start of the chunk returned by peek().
+    virtual void consume(size_t len) = 0;
+};
+
+//! Returns the compression of @filename, which is detected from its contents.
+compression detect_compression(const std::string& filename);
+
+//! Open @filename for reading from @offset onwards.
+//
+// Compressed files are decompressed on a thread of their own into a ring of
+// buffers, whatever the read mode, and @offset is a position in the
+// decompressed input. zstd is available if Helix is built with libzstd.
+std::unique_ptr<file_reader> open_file_reader(const std::string& filename, read_mode mode, size_t window_size = file_reader_window_size, uint64_t offset = 0);
+
+//! Replay the input of @reader through a session for a file format.
+//
+// Every call to the session starts at a frame boundary and sees the rest of
+// the chunk, so frames are never split across chunks. Returns the number of
+// bytes processed.
+uint64_t replay(session& s, file_reader& reader);
+
+}
@@ -8,9 +8,16 @@
 ///
 ///   - \ref order-book Order book reconstruction and management.
 
+#include "helix/sizing_hints.hh"
 #include "helix/order_book.hh"
+#include "helix/checkpoint.hh"
 
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+#include <chrono>
 #include <cstddef>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -90,8 +97,85 @@ using event_callback = std::function<void(const event&)>;
 
 using send_callback = std::function<void(char*, size_t)>;
 
+//! Retransmission request pacing of a session.
+struct retransmit_config {
+    //! Time to wait before a new gap is requested, which gives a redundant feed line a chance to fill it.
+    std::chrono::microseconds delay{0};
+    //! Time to wait for a response before a range is requested again.
+    std::chrono::microseconds timeout{1000};
+    //! Upper bound of the timeout, which doubles every time a range is requested again.
+    std::chrono::microseconds max_timeout{100000};
+    //! Gaps that are at most this many messages apart are requested as one range.
+    uint64_t coalesce_distance = 64;
+};
+
+//! Retransmission request and response counters of a session.
+struct retransmit_stats {
+    //! Number of retransmission requests sent.
+    uint64_t requests = 0;
+    //! Number of messages requested.
+    uint64_t requested_messages = 0;
+    //! Number of received packets that carried requested messages.
+    uint64_t responses = 0;
+    //! Number of requested messages received.
+    uint64_t recovered_messages = 0;
+};
+
+//! Clock that a paced replay waits on.
+enum class pacing_clock {
+    //! Busy-wait on clock_gettime(CLOCK_MONOTONIC).
+    monotonic,
+    //! Busy-wait on the time-stamp counter, which is calibrated against the
+    //! monotonic clock. Available on x86.
+    tsc,
+};
+
+//! Real-time pacing of a replay by message timestamps.
+struct pacing_config {
+    //! Replay speed relative to the original, for example 2.0 for twice as
+    //! fast. Zero disables pacing.
+    double speed = 0;
+    pacing_clock clock = pacing_clock::monotonic;
+    //! Pace only the first message of every packet and release the rest of
+    //! the packet with it.
+    bool per_packet = false;
+};
+
+//! Pacing counters of a session.
+struct pacing_stats {
+    //! Number of paced messages or packets.
+    uint64_t releases = 0;
+    //! Number of releases whose time had passed before they were reached.
+    uint64_t late = 0;
+    //! Percentiles of the time by which releases missed their time, in nanoseconds.
+    uint64_t p50_ns = 0;
+    uint64_t p90_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t p999_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+//! Packet counters of a feed line.
+struct line_stats {
+    //! Number of packets received on the line.
+    uint64_t packets = 0;
+    //! Number of packets that arrived on the line first and were processed.
+    uint64_t forwarded = 0;
+    //! Number of packets that arrived after their copy on another line.
+    uint64_t duplicates = 0;
+    //! Number of messages that the line skipped over.
+    uint64_t lost_messages = 0;
+    //! Total time by which packets on the line led their copies, in nanoseconds.
+    uint64_t lead_ns = 0;
+    //! Total time by which packets on the line lagged their copies, in nanoseconds.
+    uint64_t lag_ns = 0;
+    //! Maximum time by which a packet on the line lagged its copy, in nanoseconds.
+    uint64_t max_lag_ns = 0;
+};
+
 class session {
     void* _data;
+    std::shared_ptr<const sizing_hints> _sizing_hints;
 public:
     explicit session(void* data)
         : _data{data}
@@ -106,13 +190,84 @@ public:
 
     virtual bool is_rth_timestamp(uint64_t timestamp) = 0;
 
+    //! Subscribe to @symbol, with its order book sized for @max_orders
+    //! orders unless the sizing hints of the session say otherwise.
     virtual void subscribe(const std::string& symbol, size_t max_orders) = 0;
 
+    //! Size the order books of symbols that are subscribed to from now on by @hints.
+    void set_sizing_hints(std::shared_ptr<const sizing_hints> hints) {
+        _sizing_hints = std::move(hints);
+    }
+
+    //! Returns the number of orders to size the order book of @symbol for.
+    size_t sized_max_orders(const std::string& symbol, size_t max_orders) const {
+        return _sizing_hints ? _sizing_hints->max_orders(symbol, max_orders) : max_orders;
+    }
+
     virtual void register_callback(event_callback callback) = 0;
 
     virtual void set_send_callback(send_callback callback) = 0;
 
     virtual size_t process_packet(const net::packet_view& packet) = 0;
+
+    //! Process a packet received on feed line @line. Sessions that do not
+    //! arbitrate between redundant lines process packets from every line.
+    virtual size_t process_line_packet(size_t line, const net::packet_view& packet) {
+        return process_packet(packet);
+    }
+
+    virtual line_stats get_line_stats(size_t line) const {
+        return line_stats{};
+    }
+
+    //! Configure retransmission request pacing, if the session sends requests.
+    virtual void set_retransmit_config(const retransmit_config& config) {
+    }
+
+    virtual retransmit_stats get_retransmit_stats() const {
+        return retransmit_stats{};
+    }
+
+    //! Request the missing messages whose retransmission timeout has
+    //! expired. Sessions otherwise only check their timeouts when a packet
+    //! arrives, so this is called periodically while the feed is quiet.
+    virtual void poll_retransmit() {
+    }
+
+    //! Wait until every message of the input is processed, and rethrow the
+    //! first error that a session which processes messages on threads of
+    //! its own failed with. Called at the end of the input, after which no
+    //! more packets are processed.
+    virtual void finish() {
+    }
+
+    //! Pace the replay of historical data by message timestamps.
+    virtual void set_pacing_config(const pacing_config& config) {
+        throw std::invalid_argument("session does not support pacing");
+    }
+
+    virtual pacing_stats get_pacing_stats() const {
+        return pacing_stats{};
+    }
+
+    //! Position in the feed up to which messages have been processed: the
+    //! next expected sequence number for sequenced transports and the byte
+    //! offset in the file for file formats.
+    virtual uint64_t position() const {
+        return 0;
+    }
+
+    //! Write the order books of the session and its position to a checkpoint.
+    virtual void save_checkpoint(checkpoint_writer& writer) const {
+        throw std::invalid_argument("session does not support checkpoints");
+    }
+
+    //! Restore the order books and the position of the session from a
+    //! checkpoint. Sequenced transports drop messages up to the position;
+    //! file formats expect the next packet to start at the position.
+    virtual void load_checkpoint(checkpoint_reader& reader) {
+        throw std::invalid_argument("session does not support checkpoints");
+    }
 };
 
 class protocol {
@@ -121,6 +276,19 @@ public:
     { }
 
     virtual session* new_session(void*) = 0;
+
+    //! Create a session that processes messages on @nr_threads threads.
+    virtual session* new_parallel_session(void* data, size_t nr_threads) {
+        if (nr_threads == 1) {
+            return new_session(data);
+        }
+        throw std::invalid_argument("protocol does not support parallel sessions");
+    }
+
+    //! Create a session that arbitrates between redundant feed lines.
+    virtual session* new_arbitrated_session(void* data) {
+        throw std::invalid_argument("protocol does not support line arbitration");
+    }
 };
 
 }
@@ -0,0 +1,471 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <type_traits>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <memory>
+#include <new>
+
+namespace helix {
+
+//! Length from which the memory of a table is faulted in and unmapped by
+//! the pager thread.
+constexpr size_t pager_min_len = 1024 * 1024;
+
+//! Fault in the pages of a mapping on the pager thread.
+//
+// Requests run in the order they are made, one at a time, on a thread that
+// every map shares. Without MADV_POPULATE_WRITE (Linux 5.14), pages are
+// faulted in on first touch instead.
+void pager_prefault(void* addr, size_t len);
+
+//! Unmap a mapping on the pager thread, after any request to fault it in.
+void pager_unmap(void* addr, size_t len);
+
+// Hash map that grows without stopping the world.
+//
+// The map is an open-addressing table with linear probing. When the table
+// fills up, the map allocates a table twice the size and moves entries over
+// a few slots at a time on every insert, instead of rehashing all of them at
+// once the way std::unordered_map does. Until the old table is drained,
+// lookups check both tables. The pace of the migration guarantees that the
+// old table is empty before the new one fills up, so the cost of any single
+// operation is bounded no matter how large the map grows.
+//
+// Allocating and freeing a large table has to be bounded too. Tables are
+// mapped anonymously. Left to themselves, the pages of a new table would be
+// faulted in by the inserts that land on them at random right after it is
+// allocated, a page fault in most of them, and unmapping the old table at
+// the end of the migration would free all of its pages at once. Instead,
+// the next table is allocated once the active table is three quarters of
+// the way to full, a pager thread faults in its pages before it takes any
+// entries, and the pager unmaps the old table once it is drained. Large
+// tables ask for huge pages, which keeps the page walks of random probes
+// short.
+//
+// Tables are at most three quarters full, so the map takes 32 to 64 bytes
+// per entry of 16 bytes.
+//
+// The map supports the subset of the std::unordered_map interface that feed
+// handlers use. Iterators are plain pointers to entries, and every insert
+// invalidates them.
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class incremental_map {
+public:
+    using value_type = std::pair<const Key, Value>;
+    using iterator = value_type*;
+    using const_iterator = const value_type*;
+private:
+    //! Number of old table slots that every insert migrates.
+    static constexpr size_t migrate_step = 8;
+    //! Smallest table capacity.
+    static constexpr size_t min_capacity = 16;
+
+    enum slot_state : uint8_t {
+        slot_empty = 0,
+        slot_live,
+        //! A removed entry, which probes step over.
+        slot_deleted,
+    };
+
+    struct slot {
+        slot_state state;
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+
+        value_type* value() {
+            return reinterpret_cast<value_type*>(&storage);
+        }
+
+        const value_type* value() const {
+            return reinterpret_cast<const value_type*>(&storage);
+        }
+    };
+
+    struct table {
+        slot* slots = nullptr;
+        size_t capacity = 0;
+        //! Number of live entries.
+        size_t size = 0;
+        //! Number of live and deleted entries.
+        size_t used = 0;
+        //! Length of the mapping.
+        size_t map_len = 0;
+
+        table() = default;
+
+        explicit table(size_t capacity)
+            : capacity{capacity}
+        {
+            size_t page_size = sysconf(_SC_PAGESIZE);
+            map_len = (capacity * sizeof(slot) + page_size - 1) / page_size * page_size;
+            void* p = mmap(nullptr, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) {
+                throw std::bad_alloc{};
+            }
+            slots = static_cast<slot*>(p);
+        }
+
+        //! Fault in the pages of a large table on the pager thread.
+        void prefault() {
+            if (map_len >= pager_min_len) {
+                madvise(slots, map_len, MADV_HUGEPAGE);
+                pager_prefault(slots, map_len);
+            }
+        }
+
+        table(table&& other) noexcept {
+            *this = std::move(other);
+        }
+
+        table& operator=(table&& other) noexcept {
+            if (this != &other) {
+                unmap();
+                slots = other.slots;
+                capacity = other.capacity;
+                size = other.size;
+                used = other.used;
+                map_len = other.map_len;
+                other.slots = nullptr;
+                other.capacity = other.size = other.used = other.map_len = 0;
+            }
+            return *this;
+        }
+
+        ~table() {
+            unmap();
+        }
+
+        //! The table is full when a new entry would take it over its maximum load.
+        bool full() const {
+            return used + 1 > max_load(capacity);
+        }
+
+        void unmap() {
+            if (!slots) {
+                return;
+            }
+            if (map_len >= pager_min_len) {
+                pager_unmap(slots, map_len);
+            } else {
+                munmap(slots, map_len);
+            }
+        }
+
+        slot& operator[](size_t i) {
+            return slots[i];
+        }
+
+        const slot& operator[](size_t i) const {
+            return slots[i];
+        }
+    };
+
+    Hash _hash;
+    //! The table that new entries go to.
+    table _active;
+    //! The table that entries are migrated from, if growing.
+    table _old;
+    //! Index of the next old table slot to migrate.
+    size_t _migrate_pos = 0;
+    //! The table that the active table grows into, while the pager faults
+    //! in its pages.
+    table _next;
+public:
+    incremental_map() = default;
+
+    incremental_map(const incremental_map&) = delete;
+    incremental_map& operator=(const incremental_map&) = delete;
+
+    incremental_map(incremental_map&&) = default;
+
+    ~incremental_map() {
+        destroy(_active);
+        destroy(_old);
+    }
+
+    size_t size() const {
+        return _active.size + _old.size;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    //! Returns true if entries are being migrated to a larger table.
+    bool migrating() const {
+        return _old.capacity > 0;
+    }
+
+    iterator end() {
+        return nullptr;
+    }
+
+    const_iterator end() const {
+        return nullptr;
+    }
+
+    iterator find(const Key& key) {
+        if (auto* s = find_slot(_active, key, 0)) {
+            return s->value();
+        }
+        if (auto* s = find_slot(_old, key, _migrate_pos)) {
+            return s->value();
+        }
+        return end();
+    }
+
+    const_iterator find(const Key& key) const {
+        return const_cast<incremental_map*>(this)->find(key);
+    }
+
+    size_t count(const Key& key) const {
+        return find(key) != end();
+    }
+
+    //! Insert @value unless its key is already in the map.
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return emplace(value);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return emplace(std::move(value));
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        value_type value{std::forward<Args>(args)...};
+        auto it = find(value.first);
+        if (it != end()) {
+            return {it, false};
+        }
+        if (_active.full()) {
+            grow();
+        }
+        auto* s = insert_slot(_active, std::move(value));
+        migrate(migrate_step);
+        prepare_next();
+        return {s->value(), true};
+    }
+
+    //! Remove the entry of @key, returning the number of entries removed.
+    size_t erase(const Key& key) {
+        if (auto* s = find_slot(_active, key, 0)) {
+            remove(_active, *s);
+            return 1;
+        }
+        if (auto* s = find_slot(_old, key, _migrate_pos)) {
+            remove(_old, *s);
+            return 1;
+        }
+        return 0;
+    }
+
+    //! Remove the entry that @it points to, which saves looking up its key
+    //! again after a find().
+    void erase(iterator it) {
+        auto* s = reinterpret_cast<slot*>(reinterpret_cast<char*>(it) - offsetof(slot, storage));
+        if (s >= _active.slots && s < _active.slots + _active.capacity) {
+            remove(_active, *s);
+        } else {
+            remove(_old, *s);
+        }
+    }
+
+    //! Remove every entry, keeping the capacity of the map.
+    void clear() {
+        destroy(_active);
+        destroy(_old);
+        _old = table{};
+        _migrate_pos = 0;
+        if (_active.capacity) {
+            _active = table{_active.capacity};
+        }
+    }
+
+    //! Make room for @n entries at once.
+    //
+    // Unlike inserts, reserving rehashes every entry before it returns,
+    // because it is meant for setup, before messages are processed.
+    void reserve(size_t n) {
+        migrate(_old.capacity);
+        if (n <= max_load(_active.capacity)) {
+            return;
+        }
+        _next = table{};
+        start_migration(table{capacity_for(n)});
+        migrate(_old.capacity);
+    }
+
+    //! Call @fn for every entry.
+    template<typename Fn>
+    void for_each(Fn&& fn) const {
+        for_each(_active, fn);
+        for_each(_old, fn);
+    }
+private:
+    //! Returns the number of live and deleted entries that a table of
+    //! @capacity slots holds at most.
+    static size_t max_load(size_t capacity) {
+        return capacity / 4 * 3;
+    }
+
+    static size_t capacity_for(size_t n) {
+        size_t capacity = min_capacity;
+        while (max_load(capacity) < n) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    size_t home(const table& t, const Key& key) const {
+        uint64_t h = uint64_t(_hash(key)) * 0x9e3779b97f4a7c15;
+        return (h ^ (h >> 32)) & (t.capacity - 1);
+    }
+
+    //! Look up @key in @t, whose slots below @first are known to be migrated.
+    //
+    // Migrated slots hold no entries, so they are skipped over rather than
+    // read. As they may have been empty, the probe is bounded by the number
+    // of slots instead.
+    slot* find_slot(table& t, const Key& key, size_t first) const {
+        if (!t.size) {
+            return nullptr;
+        }
+        size_t mask = t.capacity - 1;
+        size_t i = home(t, key);
+        for (size_t probes = 0; probes < t.capacity; probes++, i = (i + 1) & mask) {
+            if (i < first) {
+                probes += first - i;
+                i = first;
+                if (probes >= t.capacity) {
+                    break;
+                }
+            }
+            auto& s = t[i];
+            if (s.state == slot_empty) {
+                return nullptr;
+            }
+            if (s.state == slot_live && s.value()->first == key) {
+                return &s;
+            }
+        }
+        return nullptr;
+    }
+
+    //! Insert an entry whose key is known not to be in @t.
+    slot* insert_slot(table& t, value_type&& value) {
+        size_t mask = t.capacity - 1;
+        for (size_t i = home(t, value.first);; i = (i + 1) & mask) {
+            auto& s = t[i];
+            if (s.state != slot_live) {
+                if (s.state == slot_empty) {
+                    t.used++;
+                }
+                new (&s.storage) value_type{std::move(value)};
+                s.state = slot_live;
+                t.size++;
+                return &s;
+            }
+        }
+    }
+
+    static void remove(table& t, slot& s) {
+        s.value()->~value_type();
+        s.state = slot_deleted;
+        t.size--;
+    }
+
+    //! Move the entries of the active table to @t.
+    void start_migration(table&& t) {
+        _old = std::move(_active);
+        _active = std::move(t);
+        _migrate_pos = 0;
+    }
+
+    //! Returns the capacity of the table that the active table grows into.
+    //
+    // Deleted entries count towards the load, so a table that is full of
+    // them is rehashed at the same size to clean them up.
+    size_t next_capacity(size_t size) const {
+        size_t capacity = _active.capacity ? _active.capacity : size_t(min_capacity);
+        if (size >= max_load(capacity) / 2) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    void grow() {
+        // An insert that fills the active table while it is still growing
+        // means the migration fell behind, which the step size rules out,
+        // but drain the old table rather than dropping it.
+        migrate(_old.capacity);
+        size_t capacity = next_capacity(_active.size);
+        if (_next.capacity >= capacity) {
+            start_migration(std::move(_next));
+        } else {
+            _next = table{};
+            start_migration(table{capacity});
+        }
+    }
+
+    //! Allocate the next table once the active table is three quarters of
+    //! the way to full, so that the pager has faulted in its pages by the
+    //! time it is full.
+    void prepare_next() {
+        if (_next.capacity || migrating() || _active.used < max_load(_active.capacity) / 4 * 3) {
+            return;
+        }
+        // The size may grow past the point of doubling before the table is
+        // full, so a table that may have to double does.
+        _next = table{next_capacity(_active.size * 2)};
+        _next.prefault();
+    }
+
+    //! Migrate up to @nr_slots slots of the old table.
+    void migrate(size_t nr_slots) {
+        if (!migrating()) {
+            return;
+        }
+        size_t end = std::min(_old.capacity, _migrate_pos + nr_slots);
+        for (; _migrate_pos < end; _migrate_pos++) {
+            auto& s = _old[_migrate_pos];
+            if (s.state == slot_live) {
+                insert_slot(_active, std::move(*s.value()));
+                remove(_old, s);
+            }
+        }
+        if (_migrate_pos == _old.capacity) {
+            _old = table{};
+            _migrate_pos = 0;
+        }
+    }
+
+    static void destroy(table& t) {
+        if (std::is_trivially_destructible<value_type>::value) {
+            return;
+        }
+        for (size_t i = 0; i < t.capacity; i++) {
+            if (t[i].state == slot_live) {
+                t[i].value()->~value_type();
+            }
+        }
+    }
+
+    template<typename Fn>
+    static void for_each(const table& t, Fn& fn) {
+        for (size_t i = 0; i < t.capacity; i++) {
+            auto& s = t[i];
+            if (s.state == slot_live) {
+                fn(*s.value());
+            }
+        }
+    }
+};
+
+}
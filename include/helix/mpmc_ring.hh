@@ -0,0 +1,117 @@
+#pragma once
+
+#include "helix/spsc_ring.hh"
+
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <atomic>
+
+namespace helix {
+
+// Bounded lock-free multi-producer multi-consumer ring buffer.
+//
+// Every slot carries a sequence number that tells whether it is free for the
+// producers or ready for the consumers of the current lap around the ring,
+// which lets producers and consumers claim slots with a single CAS on their
+// cursor. Cursors are padded to live on their own cache lines. Both sides
+// work in batches: a producer claims as many consecutive free slots as it has
+// values for, and a consumer claims as many consecutive ready slots as it asks
+// for, with one CAS per batch. With a single producer the ring works as an MPSC ring
+// without any changes.
+template<typename T>
+class mpmc_ring {
+    struct slot {
+        std::atomic<size_t> seq;
+        T value;
+    };
+    std::unique_ptr<slot[]> _slots;
+    size_t _mask;
+    char _pad0[cache_line_size];
+    std::atomic<size_t> _enqueue_pos{0};
+    char _pad1[cache_line_size];
+    std::atomic<size_t> _dequeue_pos{0};
+    char _pad2[cache_line_size];
+public:
+    explicit mpmc_ring(size_t capacity)
+        : _slots{new slot[capacity]}
+        , _mask{capacity - 1}
+    {
+        if (!capacity || (capacity & _mask)) {
+            throw std::invalid_argument("ring capacity must be a power of two");
+        }
+        for (size_t i = 0; i < capacity; i++) {
+            _slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const {
+        return _mask + 1;
+    }
+
+    //! Publish up to @count values, returns the number of values published.
+    size_t try_publish(const T* values, size_t count) {
+        if (!count) {
+            return 0;
+        }
+        size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t n = 0;
+            while (n < count && _slots[(pos + n) & _mask].seq.load(std::memory_order_acquire) == pos + n) {
+                n++;
+            }
+            if (!n) {
+                auto seq = _slots[pos & _mask].seq.load(std::memory_order_acquire);
+                if (intptr_t(seq - pos) < 0) {
+                    // The ring is full.
+                    return 0;
+                }
+                pos = _enqueue_pos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (_enqueue_pos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+                for (size_t i = 0; i < n; i++) {
+                    auto& s = _slots[(pos + i) & _mask];
+                    s.value = values[i];
+                    s.seq.store(pos + i + 1, std::memory_order_release);
+                }
+                return n;
+            }
+        }
+    }
+
+    //! Consume up to @max_count values, returns the number of values consumed.
+    template<typename Fn>
+    size_t consume(Fn&& fn, size_t max_count) {
+        if (!max_count) {
+            return 0;
+        }
+        size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t n = 0;
+            while (n < max_count && _slots[(pos + n) & _mask].seq.load(std::memory_order_acquire) == pos + n + 1) {
+                n++;
+            }
+            if (!n) {
+                auto seq = _slots[pos & _mask].seq.load(std::memory_order_acquire);
+                if (intptr_t(seq - (pos + 1)) < 0) {
+                    // The ring is empty.
+                    return 0;
+                }
+                pos = _dequeue_pos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (_dequeue_pos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+                for (size_t i = 0; i < n; i++) {
+                    auto& s = _slots[(pos + i) & _mask];
+                    fn(s.value);
+                    s.seq.store(pos + i + _mask + 1, std::memory_order_release);
+                }
+                return n;
+            }
+        }
+    }
+};
+
+}
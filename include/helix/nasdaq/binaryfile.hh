@@ -13,6 +13,7 @@
 
 #include "helix/compat/endian.h"
 #include "helix/helix.hh"
+#include "helix/pacer.hh"
 
 #include <memory>
 
@@ -23,6 +24,10 @@ namespace nasdaq {
 template<typename Handler>
 class binaryfile_session : public session {
     Handler _handler;
+    //! Pacer of a real-time replay.
+    pacer _pacer;
+    //! Offset of the next packet from the start of the file.
+    uint64_t _offset = 0;
 public:
     explicit binaryfile_session(void* data);
 
@@ -35,6 +40,16 @@ public:
     virtual void set_send_callback(send_callback send_cb) override;
 
     virtual size_t process_packet(const net::packet_view& packet) override;
+
+    virtual void set_pacing_config(const pacing_config& config) override;
+
+    virtual pacing_stats get_pacing_stats() const override;
+
+    virtual uint64_t position() const override;
+
+    virtual void save_checkpoint(checkpoint_writer& writer) const override;
+
+    virtual void load_checkpoint(checkpoint_reader& reader) override;
 };
 
 template<typename Handler>
@@ -52,7 +67,7 @@ bool binaryfile_session<Handler>::is_rth_timestamp(uint64_t timestamp)
 template<typename Handler>
 void binaryfile_session<Handler>::subscribe(const std::string& symbol, size_t max_orders)
 {
-    _handler.subscribe(symbol, max_orders);
+    _handler.subscribe(symbol, sized_max_orders(symbol, max_orders));
 }
 
 template<typename Handler>
@@ -74,6 +89,7 @@ size_t binaryfile_session<Handler>::process_packet(const net::packet_view& packe
         // End of session.
         return 0;
     }
+    _pacer.begin_packet();
     size_t offset = sizeof(uint16_t);
     while (payload_len) {
         size_t nr = _handler.process_packet(net::packet_view{packet.buf() + offset, payload_len});
@@ -83,9 +99,45 @@ size_t binaryfile_session<Handler>::process_packet(const net::packet_view& packe
         payload_len -= nr;
         offset += nr;
     }
+    _offset += offset;
     return offset;
 }
 
+template<typename Handler>
+void binaryfile_session<Handler>::set_pacing_config(const pacing_config& config)
+{
+    _pacer.configure(config);
+    _handler.set_pacer(config.speed > 0 ? &_pacer : nullptr);
+}
+
+template<typename Handler>
+pacing_stats binaryfile_session<Handler>::get_pacing_stats() const
+{
+    return _pacer.stats();
+}
+
+template<typename Handler>
+uint64_t binaryfile_session<Handler>::position() const
+{
+    return _offset;
+}
+
+template<typename Handler>
+void binaryfile_session<Handler>::save_checkpoint(checkpoint_writer& writer) const
+{
+    writer.write_tag("binaryfile");
+    writer.write_u64(_offset);
+    _handler.save(writer);
+}
+
+template<typename Handler>
+void binaryfile_session<Handler>::load_checkpoint(checkpoint_reader& reader)
+{
+    reader.read_tag("binaryfile");
+    _offset = reader.read_u64();
+    _handler.load(reader);
+}
+
 }
 
 }
@@ -0,0 +1,273 @@
+/*
+ * Parallel BinaryFILE replay
+ *
+ * The reader thread, which is the thread that calls process_packet(), splits
+ * BinaryFILE frames and routes every message by its shard key (the ITCH 5.0
+ * StockLocate) to one of N worker threads over lock-free SPSC rings. Each
+ * worker owns its own handler and therefore a disjoint set of order books.
+ * As all messages of a symbol go to the same worker in file order, events
+ * for a symbol are delivered in the same order as in a single-threaded
+ * replay, but the event callback is invoked concurrently from the worker
+ * threads, and events of different symbols interleave in no particular
+ * order. A file is not a live feed, so retransmissions cannot be requested.
+ */
+
+#pragma once
+
+#include "helix/compat/endian.h"
+#include "helix/spsc_ring.hh"
+#include "helix/helix.hh"
+#include "helix/net.hh"
+
+#include <exception>
+#include <stdexcept>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace helix {
+
+namespace nasdaq {
+
+//! Maximum number of frames the reader routes per call.
+constexpr size_t binaryfile_batch_size = 256;
+
+//! Number of messages in the ring of a worker thread.
+constexpr size_t binaryfile_ring_size = 16384;
+
+//! A message copied to the ring of a worker thread.
+struct binaryfile_message {
+    static constexpr size_t max_len = cache_line_size - sizeof(uint16_t);
+
+    uint16_t len;
+    char     data[max_len];
+};
+
+template<typename Handler>
+class parallel_binaryfile_session : public session {
+    struct shard {
+        Handler handler;
+        spsc_ring<binaryfile_message> ring{binaryfile_ring_size};
+        std::exception_ptr error;
+        std::atomic<bool> failed{false};
+        std::thread thread;
+    };
+    std::vector<std::unique_ptr<shard>> _shards;
+    std::atomic<bool> _stop{false};
+public:
+    parallel_binaryfile_session(void* data, size_t nr_threads);
+
+    virtual ~parallel_binaryfile_session();
+
+    virtual bool is_rth_timestamp(uint64_t timestamp) override;
+
+    virtual void subscribe(const std::string& symbol, size_t max_orders) override;
+
+    virtual void register_callback(event_callback callback) override;
+
+    virtual void set_send_callback(send_callback send_cb) override;
+
+    virtual size_t process_packet(const net::packet_view& packet) override;
+
+    virtual void finish() override;
+
+private:
+    void run(shard& s);
+    //! Stop the worker threads once they have processed every message.
+    void stop();
+    void route(const char* payload, size_t len);
+    void publish();
+    void drain();
+    void check_errors();
+};
+
+template<typename Handler>
+parallel_binaryfile_session<Handler>::parallel_binaryfile_session(void* data, size_t nr_threads)
+    : session{data}
+{
+    if (!nr_threads) {
+        throw std::invalid_argument("number of threads must be positive");
+    }
+    for (size_t i = 0; i < nr_threads; i++) {
+        _shards.emplace_back(new shard);
+    }
+    for (auto&& s : _shards) {
+        auto* sp = s.get();
+        s->thread = std::thread{[this, sp] { run(*sp); }};
+    }
+}
+
+template<typename Handler>
+parallel_binaryfile_session<Handler>::~parallel_binaryfile_session()
+{
+    stop();
+}
+
+template<typename Handler>
+bool parallel_binaryfile_session<Handler>::is_rth_timestamp(uint64_t timestamp)
+{
+    return _shards.front()->handler.is_rth_timestamp(timestamp);
+}
+
+template<typename Handler>
+void parallel_binaryfile_session<Handler>::subscribe(const std::string& symbol, size_t max_orders)
+{
+    // The shard that owns the symbol is known only after its directory
+    // message, so every shard subscribes to every symbol.
+    max_orders = sized_max_orders(symbol, max_orders);
+    for (auto&& s : _shards) {
+        s->handler.subscribe(symbol, max_orders);
+    }
+}
+
+template<typename Handler>
+void parallel_binaryfile_session<Handler>::register_callback(event_callback callback)
+{
+    for (auto&& s : _shards) {
+        s->handler.register_callback(callback);
+    }
+}
+
+template<typename Handler>
+void parallel_binaryfile_session<Handler>::set_send_callback(send_callback send_cb)
+{
+    throw std::invalid_argument("session does not support retransmission requests");
+}
+
+template<typename Handler>
+size_t parallel_binaryfile_session<Handler>::process_packet(const net::packet_view& packet)
+{
+    check_errors();
+    size_t offset = 0;
+    for (size_t nr_frames = 0; nr_frames < binaryfile_batch_size; nr_frames++) {
+        if (packet.len() - offset < sizeof(uint16_t)) {
+            break;
+        }
+        uint16_t payload_len = be16toh(*reinterpret_cast<const uint16_t*>(packet.buf() + offset));
+        if (!payload_len) {
+            if (offset) {
+                break;
+            }
+            // End of session.
+            drain();
+            return 0;
+        }
+        if (packet.len() - offset - sizeof(uint16_t) < payload_len) {
+            break;
+        }
+        route(packet.buf() + offset + sizeof(uint16_t), payload_len);
+        offset += sizeof(uint16_t) + payload_len;
+    }
+    if (!offset) {
+        throw truncated_packet_error("BinaryFILE frame is truncated");
+    }
+    publish();
+    return offset;
+}
+
+template<typename Handler>
+void parallel_binaryfile_session<Handler>::finish()
+{
+    stop();
+    check_errors();
+}
+
+template<typename Handler>
+void parallel_binaryfile_session<Handler>::stop()
+{
+    publish();
+    _stop.store(true, std::memory_order_release);
+    for (auto&& s : _shards) {
+        if (s->thread.joinable()) {
+            s->thread.join();
+        }
+    }
+}
+
+template<typename Handler>
+void parallel_binaryfile_session<Handler>::route(const char* payload, size_t len)
+{
+    if (len > binaryfile_message::max_len) {
+        throw std::runtime_error("BinaryFILE message is too large: " + std::to_string(len));
+    }
+    auto& s = *_shards[Handler::shard_key(net::packet_view{payload, len}) % _shards.size()];
+    binaryfile_message* msg;
+    while (!(msg = s.ring.try_alloc())) {
+        s.ring.publish();
+        check_errors();
+        std::this_thread::yield();
+    }
+    msg->len = len;
+    std::memcpy(msg->data, payload, len);
+}
+
+template<typename Handler>
+void parallel_binaryfile_session<Handler>::publish()
+{
+    for (auto&& s : _shards) {
+        s->ring.publish();
+    }
+}
+
+template<typename Handler>
+void parallel_binaryfile_session<Handler>::drain()
+{
+    publish();
+    for (auto&& s : _shards) {
+        while (!s->ring.empty()) {
+            std::this_thread::yield();
+        }
+    }
+    check_errors();
+}
+
+template<typename Handler>
+void parallel_binaryfile_session<Handler>::check_errors()
+{
+    for (auto&& s : _shards) {
+        if (s->failed.load(std::memory_order_acquire)) {
+            std::rethrow_exception(s->error);
+        }
+    }
+}
+
+template<typename Handler>
+void parallel_binaryfile_session<Handler>::run(shard& s)
+{
+    auto process = [&s](binaryfile_message& msg) {
+        if (s.failed.load(std::memory_order_relaxed)) {
+            return;
+        }
+        try {
+            size_t offset = 0;
+            while (offset < msg.len) {
+                size_t nr = s.handler.process_packet(net::packet_view{msg.data + offset, msg.len - offset});
+                if (!nr || nr > msg.len - offset) {
+                    throw std::runtime_error("payload overflow");
+                }
+                offset += nr;
+            }
+        } catch (...) {
+            s.error = std::current_exception();
+            s.failed.store(true, std::memory_order_release);
+        }
+    };
+    for (;;) {
+        if (s.ring.consume(process, binaryfile_batch_size)) {
+            continue;
+        }
+        if (_stop.load(std::memory_order_acquire)) {
+            // Process messages published before the session was stopped.
+            while (s.ring.consume(process, binaryfile_batch_size)) {
+            }
+            break;
+        }
+        std::this_thread::yield();
+    }
+}
+
+}
+
+}
@@ -1,14 +1,16 @@
 #pragma once
 
 #include "helix/nasdaq/itch50_messages.h"
+#include "helix/symbol_set.hh"
 #include "helix/order_book.hh"
+#include "helix/checkpoint.hh"
+#include "helix/pacer.hh"
 #include "helix/helix.hh"
 #include "helix/net.hh"
 
 #include <unordered_map>
 #include <vector>
 #include <memory>
-#include <set>
 
 namespace helix {
 
@@ -30,18 +32,26 @@ class itch50_handler {
 private:
     //! Callback function for processing events.
     event_callback _process_event;
+    //! Pacer of a real-time replay, or null if messages are not paced.
+    pacer* _pacer = nullptr;
     //! A map of order books by order book ID.
     std::unordered_map<uint64_t, helix::order_book> order_book_id_map;
-    //! A set of symbols that we are interested in.
-    std::set<std::string> _symbols;
-    //! A map of pre-allocation size by symbol.
-    std::unordered_map<std::string, size_t> _symbol_max_orders;
+    //! The symbols that we are interested in, with their pre-allocation size.
+    symbol_set<sizeof(itch50_stock_directory::Stock)> _subscriptions;
 public:
     itch50_handler();
     bool is_rth_timestamp(uint64_t timestamp) const;
     void subscribe(std::string sym, size_t max_orders);
     void register_callback(event_callback callback);
+    //! Pace messages with @p, or stop pacing them if @p is null.
+    void set_pacer(pacer* p);
     size_t process_packet(const net::packet_view& packet);
+    //! Write the order books to a checkpoint.
+    void save(checkpoint_writer& writer) const;
+    //! Restore the order books of subscribed symbols from a checkpoint.
+    void load(checkpoint_reader& reader);
+    //! Returns the key that parallel sessions shard messages by.
+    static uint64_t shard_key(const net::packet_view& packet);
 private:
     template<typename T>
     size_t process_msg(const net::packet_view& packet);
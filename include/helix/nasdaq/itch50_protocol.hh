@@ -14,6 +14,7 @@ public:
     explicit itch50_protocol(std::string name);
     static bool supports(const std::string& name);
     virtual session* new_session(void *) override;
+    virtual session* new_parallel_session(void *, size_t nr_threads) override;
 };
 
 }
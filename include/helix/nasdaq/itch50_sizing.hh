@@ -0,0 +1,22 @@
+#pragma once
+
+#include "helix/sizing_hints.hh"
+
+#include <cstddef>
+
+namespace helix {
+
+namespace nasdaq {
+
+//! Measure the peak order book sizes of every stock of the BinaryFILE in @buf.
+//
+// The scan simulates the live orders of every stock without building order
+// books: messages are told apart by their type and StockLocate, and only
+// order messages are decoded further, for the reference number, side,
+// price and shares that decide when an order leaves the book and how many
+// price levels there are. Everything else is skipped.
+sizing_hints itch50_scan_sizing(const char* buf, size_t len);
+
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "helix/helix.hh"
+
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace helix {
+
+namespace nasdaq {
+
+//! Number of runs ahead of the current one whose pages are prefetched
+//! during a sparse replay.
+constexpr size_t symbol_index_prefetch_distance = 32;
+
+//! Consecutive BinaryFILE frames of one stock.
+struct frame_run {
+    //! Offset of the first frame from the start of the file.
+    uint64_t offset;
+    //! Number of frames in the run.
+    uint64_t count;
+};
+
+// Per-stock message index of a NASDAQ TotalView-ITCH 5.0 BinaryFILE.
+//
+// Every ITCH 5.0 message carries the StockLocate of the stock it belongs
+// to. The index maps each StockLocate, in host byte order, to the symbol from its stock directory
+// message and to the frames of its messages, so that the messages of a few
+// symbols can be replayed without reading the rest of the file. Frames are
+// recorded as runs of consecutive frames, and the runs of a stock are
+// encoded as variable-length deltas of their offsets and their frame counts.
+// Messages with a zero StockLocate, such as system events, are not indexed.
+class itch50_symbol_index {
+    struct stock {
+        std::string symbol;
+        uint64_t nr_frames = 0;
+        uint64_t nr_runs = 0;
+        //! Encoded runs.
+        std::vector<uint8_t> runs;
+        //! Run that is still being extended while the index is built.
+        frame_run last = {0, 0};
+        //! Offset of the last encoded run, which the next run is encoded relative to.
+        uint64_t last_offset = 0;
+        //! Offset of the frame that follows the open run.
+        uint64_t next_offset = 0;
+    };
+    uint64_t _file_size = 0;
+    std::unordered_map<uint16_t, stock> _stocks;
+public:
+    //! Build an index of the BinaryFILE in @buf.
+    static itch50_symbol_index build(const char* buf, size_t len);
+
+    //! Read an index from a file.
+    static itch50_symbol_index load(const std::string& filename);
+
+    //! Write the index to a file.
+    void save(const std::string& filename) const;
+
+    //! Size of the indexed file.
+    uint64_t file_size() const {
+        return _file_size;
+    }
+
+    //! Returns the runs of frames of @symbols, ordered by offset. Throws
+    //! checkpoint_error if a symbol has no stock directory entry in the index.
+    std::vector<frame_run> runs(const std::vector<std::string>& symbols) const;
+
+private:
+    void add_frame(uint16_t stock_locate, uint64_t offset, uint64_t next_offset);
+    static void close_run(stock& s);
+};
+
+//! Replay the frames in @runs of the BinaryFILE in @buf through @s.
+//
+// The buffer is expected to be a memory-mapped file. The kernel is told not
+// to read ahead, since the frames of a few symbols are spread thinly over
+// the file, and the pages of upcoming runs are requested ahead of time
+// instead.
+void replay_runs(session& s, const char* buf, size_t len, const std::vector<frame_run>& runs);
+
+}
+
+}
@@ -0,0 +1,274 @@
+/*
+ * A/B feed line arbitration
+ *
+ * Exchanges send every MoldUDP packet on two redundant multicast lines. The
+ * arbitrated session accepts packets from both lines, forwards the first copy
+ * of every packet to the underlying session and drops the other copy, so a
+ * packet lost on one line is usually recovered from the other line without a
+ * retransmission request. Gaps are requested only if the other line has not
+ * filled them within a short delay.
+ *
+ * Packets are deduplicated by their first sequence number with a bitmap that
+ * covers a window of sequence numbers below the highest one seen. Packets
+ * below the window are forwarded and left to the session, which drops
+ * messages it has already processed. Heartbeats carry no messages and are
+ * not marked in the window. Packets that are not received on a feed line,
+ * such as retransmissions, are passed to process_packet() and bypass the
+ * arbitration.
+ */
+
+#pragma once
+
+#include "helix/helix.hh"
+#include "helix/net.hh"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <memory>
+
+namespace helix {
+
+namespace nasdaq {
+
+//! Number of feed lines an arbitrated session accepts.
+constexpr size_t arbitration_nr_lines = 2;
+
+//! Number of sequence numbers in the deduplication window.
+constexpr size_t arbitration_window_size = 8192;
+
+//! Time to wait for the other line to fill a gap before it is requested.
+constexpr std::chrono::microseconds arbitration_request_delay{100};
+
+template<typename Session>
+class arbitrated_session : public session {
+    using clock_type = std::chrono::steady_clock;
+
+    static constexpr size_t bits_per_word = 64;
+    static constexpr uint64_t window_mask = arbitration_window_size - 1;
+
+    Session _session;
+    //! Sequence numbers in the window whose packet has arrived.
+    uint64_t _seen[arbitration_window_size / bits_per_word] = {};
+    //! Arrival time of the first copy of a packet, in nanoseconds.
+    std::unique_ptr<int64_t[]> _arrival;
+    //! Line that delivered the first copy of a packet.
+    std::unique_ptr<uint8_t[]> _winner;
+    //! Highest first sequence number seen on any line.
+    uint64_t _high_seq_no = 0;
+    //! Sequence number that follows the last packet seen on a line.
+    uint64_t _next_seq_no[arbitration_nr_lines] = {};
+    line_stats _stats[arbitration_nr_lines];
+public:
+    explicit arbitrated_session(void* data);
+
+    virtual bool is_rth_timestamp(uint64_t timestamp) override;
+
+    virtual void subscribe(const std::string& symbol, size_t max_orders) override;
+
+    virtual void register_callback(event_callback callback) override;
+
+    virtual void set_send_callback(send_callback callback) override;
+
+    virtual size_t process_packet(const net::packet_view& packet) override;
+
+    virtual size_t process_line_packet(size_t line, const net::packet_view& packet) override;
+
+    virtual line_stats get_line_stats(size_t line) const override;
+
+    virtual void set_retransmit_config(const retransmit_config& config) override;
+
+    virtual retransmit_stats get_retransmit_stats() const override;
+
+    virtual void poll_retransmit() override;
+
+    virtual void set_pacing_config(const pacing_config& config) override;
+
+    virtual pacing_stats get_pacing_stats() const override;
+
+    virtual uint64_t position() const override;
+
+    virtual void save_checkpoint(checkpoint_writer& writer) const override;
+
+    virtual void load_checkpoint(checkpoint_reader& reader) override;
+
+private:
+    //! Mark a sequence number seen, returns false if it already was.
+    bool mark(uint64_t seq_no);
+    void advance(uint64_t seq_no);
+};
+
+template<typename Session>
+arbitrated_session<Session>::arbitrated_session(void* data)
+    : session{data}
+    , _session{data}
+    , _arrival{new int64_t[arbitration_window_size]}
+    , _winner{new uint8_t[arbitration_window_size]}
+{
+    set_retransmit_config(retransmit_config{});
+}
+
+template<typename Session>
+bool arbitrated_session<Session>::is_rth_timestamp(uint64_t timestamp)
+{
+    return _session.is_rth_timestamp(timestamp);
+}
+
+template<typename Session>
+void arbitrated_session<Session>::subscribe(const std::string& symbol, size_t max_orders)
+{
+    _session.subscribe(symbol, sized_max_orders(symbol, max_orders));
+}
+
+template<typename Session>
+void arbitrated_session<Session>::register_callback(event_callback callback)
+{
+    _session.register_callback(callback);
+}
+
+template<typename Session>
+void arbitrated_session<Session>::set_send_callback(send_callback send_cb)
+{
+    _session.set_send_callback(send_cb);
+}
+
+template<typename Session>
+size_t arbitrated_session<Session>::process_packet(const net::packet_view& packet)
+{
+    return _session.process_packet(packet);
+}
+
+template<typename Session>
+size_t arbitrated_session<Session>::process_line_packet(size_t line, const net::packet_view& packet)
+{
+    if (line >= arbitration_nr_lines) {
+        throw std::invalid_argument("invalid feed line: " + std::to_string(line));
+    }
+    uint64_t seq_no, message_count;
+    if (!Session::sequence_range(packet, seq_no, message_count)) {
+        return _session.process_packet(packet);
+    }
+    auto& stats = _stats[line];
+    stats.packets++;
+    auto& next_seq_no = _next_seq_no[line];
+    if (next_seq_no && next_seq_no < seq_no) {
+        stats.lost_messages += seq_no - next_seq_no;
+    }
+    next_seq_no = std::max(next_seq_no, seq_no + message_count);
+    if (!message_count || seq_no + arbitration_window_size <= _high_seq_no) {
+        stats.forwarded++;
+        return _session.process_packet(packet);
+    }
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now().time_since_epoch()).count();
+    auto slot = seq_no & window_mask;
+    if (!mark(seq_no)) {
+        uint64_t lag = now - _arrival[slot];
+        stats.duplicates++;
+        stats.lag_ns += lag;
+        stats.max_lag_ns = std::max(stats.max_lag_ns, lag);
+        _stats[_winner[slot]].lead_ns += lag;
+        return packet.len();
+    }
+    _arrival[slot] = now;
+    _winner[slot] = line;
+    stats.forwarded++;
+    return _session.process_packet(packet);
+}
+
+template<typename Session>
+line_stats arbitrated_session<Session>::get_line_stats(size_t line) const
+{
+    if (line >= arbitration_nr_lines) {
+        throw std::invalid_argument("invalid feed line: " + std::to_string(line));
+    }
+    return _stats[line];
+}
+
+template<typename Session>
+void arbitrated_session<Session>::set_retransmit_config(const retransmit_config& config)
+{
+    // Gaps are requested only after the other line had a chance to fill them.
+    auto arbitrated_config = config;
+    arbitrated_config.delay = std::max(config.delay, arbitration_request_delay);
+    _session.set_retransmit_config(arbitrated_config);
+}
+
+template<typename Session>
+retransmit_stats arbitrated_session<Session>::get_retransmit_stats() const
+{
+    return _session.get_retransmit_stats();
+}
+
+template<typename Session>
+void arbitrated_session<Session>::poll_retransmit()
+{
+    _session.poll_retransmit();
+}
+
+template<typename Session>
+void arbitrated_session<Session>::set_pacing_config(const pacing_config& config)
+{
+    _session.set_pacing_config(config);
+}
+
+template<typename Session>
+pacing_stats arbitrated_session<Session>::get_pacing_stats() const
+{
+    return _session.get_pacing_stats();
+}
+
+template<typename Session>
+uint64_t arbitrated_session<Session>::position() const
+{
+    return _session.position();
+}
+
+template<typename Session>
+void arbitrated_session<Session>::save_checkpoint(checkpoint_writer& writer) const
+{
+    _session.save_checkpoint(writer);
+}
+
+template<typename Session>
+void arbitrated_session<Session>::load_checkpoint(checkpoint_reader& reader)
+{
+    _session.load_checkpoint(reader);
+}
+
+template<typename Session>
+bool arbitrated_session<Session>::mark(uint64_t seq_no)
+{
+    if (seq_no > _high_seq_no) {
+        advance(seq_no);
+    }
+    auto slot = seq_no & window_mask;
+    auto& word = _seen[slot / bits_per_word];
+    uint64_t bit = uint64_t(1) << (slot % bits_per_word);
+    if (word & bit) {
+        return false;
+    }
+    word |= bit;
+    return true;
+}
+
+template<typename Session>
+void arbitrated_session<Session>::advance(uint64_t seq_no)
+{
+    // Clear the slots of the sequence numbers that enter the window, which
+    // still hold marks from the previous lap around the window.
+    if (seq_no - _high_seq_no >= arbitration_window_size) {
+        std::fill(std::begin(_seen), std::end(_seen), 0);
+    } else {
+        for (uint64_t s = _high_seq_no + 1; s <= seq_no; s++) {
+            auto slot = s & window_mask;
+            _seen[slot / bits_per_word] &= ~(uint64_t(1) << (slot % bits_per_word));
+        }
+    }
+    _high_seq_no = seq_no;
+}
+
+}
+
+}
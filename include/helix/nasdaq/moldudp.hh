@@ -18,91 +18,64 @@
 #pragma once
 
 #include "helix/nasdaq/moldudp_messages.h"
-#include "helix/helix.hh"
+#include "helix/nasdaq/sequenced_session.hh"
 #include "helix/net.hh"
 
-#include <string>
+#include <cstdint>
 
 namespace helix {
 
 namespace nasdaq {
 
-template<typename Handler>
-class moldudp_session : public session {
-    Handler _handler;
-    uint32_t _seq_num;
-public:
-    explicit moldudp_session(void* data);
-
-    virtual bool is_rth_timestamp(uint64_t timestamp) override;
-
-    virtual void subscribe(const std::string& symbol, size_t max_orders) override;
-
-    virtual void register_callback(event_callback callback) override;
+//! Message count of an end of session packet.
+constexpr uint16_t moldudp_end_of_session = 0xffff;
 
-    virtual void set_send_callback(send_callback callback) override;
+//! Maximum number of messages in a retransmission request.
+constexpr uint16_t moldudp_max_request_count = 0xfffe;
 
-    virtual size_t process_packet(const net::packet_view& packet) override;
+// MoldUDP framing.
+//
+// Header fields are in the byte order of the Nordic feed and are used as is.
+struct moldudp_framing {
+    using header_type = moldudp_header;
+    using message_block_type = moldudp_message_block;
+    using request_packet_type = moldudp_request_packet;
 
-};
-
-template<typename Handler>
-moldudp_session<Handler>::moldudp_session(void* data)
-    : session{data}
-    , _seq_num{1}
-{
-}
+    static constexpr uint16_t max_request_count = moldudp_max_request_count;
 
-template<typename Handler>
-bool moldudp_session<Handler>::is_rth_timestamp(uint64_t timestamp)
-{
-    return _handler.is_rth_timestamp(timestamp);
-}
-
-template<typename Handler>
-void moldudp_session<Handler>::subscribe(const std::string& symbol, size_t max_orders)
-{
-    _handler.subscribe(symbol, max_orders);
-}
-
-template<typename Handler>
-void moldudp_session<Handler>::register_callback(event_callback callback)
-{
-    _handler.register_callback(callback);
-}
-
-template<typename Handler>
-void moldudp_session<Handler>::set_send_callback(send_callback send_cb)
-{
-}
-
-template<typename Handler>
-size_t moldudp_session<Handler>::process_packet(const net::packet_view& packet)
-{
-    auto* p = packet.buf();
-    if (packet.len() < sizeof(moldudp_header)) {
-        throw truncated_packet_error("MoldUDP header is truncated");
+    static const char* name() {
+        return "MoldUDP";
     }
-    auto* header = packet.cast<moldudp_header>();
-    if (header->SequenceNumber != _seq_num) {
-        throw std::runtime_error(std::string("invalid sequence number: ") + std::to_string(header->SequenceNumber) + ", expected: " + std::to_string(_seq_num));
+
+    static const char* checkpoint_tag() {
+        return "moldudp";
     }
-    p += sizeof(moldudp_header);
 
-    for (int i = 0; i < header->MessageCount; i++) {
-        auto* msg_block = reinterpret_cast<const moldudp_message_block*>(p);
+    static uint64_t sequence_number(const moldudp_header& header) {
+        return header.SequenceNumber;
+    }
 
-        p += sizeof(moldudp_message_block);
+    static uint64_t message_count(const moldudp_header& header) {
+        return header.MessageCount == moldudp_end_of_session ? 0 : header.MessageCount;
+    }
 
-        _handler.process_packet(net::packet_view{p, msg_block->MessageLength});
+    static uint16_t message_length(const moldudp_message_block& block) {
+        return block.MessageLength;
+    }
 
-        p += msg_block->MessageLength;
+    static void request(moldudp_request_packet& request, uint64_t seq_no, uint64_t message_count) {
+        request.SequenceNumber = seq_no;
+        request.MessageCount = message_count;
+    }
 
-        _seq_num++;
+    template<typename Handler>
+    static void process_message(Handler& handler, const net::packet_view& message, bool sync) {
+        handler.process_packet(message);
     }
+};
 
-    return p - packet.buf();
-}
+template<typename Handler>
+using moldudp_session = sequenced_session<moldudp_framing, Handler>;
 
 }
 
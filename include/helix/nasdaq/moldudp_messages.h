@@ -34,6 +34,12 @@ struct moldudp_message_block {
     uint16_t MessageLength;
 } __attribute__ ((packed));
 
+struct moldudp_request_packet {
+    char     Session[10];
+    uint32_t SequenceNumber;
+    uint16_t MessageCount;
+} __attribute__ ((packed));
+
 #ifdef __cplusplus
 }
 #endif
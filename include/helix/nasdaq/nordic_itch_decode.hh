@@ -0,0 +1,139 @@
+#pragma once
+
+#include "helix/nasdaq/nordic_itch_messages.h"
+
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+namespace helix {
+
+namespace nasdaq {
+
+// Nordic ITCH numeric field decoding.
+//
+// Numeric fields in Nordic ITCH messages are fixed-width ASCII, right-justified
+// and padded with leading spaces. The decoder loads a field into a 16-byte
+// lane so that it is right-aligned, clears everything that is not a digit
+// (padding spaces and the bytes shifted in), and then folds the digits
+// together with multiply-add instructions: pairs of digits into 2-digit
+// values, those into 4-digit and 8-digit values, and finally the two 8-digit
+// halves into the result. With AVX2, two fields are decoded in one 256-bit
+// pass, which covers the field pairs that handlers need together (e.g. order
+// reference number and quantity). Without SSSE3, which the baseline x86-64
+// target lacks unless Helix is built with HELIX_NATIVE, the decoder falls back
+// to itch_uatoi().
+
+constexpr size_t itch_lane_size = 16;
+
+#if defined(__SSSE3__)
+
+//! Load a field of at least eight bytes right-aligned into a lane with two
+//! 8-byte loads of its first and last eight bytes, which overlap for fields
+//! shorter than a lane.
+template<size_t N>
+inline __m128i itch_load_lane(const char (&field)[N], std::true_type)
+{
+    __m128i head = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(field));
+    __m128i tail = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(field + N - 8));
+    return _mm_or_si128(_mm_slli_si128(head, itch_lane_size - N), _mm_slli_si128(tail, 8));
+}
+
+//! Load a field of less than eight bytes right-aligned into a lane.
+template<size_t N>
+inline __m128i itch_load_lane(const char (&field)[N], std::false_type)
+{
+    uint64_t word = 0;
+    std::memcpy(&word, field, N);
+    return _mm_slli_si128(_mm_set_epi64x(0, word), itch_lane_size - N);
+}
+
+//! Load a field right-aligned into a lane.
+//
+// The field is loaded with loads that stay within it, so that decoding never
+// reads past the end of the field, and of the packet that it is in.
+template<size_t N>
+inline __m128i itch_load_lane(const char (&field)[N])
+{
+    static_assert(N <= itch_lane_size, "field does not fit in a lane");
+    return itch_load_lane(field, std::integral_constant<bool, (N >= 8)>{});
+}
+
+inline uint64_t itch_join_halves(uint32_t hi, uint32_t lo)
+{
+    return uint64_t(hi) * 100000000 + lo;
+}
+
+inline __m128i itch_fold_digits(__m128i v)
+{
+    v = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    // Spaces and zero bytes wrap around to values above nine, clear them.
+    v = _mm_and_si128(v, _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(9)), v));
+    v = _mm_maddubs_epi16(v, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    v = _mm_madd_epi16(v, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    v = _mm_packs_epi32(v, v);
+    return _mm_madd_epi16(v, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+}
+
+inline uint64_t itch_decode_lane(__m128i v)
+{
+    v = itch_fold_digits(v);
+    return itch_join_halves(_mm_cvtsi128_si32(v), _mm_cvtsi128_si32(_mm_srli_si128(v, 4)));
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+inline void itch_decode_lanes(__m256i v, uint64_t& x, uint64_t& y)
+{
+    v = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    v = _mm256_and_si256(v, _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(9)), v));
+    v = _mm256_maddubs_epi16(v, _mm256_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1,
+                                                 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    v = _mm256_madd_epi16(v, _mm256_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1, 100, 1, 100, 1, 100, 1, 100, 1));
+    v = _mm256_packs_epi32(v, v);
+    v = _mm256_madd_epi16(v, _mm256_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1,
+                                               10000, 1, 10000, 1, 10000, 1, 10000, 1));
+    __m128i lo = _mm256_castsi256_si128(v);
+    __m128i hi = _mm256_extracti128_si256(v, 1);
+    x = itch_join_halves(_mm_cvtsi128_si32(lo), _mm_cvtsi128_si32(_mm_srli_si128(lo, 4)));
+    y = itch_join_halves(_mm_cvtsi128_si32(hi), _mm_cvtsi128_si32(_mm_srli_si128(hi, 4)));
+}
+
+#endif
+
+//! Decode a fixed-width ASCII numeric field.
+template<size_t N>
+inline uint64_t itch_decode(const char (&field)[N])
+{
+#if defined(__SSSE3__)
+    return itch_decode_lane(itch_load_lane(field));
+#else
+    return itch_uatoi(field, N);
+#endif
+}
+
+//! Decode two fixed-width ASCII numeric fields of a message in one pass.
+template<size_t N, size_t M>
+inline void itch_decode(const char (&a)[N], uint64_t& x, const char (&b)[M], uint64_t& y)
+{
+#if defined(__AVX2__)
+    auto v = _mm256_inserti128_si256(_mm256_castsi128_si256(itch_load_lane(a)), itch_load_lane(b), 1);
+    itch_decode_lanes(v, x, y);
+#else
+    x = itch_decode(a);
+    y = itch_decode(b);
+#endif
+}
+
+}
+
+}
@@ -1,14 +1,17 @@
 #pragma once
 
 #include "helix/nasdaq/nordic_itch_messages.h"
+#include "helix/incremental_map.hh"
+#include "helix/symbol_set.hh"
 #include "helix/order_book.hh"
+#include "helix/checkpoint.hh"
+#include "helix/pacer.hh"
 #include "helix/helix.hh"
 #include "helix/net.hh"
 
 #include <unordered_map>
 #include <vector>
 #include <memory>
-#include <set>
 
 namespace helix {
 
@@ -23,8 +26,8 @@ namespace nasdaq {
 // The feed handler reconstructs a full depth order book from a ITCH message
 // flow using an algorithm that is specified in Appendix A of the protocol
 // specification. As not all messages include an order book ID, the handler
-// keeps mapping from every order ID it encounters to the order book the order
-// is part of.
+// keeps mapping from the ID of every order in an order book to the book, for
+// as long as the order is in it.
 //
 // The ITCH variant processed by this feed handler is specified by NASDAQ OMX
 // in:
@@ -40,20 +43,28 @@ class nordic_itch_handler {
     uint64_t time_msec;
     //! Callback function for processing events.
     event_callback _process_event;
+    //! Pacer of a real-time replay, or null if messages are not paced.
+    pacer* _pacer = nullptr;
     //! A map of order books by order book ID.
     std::unordered_map<uint64_t, helix::order_book> order_book_id_map;
-    //! A map of order books by order ID.
-    std::unordered_map<uint64_t, helix::order_book&> order_id_map;
-    //! A set of symbols that we are interested in.
-    std::set<std::string> _symbols;
-    //! A map of pre-allocation size by symbol.
-    std::unordered_map<std::string, size_t> _symbol_max_orders;
+    //! A map of order books by the ID of every order that is in one.
+    helix::incremental_map<uint64_t, helix::order_book&> order_id_map;
+    //! The symbols that we are interested in, with their pre-allocation size.
+    symbol_set<sizeof(itch_order_book_directory::Symbol)> _subscriptions;
 public:
     nordic_itch_handler();
     bool is_rth_timestamp(uint64_t timestamp) const;
     void subscribe(std::string sym, size_t max_orders);
     void register_callback(event_callback callback);
+    //! Pace messages with @p, or stop pacing them if @p is null.
+    void set_pacer(pacer* p);
     size_t process_packet(const net::packet_view& packet);
+    //! Process a batch of messages that are already framed.
+    void process_packets(const net::packet_view* packets, size_t count);
+    //! Write the order books and the time of day to a checkpoint.
+    void save(checkpoint_writer& writer) const;
+    //! Restore the order books of subscribed symbols and the time of day from a checkpoint.
+    void load(checkpoint_reader& reader);
 private:
     template<typename T>
     size_t process_msg(const net::packet_view& packet);
@@ -14,6 +14,7 @@ public:
     static bool supports(const std::string& name);
     explicit nordic_itch_protocol(std::string name);
     virtual session* new_session(void *) override;
+    virtual session* new_arbitrated_session(void *) override;
 };
 
 }
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "helix/net.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace helix {
+
+namespace nasdaq {
+
+//! Number of packets a reorder buffer holds.
+constexpr size_t reorder_buffer_capacity = 1024;
+
+//! Maximum size of a packet in a reorder buffer.
+constexpr size_t reorder_buffer_packet_size = 2048;
+
+// Reorder buffer for sequenced packets.
+//
+// A MoldUDP session that detects a gap keeps packets that arrive ahead of the
+// expected sequence number in the reorder buffer while the missing packets
+// are retransmitted, and applies them as soon as the gap closes. Packets are
+// copied into buffers that are allocated the first time the reorder buffer
+// holds that many packets and reused afterwards, so a session only pays for
+// the deepest gap it has seen, and buffering allocates no memory once that
+// depth has been reached. Buffered packets are kept ordered by their first
+// sequence number in a ring of buffer indices, so that the first packet is
+// removed in constant time; as packets mostly arrive in order, new packets
+// are usually appended.
+class reorder_buffer {
+    struct entry {
+        uint64_t seq_no;
+        uint64_t end_seq_no;
+        size_t   len;
+    };
+    size_t _capacity;
+    size_t _packet_size;
+    //! Packet buffers allocated so far.
+    std::vector<std::unique_ptr<char[]>> _packets;
+    std::vector<entry> _entries;
+    //! Ring of the indices of used entries, ordered by sequence number.
+    std::vector<uint32_t> _order;
+    size_t _head = 0;
+    size_t _size = 0;
+    //! Indices of allocated entries that are free.
+    std::vector<uint32_t> _free;
+public:
+    explicit reorder_buffer(size_t capacity = reorder_buffer_capacity, size_t packet_size = reorder_buffer_packet_size)
+        : _capacity{capacity}
+        , _packet_size{packet_size}
+        , _entries(capacity)
+        , _order(capacity)
+    {
+        _packets.reserve(capacity);
+        _free.reserve(capacity);
+    }
+
+    bool empty() const {
+        return !_size;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    //! Sequence number of the first buffered packet.
+    uint64_t first_seq_no() const {
+        return _entries[_order[_head]].seq_no;
+    }
+
+    //! Sequence number that follows the first buffered packet.
+    uint64_t first_end_seq_no() const {
+        return _entries[_order[_head]].end_seq_no;
+    }
+
+    //! Returns the first buffered packet.
+    net::packet_view first() const {
+        auto idx = _order[_head];
+        return net::packet_view{_packets[idx].get(), _entries[idx].len};
+    }
+
+    //! Remove the first buffered packet.
+    void pop_first() {
+        _free.push_back(_order[_head]);
+        _head = slot(1);
+        _size--;
+    }
+
+    //! Remove every buffered packet.
+    void clear() {
+        while (_size) {
+            pop_first();
+        }
+        _head = 0;
+    }
+
+    //! Call @fn for every range of sequence numbers from @seq_no up to
+    //! @end_seq_no that no buffered packet covers.
+    template<typename Fn>
+    void for_each_gap(uint64_t seq_no, uint64_t end_seq_no, Fn&& fn) const {
+        for (size_t i = 0; i < _size; i++) {
+            auto& e = _entries[_order[slot(i)]];
+            if (e.seq_no >= end_seq_no) {
+                break;
+            }
+            if (seq_no < e.seq_no) {
+                fn(seq_no, e.seq_no);
+            }
+            seq_no = std::max(seq_no, e.end_seq_no);
+        }
+        if (seq_no < end_seq_no) {
+            fn(seq_no, end_seq_no);
+        }
+    }
+
+    //! Buffer a packet that carries messages from @seq_no up to @end_seq_no.
+    //
+    // Returns false if the packet was not buffered because the buffer is full,
+    // the packet is too large, or a packet with the same sequence number is
+    // already buffered.
+    bool insert(uint64_t seq_no, uint64_t end_seq_no, const net::packet_view& packet) {
+        if (_size == _capacity || packet.len() > _packet_size) {
+            return false;
+        }
+        size_t pos = _size;
+        while (pos > 0 && _entries[_order[slot(pos - 1)]].seq_no > seq_no) {
+            --pos;
+        }
+        if (pos > 0 && _entries[_order[slot(pos - 1)]].seq_no == seq_no) {
+            return false;
+        }
+        uint32_t idx;
+        if (!_free.empty()) {
+            idx = _free.back();
+            _free.pop_back();
+        } else {
+            idx = _packets.size();
+            _packets.emplace_back(new char[_packet_size]);
+        }
+        _entries[idx] = entry{seq_no, end_seq_no, packet.len()};
+        std::memcpy(_packets[idx].get(), packet.buf(), packet.len());
+        // Shift the packets that follow the new one towards the tail.
+        for (size_t i = _size; i > pos; i--) {
+            _order[slot(i)] = _order[slot(i - 1)];
+        }
+        _order[slot(pos)] = idx;
+        _size++;
+        return true;
+    }
+private:
+    //! Returns the ring slot of the @i:th buffered packet.
+    size_t slot(size_t i) const {
+        i += _head;
+        return i < _capacity ? i : i - _capacity;
+    }
+};
+
+}
+
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "helix/helix.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <vector>
+
+namespace helix {
+
+namespace nasdaq {
+
+//! Maximum number of ranges a retransmit scheduler tracks.
+constexpr size_t retransmit_max_ranges = 1024;
+
+// Retransmission request scheduler.
+//
+// A MoldUDP session in gap fill reports the ranges of messages it is missing
+// every time it processes a packet. The scheduler coalesces gaps that are
+// close to each other into one range and requests every range once. A range
+// is in flight until the messages in it arrive; it is requested again only
+// after a timeout, which doubles on every attempt, so a session never sends
+// the same request twice within the timeout no matter how many packets it
+// processes in the meantime. New ranges can be held back for a delay before
+// they are first requested, so that a redundant feed line can fill them.
+class retransmit_scheduler {
+public:
+    using clock_type = std::chrono::steady_clock;
+private:
+    struct range {
+        uint64_t begin;
+        uint64_t end;
+        clock_type::time_point deadline;
+        clock_type::duration timeout;
+    };
+    uint64_t _max_request_count;
+    retransmit_config _config;
+    retransmit_stats _stats;
+    //! Missing ranges reported by the session, ordered and coalesced.
+    std::vector<range> _gaps;
+    //! Requested ranges, ordered by sequence number.
+    std::vector<range> _in_flight;
+    std::vector<range> _scratch;
+public:
+    explicit retransmit_scheduler(uint64_t max_request_count)
+        : _max_request_count{max_request_count}
+    {
+        _gaps.reserve(retransmit_max_ranges);
+        _in_flight.reserve(retransmit_max_ranges);
+        _scratch.reserve(retransmit_max_ranges);
+    }
+
+    void configure(const retransmit_config& config) {
+        _config = config;
+    }
+
+    const retransmit_stats& stats() const {
+        return _stats;
+    }
+
+    //! Start reporting missing ranges.
+    void begin() {
+        _gaps.clear();
+    }
+
+    //! Report a range of missing messages. Ranges are reported in order.
+    void add_gap(uint64_t begin, uint64_t end) {
+        if (!_gaps.empty() && begin - _gaps.back().end <= _config.coalesce_distance) {
+            _gaps.back().end = end;
+            return;
+        }
+        if (_gaps.size() == retransmit_max_ranges) {
+            // Too many gaps, request the rest with the last range.
+            _gaps.back().end = end;
+            return;
+        }
+        _gaps.push_back(range{begin, end, {}, {}});
+    }
+
+    //! Record a received packet that carries messages from @begin up to @end.
+    void received(uint64_t begin, uint64_t end) {
+        for (auto&& r : _in_flight) {
+            if (r.begin >= end) {
+                break;
+            }
+            if (begin < r.end && r.timeout != clock_type::duration::zero()) {
+                _stats.responses++;
+                _stats.recovered_messages += std::min(end, r.end) - std::max(begin, r.begin);
+                return;
+            }
+        }
+    }
+
+    //! Request the reported ranges that are not in flight and the ranges
+    //! whose timeout has expired.
+    template<typename Send>
+    void schedule(clock_type::time_point now, Send&& send) {
+        _scratch.clear();
+        auto it = _in_flight.begin();
+        for (auto&& gap : _gaps) {
+            uint64_t pos = gap.begin;
+            // Ranges that no longer overlap a gap have been filled.
+            while (it != _in_flight.end() && it->end <= gap.begin) {
+                ++it;
+            }
+            for (; it != _in_flight.end() && it->begin < gap.end; ++it) {
+                auto r = *it;
+                if (pos < r.begin) {
+                    request(pos, r.begin, now, send);
+                }
+                r.begin = std::max(r.begin, gap.begin);
+                r.end = std::min(r.end, gap.end);
+                if (now >= r.deadline) {
+                    if (r.timeout == clock_type::duration::zero()) {
+                        // The delay of a new range has passed.
+                        r.timeout = _config.timeout;
+                    } else {
+                        r.timeout = std::min<clock_type::duration>(r.timeout * 2, _config.max_timeout);
+                    }
+                    r.deadline = now + r.timeout;
+                    send(r.begin, r.end - r.begin);
+                    _stats.requests++;
+                    _stats.requested_messages += r.end - r.begin;
+                }
+                push(r);
+                pos = std::max(pos, it->end);
+                if (it->end > gap.end) {
+                    break;
+                }
+            }
+            if (pos < gap.end) {
+                request(pos, gap.end, now, send);
+            }
+        }
+        _in_flight.swap(_scratch);
+    }
+
+    //! Forget ranges in flight after the session has caught up.
+    void reset() {
+        _gaps.clear();
+        _in_flight.clear();
+    }
+
+private:
+    void push(const range& r) {
+        if (_scratch.size() < retransmit_max_ranges) {
+            _scratch.push_back(r);
+        }
+    }
+
+    template<typename Send>
+    void request(uint64_t begin, uint64_t end, clock_type::time_point now, Send&& send) {
+        while (begin < end) {
+            uint64_t count = std::min(end - begin, _max_request_count);
+            if (_config.delay > clock_type::duration::zero()) {
+                // Track the range, but request it only after the delay.
+                push(range{begin, begin + count, now + _config.delay, clock_type::duration::zero()});
+            } else {
+                clock_type::duration timeout = _config.timeout;
+                push(range{begin, begin + count, now + timeout, timeout});
+                send(begin, count);
+                _stats.requests++;
+                _stats.requested_messages += count;
+            }
+            begin += count;
+        }
+    }
+};
+
+}
+
+}
@@ -0,0 +1,321 @@
+/*
+ * Sequenced packet session
+ *
+ * MoldUDP and MoldUDP64 frame messages the same way and differ only in the
+ * width and byte order of their header fields. The session that tracks the
+ * expected sequence number, buffers packets that arrive ahead of it and
+ * requests the missing messages is shared by both, and a framing type
+ * supplies the protocol:
+ *
+ *   header_type, message_block_type, request_packet_type
+ *   name()                     protocol name for error messages
+ *   checkpoint_tag()           tag of the session state in a checkpoint
+ *   max_request_count          maximum number of messages in a request
+ *   sequence_number(header)    first sequence number of a packet
+ *   message_count(header)      number of messages, 0 at end of session
+ *   message_length(block)      length of a message
+ *   request(request, seq_no, message_count)
+ *                              fill in the fields of a request
+ *   process_message(handler, message, sync)
+ *                              pass a message to the handler
+ */
+
+#pragma once
+
+#include "helix/nasdaq/retransmit_scheduler.hh"
+#include "helix/nasdaq/reorder_buffer.hh"
+#include "helix/pacer.hh"
+#include "helix/helix.hh"
+#include "helix/net.hh"
+
+#include <sys/types.h>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <string>
+
+namespace helix {
+
+namespace nasdaq {
+
+enum class sequenced_session_state {
+    synchronized,
+    gap_fill,
+};
+
+// Session of a sequenced packet feed.
+//
+// When the session detects a gap, it buffers packets that arrive ahead of
+// sequence, requests the missing messages through the send callback and
+// applies the buffered packets once the gap closes.
+template<typename Framing, typename Handler>
+class sequenced_session : public session {
+    using header_type = typename Framing::header_type;
+    using message_block_type = typename Framing::message_block_type;
+    using request_packet_type = typename Framing::request_packet_type;
+
+    Handler _handler;
+    //! Pacer of a real-time replay.
+    pacer _pacer;
+    send_callback _send_cb;
+    uint64_t _expected_seq_no = 1;
+    sequenced_session_state _state = sequenced_session_state::synchronized;
+    //! Sequence number that the session has to reach to leave gap fill.
+    uint64_t _sync_to_seq_no = 0;
+    //! Packets received ahead of the expected sequence number.
+    reorder_buffer _reorder;
+    retransmit_scheduler _retransmit{Framing::max_request_count};
+    char _session[10] = {};
+public:
+    explicit sequenced_session(void* data);
+
+    //! Parse the range of message sequence numbers that a packet carries.
+    static bool sequence_range(const net::packet_view& packet, uint64_t& seq_no, uint64_t& message_count);
+
+    virtual bool is_rth_timestamp(uint64_t timestamp) override;
+
+    virtual void subscribe(const std::string& symbol, size_t max_orders) override;
+
+    virtual void register_callback(event_callback callback) override;
+
+    virtual void set_send_callback(send_callback callback) override;
+
+    virtual size_t process_packet(const net::packet_view& packet) override;
+
+    virtual void set_retransmit_config(const retransmit_config& config) override;
+
+    virtual retransmit_stats get_retransmit_stats() const override;
+
+    virtual void poll_retransmit() override;
+
+    virtual void set_pacing_config(const pacing_config& config) override;
+
+    virtual pacing_stats get_pacing_stats() const override;
+
+    virtual uint64_t position() const override;
+
+    virtual void save_checkpoint(checkpoint_writer& writer) const override;
+
+    virtual void load_checkpoint(checkpoint_reader& reader) override;
+
+private:
+    //! Process the messages from @seq_no of a packet that have not been processed yet.
+    size_t process_messages(const net::packet_view& packet, uint64_t seq_no, uint64_t message_count);
+    //! Process buffered packets up to the next gap.
+    void process_buffered();
+    //! Request the messages that are missing, unless they are already requested.
+    void request_gaps();
+    void retransmit_request(uint64_t seq_no, uint64_t message_count);
+};
+
+template<typename Framing, typename Handler>
+sequenced_session<Framing, Handler>::sequenced_session(void* data)
+    : session{data}
+{
+}
+
+template<typename Framing, typename Handler>
+bool sequenced_session<Framing, Handler>::sequence_range(const net::packet_view& packet, uint64_t& seq_no, uint64_t& message_count)
+{
+    if (packet.len() < sizeof(header_type)) {
+        return false;
+    }
+    auto* header = packet.cast<header_type>();
+    seq_no = Framing::sequence_number(*header);
+    message_count = Framing::message_count(*header);
+    return true;
+}
+
+template<typename Framing, typename Handler>
+bool sequenced_session<Framing, Handler>::is_rth_timestamp(uint64_t timestamp)
+{
+    return _handler.is_rth_timestamp(timestamp);
+}
+
+template<typename Framing, typename Handler>
+void sequenced_session<Framing, Handler>::subscribe(const std::string& symbol, size_t max_orders)
+{
+    _handler.subscribe(symbol, sized_max_orders(symbol, max_orders));
+}
+
+template<typename Framing, typename Handler>
+void sequenced_session<Framing, Handler>::register_callback(event_callback callback)
+{
+    _handler.register_callback(callback);
+}
+
+template<typename Framing, typename Handler>
+void sequenced_session<Framing, Handler>::set_send_callback(send_callback send_cb)
+{
+    _send_cb = send_cb;
+}
+
+template<typename Framing, typename Handler>
+void sequenced_session<Framing, Handler>::set_retransmit_config(const retransmit_config& config)
+{
+    _retransmit.configure(config);
+}
+
+template<typename Framing, typename Handler>
+retransmit_stats sequenced_session<Framing, Handler>::get_retransmit_stats() const
+{
+    return _retransmit.stats();
+}
+
+template<typename Framing, typename Handler>
+void sequenced_session<Framing, Handler>::poll_retransmit()
+{
+    if (_state == sequenced_session_state::gap_fill) {
+        request_gaps();
+    }
+}
+
+template<typename Framing, typename Handler>
+void sequenced_session<Framing, Handler>::set_pacing_config(const pacing_config& config)
+{
+    _pacer.configure(config);
+    _handler.set_pacer(config.speed > 0 ? &_pacer : nullptr);
+}
+
+template<typename Framing, typename Handler>
+pacing_stats sequenced_session<Framing, Handler>::get_pacing_stats() const
+{
+    return _pacer.stats();
+}
+
+template<typename Framing, typename Handler>
+uint64_t sequenced_session<Framing, Handler>::position() const
+{
+    return _expected_seq_no;
+}
+
+template<typename Framing, typename Handler>
+void sequenced_session<Framing, Handler>::save_checkpoint(checkpoint_writer& writer) const
+{
+    writer.write_tag(Framing::checkpoint_tag());
+    writer.write_u64(_expected_seq_no);
+    _handler.save(writer);
+}
+
+template<typename Framing, typename Handler>
+void sequenced_session<Framing, Handler>::load_checkpoint(checkpoint_reader& reader)
+{
+    reader.read_tag(Framing::checkpoint_tag());
+    _expected_seq_no = reader.read_u64();
+    _handler.load(reader);
+    // Messages up to the checkpoint are already applied to the order books.
+    _state = sequenced_session_state::synchronized;
+    _sync_to_seq_no = 0;
+    _reorder.clear();
+    _retransmit.reset();
+}
+
+template<typename Framing, typename Handler>
+size_t sequenced_session<Framing, Handler>::process_packet(const net::packet_view& packet)
+{
+    uint64_t recv_seq_no, message_count;
+    if (!sequence_range(packet, recv_seq_no, message_count)) {
+        throw truncated_packet_error(std::string(Framing::name()) + " header is truncated");
+    }
+    _pacer.begin_packet();
+    std::memcpy(_session, packet.cast<header_type>()->Session, sizeof(_session));
+    auto end_seq_no = recv_seq_no + message_count;
+    if (_state == sequenced_session_state::gap_fill) {
+        _retransmit.received(recv_seq_no, end_seq_no);
+    }
+    if (_expected_seq_no < recv_seq_no) {
+        _sync_to_seq_no = std::max(_sync_to_seq_no, std::max(recv_seq_no, end_seq_no));
+        if (message_count) {
+            _reorder.insert(recv_seq_no, end_seq_no, packet);
+        }
+        _state = sequenced_session_state::gap_fill;
+        request_gaps();
+        return packet.len();
+    }
+    if (end_seq_no <= _expected_seq_no) {
+        if (_state == sequenced_session_state::gap_fill) {
+            request_gaps();
+        }
+        return packet.len();
+    }
+    size_t len = process_messages(packet, recv_seq_no, message_count);
+    process_buffered();
+    if (_state == sequenced_session_state::gap_fill) {
+        if (_expected_seq_no >= _sync_to_seq_no) {
+            _state = sequenced_session_state::synchronized;
+            _retransmit.reset();
+        } else {
+            request_gaps();
+        }
+    }
+    return len;
+}
+
+template<typename Framing, typename Handler>
+size_t sequenced_session<Framing, Handler>::process_messages(const net::packet_view& packet, uint64_t seq_no, uint64_t message_count)
+{
+    bool sync = _state == sequenced_session_state::synchronized;
+    auto* p = packet.buf() + sizeof(header_type);
+    for (uint64_t i = 0; i < message_count; i++, seq_no++) {
+        if (packet.end() - p < ssize_t(sizeof(message_block_type))) {
+            throw truncated_packet_error(std::string(Framing::name()) + " message block is truncated");
+        }
+        auto* msg_block = reinterpret_cast<const message_block_type*>(p);
+        p += sizeof(message_block_type);
+        auto message_length = Framing::message_length(*msg_block);
+        if (packet.end() - p < message_length) {
+            throw truncated_packet_error(std::string(Framing::name()) + " message is truncated");
+        }
+        if (seq_no == _expected_seq_no) {
+            Framing::process_message(_handler, net::packet_view{p, message_length}, sync);
+            _expected_seq_no++;
+        }
+        p += message_length;
+    }
+    return p - packet.buf();
+}
+
+template<typename Framing, typename Handler>
+void sequenced_session<Framing, Handler>::process_buffered()
+{
+    while (!_reorder.empty() && _reorder.first_seq_no() <= _expected_seq_no) {
+        if (_reorder.first_end_seq_no() > _expected_seq_no) {
+            auto packet = _reorder.first();
+            process_messages(packet, _reorder.first_seq_no(), _reorder.first_end_seq_no() - _reorder.first_seq_no());
+        }
+        _reorder.pop_first();
+    }
+}
+
+template<typename Framing, typename Handler>
+void sequenced_session<Framing, Handler>::request_gaps()
+{
+    _retransmit.begin();
+    _reorder.for_each_gap(_expected_seq_no, _sync_to_seq_no, [this](uint64_t begin, uint64_t end) {
+        _retransmit.add_gap(begin, end);
+    });
+    _retransmit.schedule(retransmit_scheduler::clock_type::now(), [this](uint64_t seq_no, uint64_t message_count) {
+        retransmit_request(seq_no, message_count);
+    });
+}
+
+template<typename Framing, typename Handler>
+void sequenced_session<Framing, Handler>::retransmit_request(uint64_t seq_no, uint64_t message_count)
+{
+    if (!bool(_send_cb)) {
+        throw std::runtime_error(std::string("invalid sequence number: ") + std::to_string(_sync_to_seq_no) + ", expected: " + std::to_string(seq_no));
+    }
+    request_packet_type request_packet;
+    std::memcpy(request_packet.Session, _session, sizeof(request_packet.Session));
+    uint64_t max_request_count = Framing::max_request_count;
+    Framing::request(request_packet, seq_no, std::min(message_count, max_request_count));
+
+    char *base = reinterpret_cast<char*>(&request_packet);
+    size_t len = sizeof(request_packet);
+
+    _send_cb(base, len);
+}
+
+}
+
+}
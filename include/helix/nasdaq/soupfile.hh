@@ -12,14 +12,129 @@
 #pragma once
 
 #include "helix/helix.hh"
+#include "helix/pacer.hh"
+#include "helix/net.hh"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace helix {
 
 namespace nasdaq {
 
+//! Maximum number of messages passed to the handler per call.
+constexpr size_t soupfile_batch_size = 64;
+
+//! Result of scanning a SoupFILE buffer for message boundaries.
+struct soupfile_frames {
+    //! Number of complete messages found.
+    size_t count = 0;
+    //! Number of bytes the messages span, including line terminators.
+    size_t consumed = 0;
+    //! True if the scan stopped at the empty line that ends the session.
+    bool end_of_session = false;
+};
+
+// SoupFILE framing scanner.
+//
+// SoupFILE messages are lines terminated by CR LF. Instead of searching for
+// the terminator of one message at a time, the scanner compares a whole
+// vector of bytes against LF, turns the result into a bit mask and walks the
+// set bits, so that one vector load yields every message boundary in it.
+// The scan stops after @max_msgs messages, at the empty line that ends the
+// session, or at a trailing line that is not terminated yet.
+class soupfile_scanner {
+    net::packet_view* _msgs;
+    size_t _max_msgs;
+    const char* _buf;
+    const char* _line;
+    soupfile_frames _frames;
+public:
+    soupfile_scanner(net::packet_view* msgs, size_t max_msgs, const char* buf)
+        : _msgs{msgs}
+        , _max_msgs{max_msgs}
+        , _buf{buf}
+        , _line{buf}
+    { }
+
+    soupfile_frames scan(size_t len) {
+        const char* p = _buf;
+        const char* end = _buf + len;
+#if defined(__AVX2__)
+        const __m256i lf = _mm256_set1_epi8('\n');
+        for (; p + 32 <= end; p += 32) {
+            auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lf));
+            if (!scan_mask(p, mask)) {
+                return _frames;
+            }
+        }
+#elif defined(__SSE2__)
+        const __m128i lf = _mm_set1_epi8('\n');
+        for (; p + 16 <= end; p += 16) {
+            auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, lf));
+            if (!scan_mask(p, mask)) {
+                return _frames;
+            }
+        }
+#endif
+        while (p < end) {
+            auto* next = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!next || !terminate_line(next)) {
+                break;
+            }
+            p = next + 1;
+        }
+        return _frames;
+    }
+private:
+    bool scan_mask(const char* p, uint32_t mask) {
+        while (mask) {
+            if (!terminate_line(p + __builtin_ctz(mask))) {
+                return false;
+            }
+            mask &= mask - 1;
+        }
+        return true;
+    }
+
+    //! Record the line ending at @lf, returns false when the scan is done.
+    bool terminate_line(const char* lf) {
+        size_t len = lf - _line;
+        if (len && lf[-1] == '\r') {
+            len--;
+        }
+        if (!len) {
+            _frames.end_of_session = true;
+            return false;
+        }
+        _msgs[_frames.count++] = net::packet_view{_line, len};
+        _line = lf + 1;
+        _frames.consumed = _line - _buf;
+        return _frames.count < _max_msgs;
+    }
+};
+
+inline soupfile_frames soupfile_scan(const char* buf, size_t len, net::packet_view* msgs, size_t max_msgs)
+{
+    soupfile_scanner scanner{msgs, max_msgs, buf};
+    return scanner.scan(len);
+}
+
 template<typename Handler>
 class soupfile_session : public session {
     Handler _handler;
+    //! Pacer of a real-time replay.
+    pacer _pacer;
+    net::packet_view _batch[soupfile_batch_size];
+    //! Offset of the next packet from the start of the file.
+    uint64_t _offset = 0;
 public:
     explicit soupfile_session(void* data);
 
@@ -32,6 +147,16 @@ public:
     virtual void set_send_callback(send_callback callback) override;
 
     virtual size_t process_packet(const net::packet_view& packet) override;
+
+    virtual void set_pacing_config(const pacing_config& config) override;
+
+    virtual pacing_stats get_pacing_stats() const override;
+
+    virtual uint64_t position() const override;
+
+    virtual void save_checkpoint(checkpoint_writer& writer) const override;
+
+    virtual void load_checkpoint(checkpoint_reader& reader) override;
 };
 
 template<typename Handler>
@@ -49,7 +174,7 @@ bool soupfile_session<Handler>::is_rth_timestamp(uint64_t timestamp)
 template<typename Handler>
 void soupfile_session<Handler>::subscribe(const std::string& symbol, size_t max_orders)
 {
-    _handler.subscribe(symbol, max_orders);
+    _handler.subscribe(symbol, sized_max_orders(symbol, max_orders));
 }
 
 template<typename Handler>
@@ -66,20 +191,54 @@ void soupfile_session<Handler>::set_send_callback(send_callback send_cb)
 template<typename Handler>
 size_t soupfile_session<Handler>::process_packet(const net::packet_view& packet)
 {
-    static std::string terminator = "\r\n";
-    auto view = packet.as_string_view();
-    auto terminator_start = view.find_first_of(terminator);
-    if (terminator_start == std::experimental::string_view::npos) {
-        throw std::runtime_error("packet is truncated");
-    }
-    if (!terminator_start) {
-        return 0;
-    }
-    auto nr = _handler.process_packet(packet);
-    if (nr > terminator_start) {
-        throw std::runtime_error("parsed message is larger than the framing");
+    auto frames = soupfile_scan(packet.buf(), packet.len(), _batch, soupfile_batch_size);
+    if (!frames.count) {
+        if (frames.end_of_session) {
+            return 0;
+        }
+        throw truncated_packet_error("SoupFILE packet is truncated");
     }
-    return terminator_start + terminator.size();
+    _handler.process_packets(_batch, frames.count);
+    _offset += frames.consumed;
+    return frames.consumed;
+}
+
+template<typename Handler>
+void soupfile_session<Handler>::set_pacing_config(const pacing_config& config)
+{
+    // SoupFILE has no packets, so every message is paced.
+    auto file_config = config;
+    file_config.per_packet = false;
+    _pacer.configure(file_config);
+    _handler.set_pacer(config.speed > 0 ? &_pacer : nullptr);
+}
+
+template<typename Handler>
+pacing_stats soupfile_session<Handler>::get_pacing_stats() const
+{
+    return _pacer.stats();
+}
+
+template<typename Handler>
+uint64_t soupfile_session<Handler>::position() const
+{
+    return _offset;
+}
+
+template<typename Handler>
+void soupfile_session<Handler>::save_checkpoint(checkpoint_writer& writer) const
+{
+    writer.write_tag("soupfile");
+    writer.write_u64(_offset);
+    _handler.save(writer);
+}
+
+template<typename Handler>
+void soupfile_session<Handler>::load_checkpoint(checkpoint_reader& reader)
+{
+    reader.read_tag("soupfile");
+    _offset = reader.read_u64();
+    _handler.load(reader);
 }
 
 }
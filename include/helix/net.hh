@@ -11,6 +11,11 @@ class packet_view {
     const char* _buf;
     size_t _len;
 public:
+    packet_view()
+        : _buf{nullptr}
+        , _len{0}
+    { }
+
     packet_view(const char* buf, size_t len)
         : _buf{buf}
         , _len{len}
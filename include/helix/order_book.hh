@@ -12,6 +12,7 @@
 #include <boost/multi_index/member.hpp>
 
 #include <unordered_map>
+#include <functional>
 #include <cstdint>
 #include <utility>
 #include <memory>
@@ -21,6 +22,9 @@
 
 namespace helix {
 
+class checkpoint_writer;
+class checkpoint_reader;
+
 /// \addtogroup order-book
 /// @{
 
@@ -89,8 +93,10 @@ struct execution {
     side_type side;
     //! The number of remaining quantity on the traded price level.
     uint64_t remaining;
+    //! True if the execution filled the order, which left the order book.
+    bool filled;
 
-    execution(uint64_t price, side_type side, uint64_t remaining);
+    execution(uint64_t price, side_type side, uint64_t remaining, bool filled);
 };
 
 /// \brief Order book is a price-time prioritized list of buy and sell
@@ -137,7 +143,9 @@ public:
 
     void add(order order);
     void replace(uint64_t order_id, order order);
-    void cancel(uint64_t order_id, uint64_t quantity);
+    //! Cancel @quantity of an order, returning true if nothing is left of
+    //! the order and it left the order book.
+    bool cancel(uint64_t order_id, uint64_t quantity);
     execution execute(uint64_t order_id, uint64_t quantity);
     void remove(uint64_t order_id);
     side_type side(uint64_t order_id) const;
@@ -152,6 +160,25 @@ public:
     uint64_t ask_size (size_t level) const;
     uint64_t midprice (size_t level) const;
 
+    /// \brief Call @fn for every order in the order book.
+    template<typename Fn>
+    void for_each_order(Fn&& fn) const {
+        for (auto&& o : _orders) {
+            fn(o);
+        }
+    }
+
+    /// \brief Write the state, orders and price levels of the order book
+    /// to a checkpoint.
+    void save(checkpoint_writer& writer) const;
+
+    /// \brief Restore an order book from a checkpoint.
+    ///
+    /// The order book is pre-allocated for the number of orders that
+    /// @max_orders returns for its symbol. Price levels are rebuilt from the
+    /// orders and checked against the levels in the checkpoint.
+    static order_book load(checkpoint_reader& reader, const std::function<size_t(const std::string&)>& max_orders);
+
 private:
     void remove(iterator& iter);
 
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "helix/helix.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+namespace helix {
+
+//! Remaining wait above which a pacer sleeps first and spins only for the
+//! last stretch.
+constexpr uint64_t pacer_spin_threshold_ns = 200000;
+
+//! Number of buckets in the pacing error histogram: one per nanosecond up
+//! to 16 ns and eight per power of two above that.
+constexpr size_t pacer_nr_buckets = 16 + 60 * 8;
+
+// Real-time replay pacer.
+//
+// Handlers report the timestamp of every message to the pacer before they
+// apply it, and the pacer holds the message back until as much time, scaled
+// by the replay speed, has passed since the first message as had passed in
+// the market. The pacer sleeps through long waits and busy-waits on the
+// monotonic clock or the time-stamp counter for the rest, so that messages
+// are released within a few hundred nanoseconds of their time. In packet
+// mode, only the first message of a packet is paced.
+//
+// The time by which every release misses its time is recorded in a
+// log-linear histogram, which bounds the error of a percentile to an eighth
+// of its value.
+class pacer {
+    pacing_config _config;
+    //! True if the first message has been released.
+    bool _started = false;
+    //! True if the next message starts a packet.
+    bool _packet_start = false;
+    uint64_t _first_timestamp = 0;
+    //! Clock reading when the first message was released.
+    uint64_t _start = 0;
+    //! Clock ticks per nanosecond.
+    double _ticks_per_ns = 1.0;
+    pacing_stats _stats;
+    std::array<uint64_t, pacer_nr_buckets> _histogram{};
+public:
+    void configure(const pacing_config& config);
+
+    pacing_stats stats() const;
+
+    //! Mark the start of a packet.
+    void begin_packet() {
+        _packet_start = true;
+    }
+
+    //! Wait until the message with market time @timestamp, in nanoseconds,
+    //! is due.
+    void pace(uint64_t timestamp) {
+        if (_config.per_packet) {
+            if (!_packet_start) {
+                return;
+            }
+            _packet_start = false;
+        }
+        wait(timestamp);
+    }
+private:
+    void wait(uint64_t timestamp);
+    void record(uint64_t error_ns);
+    uint64_t now() const;
+};
+
+}
@@ -1,14 +1,17 @@
 #pragma once
 
 #include "helix/parity/pmd_messages.h"
+#include "helix/incremental_map.hh"
 #include "helix/order_book.hh"
+#include "helix/checkpoint.hh"
+#include "helix/pacer.hh"
 #include "helix/helix.hh"
 #include "helix/net.hh"
 
 #include <unordered_map>
 #include <vector>
 #include <memory>
-#include <set>
+#include <map>
 
 namespace helix {
 
@@ -27,12 +30,14 @@ namespace parity {
 class pmd_handler {
     //! Callback function for processing events.
     event_callback _process_event;
-    //! A map of order books by order book ID.
-    std::unordered_map<std::string, helix::order_book> _order_book_id_map;
-    //! A map of order books by order ID.
-    std::unordered_map<uint64_t, helix::order_book&> _order_id_map;
-    //! A set of symbols that we are interested in.
-    std::set<std::string> _symbols;
+    //! Pacer of a real-time replay, or null if messages are not paced.
+    pacer* _pacer = nullptr;
+    //! A map of order books by instrument, loaded from its 8-byte field as an integer.
+    std::unordered_map<uint64_t, helix::order_book> _order_book_id_map;
+    //! A map of order books by the ID of every order that is in one.
+    helix::incremental_map<uint64_t, helix::order_book&> _order_id_map;
+    //! Pre-allocation sizes of the symbols that we are interested in.
+    std::map<std::string, size_t> _symbols;
     //! Number of seconds since midnight when the trading session started.
     uint32_t _seconds;
 public:
@@ -40,7 +45,13 @@ public:
     bool is_rth_timestamp(uint64_t timestamp) const;
     void subscribe(std::string sym, size_t max_orders);
     void register_callback(event_callback callback);
+    //! Pace messages with @p, or stop pacing them if @p is null.
+    void set_pacer(pacer* p);
     size_t process_packet(const net::packet_view& packet, bool sync);
+    //! Write the order books and the session start time to a checkpoint.
+    void save(checkpoint_writer& writer) const;
+    //! Restore the order books of subscribed symbols and the session start time from a checkpoint.
+    void load(checkpoint_reader& reader);
 private:
     template<typename T>
     size_t process_msg(const net::packet_view& packet, bool sync);
@@ -51,6 +62,11 @@ private:
     void process_msg(const pmd_order_canceled* m, bool sync);
     void process_msg(const pmd_order_deleted* m, bool sync);
     void process_msg(const pmd_broken_trade* m, bool sync);
+    //! Pace a message by its timestamp.
+    template<typename T>
+    void pace(const T* m);
+    void pace(const pmd_version* m);
+    void pace(const pmd_second* m);
     //! Generate a sweep event if execution cleared a price level.
     event_mask sweep_event(const execution&) const;
     uint64_t to_timestamp(uint64_t nanoseconds) const;
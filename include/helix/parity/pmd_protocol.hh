@@ -18,6 +18,7 @@ public:
 
     explicit pmd_protocol(std::string name);
     virtual session* new_session(void *) override;
+    virtual session* new_arbitrated_session(void *) override;
 };
 
 }
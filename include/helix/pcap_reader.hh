@@ -0,0 +1,113 @@
+#pragma once
+
+#include "helix/helix.hh"
+#include "helix/net.hh"
+
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace helix {
+
+//! Error in the format of a capture file.
+class pcap_error : public std::runtime_error {
+public:
+    explicit pcap_error(const std::string& cause)
+        : std::runtime_error{cause}
+    { }
+};
+
+//! Destination that the UDP datagrams of a capture are filtered by.
+struct pcap_filter {
+    //! IPv4 destination address in network byte order, or zero for any.
+    uint32_t addr = 0;
+    //! UDP destination port, or zero for any.
+    uint16_t port = 0;
+};
+
+//! UDP datagram of a capture.
+struct pcap_datagram {
+    //! Capture time in nanoseconds since the epoch.
+    uint64_t timestamp;
+    //! UDP payload, which points into the capture file.
+    net::packet_view payload;
+};
+
+//! Counters of a capture reader.
+struct pcap_stats {
+    //! Number of captured frames.
+    uint64_t frames = 0;
+    //! Number of UDP datagrams that matched the filter.
+    uint64_t datagrams = 0;
+    //! Number of IPv4 fragments, which are not reassembled.
+    uint64_t fragments = 0;
+    //! Number of frames that were cut short by the capture length.
+    uint64_t truncated = 0;
+};
+
+// Capture file reader.
+//
+// The reader maps a pcap or pcapng file and returns the UDP datagrams in
+// it in capture order. Frames are Ethernet, with any number of VLAN tags,
+// Linux cooked captures or raw IP, carrying IPv4 and UDP. Headers are
+// parsed in place and the payload of a datagram points into the mapping,
+// so datagrams are valid as long as the reader is. Frames that are not UDP
+// over IPv4, or that do not match the filter, are skipped.
+class pcap_reader {
+    struct interface {
+        uint16_t link_type;
+        //! Timestamp units per second.
+        uint64_t resolution;
+        //! Offset of timestamps in seconds.
+        int64_t offset;
+    };
+    int _fd;
+    const char* _buf;
+    size_t _len;
+    size_t _pos = 0;
+    bool _pcapng;
+    //! True if the byte order of the file or section differs from the host.
+    bool _swap = false;
+    std::vector<interface> _interfaces;
+    //! Capture time of the last pcapng packet that had one.
+    uint64_t _last_timestamp = 0;
+    pcap_filter _filter;
+    pcap_stats _stats;
+public:
+    explicit pcap_reader(const std::string& filename, const pcap_filter& filter = pcap_filter{});
+    ~pcap_reader();
+
+    pcap_reader(const pcap_reader&) = delete;
+    pcap_reader& operator=(const pcap_reader&) = delete;
+
+    //! Read the next datagram. Returns false at the end of the capture.
+    bool next(pcap_datagram& datagram);
+
+    const pcap_stats& stats() const {
+        return _stats;
+    }
+
+private:
+    bool next_frame(const interface*& iface, uint64_t& timestamp, net::packet_view& frame, size_t& orig_len);
+    bool next_pcap_frame(const interface*& iface, uint64_t& timestamp, net::packet_view& frame, size_t& orig_len);
+    bool next_pcapng_frame(const interface*& iface, uint64_t& timestamp, net::packet_view& frame, size_t& orig_len);
+    void parse_section_header(const char* body, size_t len);
+    void parse_interface_description(const char* body, size_t len);
+    bool decode(uint16_t link_type, const net::packet_view& frame, net::packet_view& payload);
+    uint16_t u16(const char* p) const;
+    uint32_t u32(const char* p) const;
+    uint64_t u64(const char* p) const;
+};
+
+//! Replay the datagrams of a capture through a MoldUDP or MoldUDP64
+//! session in capture order.
+//
+// If @honor_timestamps is true, every datagram is delivered when as much
+// time has passed since the first one as had passed in the capture.
+// Otherwise the capture is replayed as fast as the session processes it.
+// Returns the number of datagrams replayed.
+uint64_t replay(session& s, pcap_reader& reader, bool honor_timestamps);
+
+}
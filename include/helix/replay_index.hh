@@ -0,0 +1,73 @@
+#pragma once
+
+#include "helix/checkpoint.hh"
+#include "helix/helix.hh"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace helix {
+
+/// \addtogroup checkpoint
+/// @{
+
+/// \brief Entry of a replay index.
+struct replay_index_entry {
+    /// Timestamp of the last message applied to the order books.
+    uint64_t timestamp;
+    /// Position of the session in the input.
+    uint64_t position;
+    /// Offset of the checkpoint in the index file.
+    uint64_t checkpoint_offset;
+};
+
+/// \brief Replay index writer.
+///
+/// A replay index is a sidecar file of a historical market data file that
+/// holds checkpoints of a session taken at intervals of market time. Every
+/// entry records the timestamp of the last message that the session applied
+/// before the checkpoint and the position in the file from which to continue.
+class replay_index_writer {
+    std::ofstream _out;
+    checkpoint_writer _writer;
+    uint64_t _last_timestamp = 0;
+public:
+    explicit replay_index_writer(const std::string& filename);
+
+    /// Add an entry with a checkpoint of @s at market time @timestamp.
+    /// Entries are added in timestamp order.
+    void add(uint64_t timestamp, const session& s);
+
+    /// Terminate the index and close the file.
+    void close();
+};
+
+/// \brief Replay index reader.
+class replay_index {
+    std::string _filename;
+    std::vector<replay_index_entry> _entries;
+public:
+    explicit replay_index(const std::string& filename);
+
+    const std::vector<replay_index_entry>& entries() const {
+        return _entries;
+    }
+
+    /// Returns the latest entry at or before @timestamp, or nullptr if
+    /// there is none.
+    const replay_index_entry* lookup(uint64_t timestamp) const;
+
+    /// Restore the checkpoint of @entry into @s.
+    void load(const replay_index_entry& entry, session& s) const;
+
+    /// Restore @s from the latest checkpoint at or before @timestamp.
+    /// Returns false and leaves @s untouched if there is no such checkpoint,
+    /// in which case the input is replayed from the start.
+    bool seek(uint64_t timestamp, session& s) const;
+};
+
+/// @}
+
+}
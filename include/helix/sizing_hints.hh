@@ -0,0 +1,53 @@
+#pragma once
+
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace helix {
+
+//! Peak size of the order book of a symbol over a trading day.
+struct symbol_sizing {
+    //! Largest number of orders in the book at a time.
+    uint64_t max_orders = 0;
+    //! Largest number of bid price levels at a time.
+    uint64_t max_bid_levels = 0;
+    //! Largest number of ask price levels at a time.
+    uint64_t max_ask_levels = 0;
+};
+
+// Per-symbol order book sizing hints.
+//
+// Hints are measured by a pre-scan of a day of market data, so that the
+// order books of a replay of the day can be sized up front instead of
+// growing, and rehashing, while they are replayed. Symbols are stored
+// without the padding of their feed.
+class sizing_hints {
+    std::unordered_map<std::string, symbol_sizing> _symbols;
+public:
+    void set(const std::string& symbol, const symbol_sizing& sizing);
+
+    //! Returns the hint of @symbol, or null if there is none.
+    const symbol_sizing* find(const std::string& symbol) const;
+
+    //! Returns the number of orders to size the order book of @symbol for:
+    //! its hint if there is one and it is larger, and @max_orders otherwise.
+    size_t max_orders(const std::string& symbol, size_t max_orders) const;
+
+    //! Returns the symbols that have a hint, in order.
+    std::vector<std::string> symbols() const;
+
+    size_t size() const {
+        return _symbols.size();
+    }
+
+    //! Read hints from a file.
+    static sizing_hints load(const std::string& filename);
+
+    //! Write the hints to a file.
+    void save(const std::string& filename) const;
+};
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <atomic>
+
+namespace helix {
+
+constexpr size_t cache_line_size = 64;
+
+// Bounded lock-free single-producer single-consumer ring buffer.
+//
+// The producer and the consumer each own one cursor, which lives on its own
+// cache line, and keep a cached copy of the other side's cursor so that the
+// shared cursors are only read when the ring looks full or empty. Both sides
+// work in batches: the producer allocates any number of slots before making
+// them visible with publish(), and the consumer releases the slots of a
+// whole batch at once.
+template<typename T>
+class spsc_ring {
+    std::unique_ptr<T[]> _slots;
+    size_t _mask;
+    // The cursors are separated by padding rather than aligned, because
+    // operator new does not honor extended alignment before C++17.
+    char _pad0[cache_line_size];
+    //! Consumer cursor: index of the next slot to consume.
+    std::atomic<size_t> _head{0};
+    //! Producer's copy of the consumer cursor.
+    size_t _cached_head = 0;
+    char _pad1[cache_line_size];
+    //! Producer cursor: index of the next published slot.
+    std::atomic<size_t> _tail{0};
+    //! Index of the next slot to allocate, published with publish().
+    size_t _alloc_tail = 0;
+    char _pad2[cache_line_size];
+    //! Consumer's copy of the producer cursor.
+    size_t _cached_tail = 0;
+    char _pad3[cache_line_size];
+public:
+    explicit spsc_ring(size_t capacity)
+        : _slots{new T[capacity]}
+        , _mask{capacity - 1}
+    {
+        if (!capacity || (capacity & _mask)) {
+            throw std::invalid_argument("ring capacity must be a power of two");
+        }
+    }
+
+    size_t capacity() const {
+        return _mask + 1;
+    }
+
+    //! Allocate a slot for the producer, or return nullptr if the ring is full.
+    T* try_alloc() {
+        if (_alloc_tail - _cached_head > _mask) {
+            _cached_head = _head.load(std::memory_order_acquire);
+            if (_alloc_tail - _cached_head > _mask) {
+                return nullptr;
+            }
+        }
+        return &_slots[_alloc_tail++ & _mask];
+    }
+
+    //! Make all allocated slots visible to the consumer.
+    void publish() {
+        _tail.store(_alloc_tail, std::memory_order_release);
+    }
+
+    //! Returns true if the consumer has consumed every published slot.
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    //! Consume up to @max_count slots, returns the number of slots consumed.
+    template<typename Fn>
+    size_t consume(Fn&& fn, size_t max_count) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _cached_tail) {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+            if (head == _cached_tail) {
+                return 0;
+            }
+        }
+        size_t count = std::min(_cached_tail - head, max_count);
+        for (size_t i = 0; i < count; i++) {
+            fn(_slots[(head + i) & _mask]);
+        }
+        _head.store(head + count, std::memory_order_release);
+        return count;
+    }
+};
+
+}
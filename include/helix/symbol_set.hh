@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <string>
+#include <vector>
+#include <array>
+
+namespace helix {
+
+// Subscriptions matched on the fixed-width symbol field of a feed.
+//
+// Symbols are padded with spaces to the width of the field and kept as
+// integer keys in a sorted vector. Matching the field of a directory
+// message is then a binary search over a few integer compares, without
+// building a std::string for every symbol in the directory.
+template<size_t Len>
+class symbol_set {
+    static_assert(Len % sizeof(uint64_t) == 0, "symbol field is not a multiple of 8 bytes");
+public:
+    using key_type = std::array<uint64_t, Len / sizeof(uint64_t)>;
+    //! Key of a subscription and its pre-allocation size.
+    using value_type = std::pair<key_type, size_t>;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+private:
+    std::vector<value_type> _subscriptions;
+public:
+    //! Returns the key of a symbol field of @Len bytes.
+    static key_type key(const char* field) {
+        key_type key;
+        std::memcpy(key.data(), field, Len);
+        return key;
+    }
+
+    //! Get the key of @symbol padded to the field, or return false if it
+    //! does not fit the field and can never match.
+    static bool key(const std::string& symbol, key_type& k) {
+        if (symbol.size() > Len) {
+            return false;
+        }
+        char field[Len];
+        std::fill(std::copy(symbol.begin(), symbol.end(), field), field + Len, ' ');
+        k = key(field);
+        return true;
+    }
+
+    //! Subscribe to @symbol with a pre-allocation size of @max_orders.
+    //
+    // Returns false if @symbol is already subscribed to, or does not fit the
+    // field.
+    bool insert(const std::string& symbol, size_t max_orders) {
+        key_type k;
+        if (!key(symbol, k)) {
+            return false;
+        }
+        auto it = lower_bound(k);
+        if (it != _subscriptions.end() && it->first == k) {
+            return false;
+        }
+        _subscriptions.emplace(it, k, max_orders);
+        return true;
+    }
+
+    //! Returns the pre-allocation size of the subscription to @k, or null
+    //! if there is none.
+    const size_t* find(const key_type& k) const {
+        auto it = lower_bound(k);
+        if (it == _subscriptions.end() || it->first != k) {
+            return nullptr;
+        }
+        return &it->second;
+    }
+
+    const size_t* find(const std::string& symbol) const {
+        key_type k;
+        if (!key(symbol, k)) {
+            return nullptr;
+        }
+        return find(k);
+    }
+
+    size_t size() const {
+        return _subscriptions.size();
+    }
+
+    const_iterator begin() const {
+        return _subscriptions.begin();
+    }
+
+    const_iterator end() const {
+        return _subscriptions.end();
+    }
+private:
+    const_iterator lower_bound(const key_type& k) const {
+        return std::lower_bound(_subscriptions.begin(), _subscriptions.end(), k,
+            [](const value_type& subscription, const key_type& k) {
+                return subscription.first < k;
+            });
+    }
+};
+
+}
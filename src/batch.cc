@@ -0,0 +1,163 @@
+#include "helix/batch.hh"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <thread>
+#include <deque>
+#include <mutex>
+
+namespace helix {
+
+namespace {
+
+//! Files that are queued for a worker, largest first.
+struct worker_queue {
+    std::mutex lock;
+    std::deque<size_t> files;
+};
+
+}
+
+batch_runner::batch_runner(const batch_config& config)
+    : _config{config}
+{
+    if (!_config.window_size) {
+        _config.window_size = file_reader_window_size;
+    }
+}
+
+void batch_runner::add(const batch_file& file)
+{
+    if (!file.proto) {
+        throw std::invalid_argument("no protocol for " + file.filename);
+    }
+    _files.push_back(file);
+}
+
+size_t batch_runner::nr_workers() const
+{
+    size_t nr = _config.nr_threads;
+    if (!nr) {
+        nr = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (_config.max_sessions) {
+        nr = std::min(nr, _config.max_sessions);
+    }
+    return std::max<size_t>(1, std::min(nr, _files.size()));
+}
+
+void batch_runner::run(session_factory factory)
+{
+    _file_stats.assign(_files.size(), batch_file_stats{});
+    _stats = batch_stats{};
+    if (_files.empty()) {
+        return;
+    }
+
+    // A file that cannot be sized sorts last and fails when it is opened.
+    for (size_t i = 0; i < _files.size(); i++) {
+        struct stat st;
+        if (::stat(_files[i].filename.c_str(), &st) == 0) {
+            _file_stats[i].size = st.st_size;
+        }
+    }
+    std::vector<size_t> order(_files.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return _file_stats[a].size > _file_stats[b].size;
+    });
+
+    size_t nr = nr_workers();
+    std::unique_ptr<worker_queue[]> queues{new worker_queue[nr]};
+    for (size_t i = 0; i < order.size(); i++) {
+        queues[i % nr].files.push_back(order[i]);
+    }
+
+    // Files are only ever taken from the front of a queue, where the
+    // largest file of the queue is.
+    auto take = [&](size_t worker, size_t& index, bool& stolen) {
+        {
+            std::lock_guard<std::mutex> guard{queues[worker].lock};
+            if (!queues[worker].files.empty()) {
+                index = queues[worker].files.front();
+                queues[worker].files.pop_front();
+                stolen = false;
+                return true;
+            }
+        }
+        for (;;) {
+            size_t victim = nr;
+            uint64_t victim_size = 0;
+            for (size_t i = 0; i < nr; i++) {
+                std::lock_guard<std::mutex> guard{queues[i].lock};
+                if (!queues[i].files.empty()) {
+                    uint64_t size = _file_stats[queues[i].files.front()].size;
+                    if (victim == nr || size > victim_size) {
+                        victim = i;
+                        victim_size = size;
+                    }
+                }
+            }
+            if (victim == nr) {
+                return false;
+            }
+            std::lock_guard<std::mutex> guard{queues[victim].lock};
+            if (!queues[victim].files.empty()) {
+                index = queues[victim].files.front();
+                queues[victim].files.pop_front();
+                stolen = true;
+                return true;
+            }
+        }
+    };
+
+    auto replay_file = [&](size_t worker, size_t index, bool stolen) {
+        auto& stats = _file_stats[index];
+        stats.worker = worker;
+        stats.stolen = stolen;
+        auto start = std::chrono::steady_clock::now();
+        try {
+            auto s = factory(index, _files[index]);
+            if (!s) {
+                throw std::invalid_argument("no session for " + _files[index].filename);
+            }
+            auto reader = open_file_reader(_files[index].filename, _config.mode, _config.window_size);
+            stats.bytes = replay(*s, *reader);
+        } catch (...) {
+            stats.error = std::current_exception();
+        }
+        stats.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < nr; i++) {
+        workers.emplace_back([&, i] {
+            size_t index;
+            bool stolen;
+            while (take(i, index, stolen)) {
+                replay_file(i, index, stolen);
+            }
+        });
+    }
+    for (auto&& w : workers) {
+        w.join();
+    }
+    _stats.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto&& stats : _file_stats) {
+        _stats.files++;
+        _stats.bytes += stats.bytes;
+        if (stats.error) {
+            _stats.failed++;
+        }
+        if (stats.stolen) {
+            _stats.steals++;
+        }
+    }
+}
+
+}
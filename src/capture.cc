@@ -0,0 +1,338 @@
+#include "helix/capture.hh"
+
+#include "helix/compat/endian.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <system_error>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+
+namespace helix {
+
+//! Time that the writer thread sleeps when there is nothing to write.
+static constexpr std::chrono::milliseconds capture_poll_interval{1};
+
+static inline size_t padded_len(size_t len)
+{
+    return (len + 7) & ~size_t(7);
+}
+
+//! Returns the length of the first @len bytes of the capture file @fd that
+//! hold complete packets, including their padding.
+static size_t complete_len(int fd, size_t len, const std::string& filename)
+{
+    void* p = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), filename);
+    }
+    auto* buf = static_cast<const char*>(p);
+    size_t pos = sizeof(capture_file_header);
+    while (len - pos >= sizeof(capture_packet_header)) {
+        auto* header = reinterpret_cast<const capture_packet_header*>(buf + pos);
+        size_t size = sizeof(capture_packet_header) + padded_len(le32toh(header->len));
+        if (len - pos < size) {
+            break;
+        }
+        pos += size;
+    }
+    munmap(p, len);
+    return pos;
+}
+
+capture_writer::capture_writer(const std::string& filename)
+    : _chunks{new chunk[capture_nr_chunks]}
+{
+    _fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (_fd < 0) {
+        throw std::system_error(errno, std::generic_category(), filename);
+    }
+    try {
+        struct stat st;
+        if (fstat(_fd, &st) < 0) {
+            throw std::system_error(errno, std::generic_category(), filename);
+        }
+        capture_file_header header;
+        if (st.st_size == 0) {
+            std::memcpy(header.magic, capture_magic, sizeof(header.magic));
+            header.version = htole32(capture_version);
+            header.reserved = 0;
+            if (::write(_fd, &header, sizeof(header)) != sizeof(header)) {
+                throw std::system_error(errno, std::generic_category(), filename);
+            }
+        } else if (pread(_fd, &header, sizeof(header), 0) != sizeof(header)
+                || std::memcmp(header.magic, capture_magic, sizeof(header.magic))
+                || le32toh(header.version) != capture_version) {
+            throw capture_error(filename + ": not a Helix capture file");
+        } else {
+            // A recording that was cut short ends in a truncated packet.
+            // Appending after it would misframe every packet that follows,
+            // so the file is cut back to the last complete packet.
+            size_t len = complete_len(_fd, st.st_size, filename);
+            if (len < size_t(st.st_size) && ftruncate(_fd, len) < 0) {
+                throw std::system_error(errno, std::generic_category(), filename);
+            }
+        }
+    } catch (...) {
+        ::close(_fd);
+        throw;
+    }
+    for (size_t i = 0; i < capture_nr_chunks; i++) {
+        _chunks[i].buf.reset(new char[capture_chunk_size]);
+        *_free.try_alloc() = &_chunks[i];
+    }
+    _free.publish();
+    _thread = std::thread{&capture_writer::run, this};
+}
+
+capture_writer::~capture_writer()
+{
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void capture_writer::record(uint64_t timestamp, uint16_t line, const net::packet_view& packet)
+{
+    std::lock_guard<std::mutex> guard{_lock};
+    size_t size = sizeof(capture_packet_header) + padded_len(packet.len());
+    if (size > capture_chunk_size) {
+        _stats.dropped++;
+        return;
+    }
+    if (_current && _current->len + size > capture_chunk_size) {
+        hand_over();
+    }
+    if (!_current && !acquire()) {
+        _stats.dropped++;
+        return;
+    }
+    if (!_current->len) {
+        _current_start = std::chrono::steady_clock::now();
+    }
+    capture_packet_header header;
+    header.timestamp = htole64(timestamp);
+    header.line = htole16(line);
+    header.reserved = 0;
+    header.len = htole32(packet.len());
+    char* p = _current->buf.get() + _current->len;
+    std::memcpy(p, &header, sizeof(header));
+    std::memcpy(p + sizeof(header), packet.buf(), packet.len());
+    std::memset(p + sizeof(header) + packet.len(), 0, size - sizeof(header) - packet.len());
+    _current->len += size;
+    _stats.packets++;
+    _stats.bytes += size;
+}
+
+void capture_writer::flush()
+{
+    std::lock_guard<std::mutex> guard{_lock};
+    hand_over();
+}
+
+void capture_writer::hand_over()
+{
+    if (!_current || !_current->len) {
+        return;
+    }
+    // There are as many slots in the ring as there are buffers.
+    *_full.try_alloc() = _current;
+    _full.publish();
+    _current = nullptr;
+}
+
+capture_writer::chunk* capture_writer::take_stale()
+{
+    std::lock_guard<std::mutex> guard{_lock};
+    if (!_current || !_current->len || std::chrono::steady_clock::now() - _current_start < capture_flush_interval) {
+        return nullptr;
+    }
+    chunk* c = _current;
+    _current = nullptr;
+    return c;
+}
+
+void capture_writer::close()
+{
+    if (!_thread.joinable()) {
+        return;
+    }
+    flush();
+    _closing.store(true, std::memory_order_release);
+    _thread.join();
+    ::close(_fd);
+    int err = _error.load(std::memory_order_relaxed);
+    if (err) {
+        throw std::system_error(err, std::generic_category(), "capture write failed");
+    }
+}
+
+bool capture_writer::acquire()
+{
+    _free.consume([this](chunk* c) {
+        _current = c;
+    }, 1);
+    return _current != nullptr;
+}
+
+void capture_writer::run()
+{
+    chunk* batch[capture_nr_chunks];
+    for (;;) {
+        // Every buffer handed over before close() is visible once the
+        // closing flag is.
+        bool closing = _closing.load(std::memory_order_acquire);
+        size_t count = 0;
+        _full.consume([&](chunk* c) {
+            batch[count++] = c;
+        }, capture_nr_chunks);
+        if (!count) {
+            if (closing) {
+                break;
+            }
+            // A buffer that is filling slowly, or not at all because the
+            // feed went quiet, is taken from the receiving thread. Buffers
+            // that it handed over before are written out first.
+            chunk* stale = take_stale();
+            if (!stale) {
+                std::this_thread::sleep_for(capture_poll_interval);
+                continue;
+            }
+            _full.consume([&](chunk* c) {
+                batch[count++] = c;
+            }, capture_nr_chunks);
+            batch[count++] = stale;
+        }
+        write_chunks(batch, count);
+        for (size_t i = 0; i < count; i++) {
+            batch[i]->len = 0;
+            *_free.try_alloc() = batch[i];
+        }
+        _free.publish();
+    }
+}
+
+void capture_writer::write_chunks(chunk** chunks, size_t count)
+{
+    if (_error.load(std::memory_order_relaxed)) {
+        return;
+    }
+    struct iovec iov[capture_nr_chunks];
+    for (size_t i = 0; i < count; i++) {
+        iov[i].iov_base = chunks[i]->buf.get();
+        iov[i].iov_len = chunks[i]->len;
+    }
+    struct iovec* next = iov;
+    while (count) {
+        ssize_t nr = ::writev(_fd, next, count);
+        if (nr < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            _error.store(errno, std::memory_order_relaxed);
+            return;
+        }
+        while (count && size_t(nr) >= next->iov_len) {
+            nr -= next->iov_len;
+            next++;
+            count--;
+        }
+        if (count) {
+            next->iov_base = static_cast<char*>(next->iov_base) + nr;
+            next->iov_len -= nr;
+        }
+    }
+}
+
+capture_reader::capture_reader(const std::string& filename)
+{
+    _fd = ::open(filename.c_str(), O_RDONLY);
+    if (_fd < 0) {
+        throw std::system_error(errno, std::generic_category(), filename);
+    }
+    struct stat st;
+    if (fstat(_fd, &st) < 0) {
+        int err = errno;
+        ::close(_fd);
+        throw std::system_error(err, std::generic_category(), filename);
+    }
+    _len = st.st_size;
+    if (_len < sizeof(capture_file_header)) {
+        ::close(_fd);
+        throw capture_error(filename + ": not a Helix capture file");
+    }
+    void* p = mmap(nullptr, _len, PROT_READ, MAP_SHARED, _fd, 0);
+    if (p == MAP_FAILED) {
+        int err = errno;
+        ::close(_fd);
+        throw std::system_error(err, std::generic_category(), filename);
+    }
+    _buf = static_cast<const char*>(p);
+    madvise(const_cast<char*>(_buf), _len, MADV_SEQUENTIAL);
+
+    auto* header = reinterpret_cast<const capture_file_header*>(_buf);
+    if (std::memcmp(header->magic, capture_magic, sizeof(header->magic)) || le32toh(header->version) != capture_version) {
+        munmap(const_cast<char*>(_buf), _len);
+        ::close(_fd);
+        throw capture_error(filename + ": not a Helix capture file");
+    }
+}
+
+capture_reader::~capture_reader()
+{
+    munmap(const_cast<char*>(_buf), _len);
+    ::close(_fd);
+}
+
+bool capture_reader::next(capture_packet& packet)
+{
+    if (_pos == _len) {
+        return false;
+    }
+    if (_len - _pos < sizeof(capture_packet_header)) {
+        _truncated = true;
+        return false;
+    }
+    auto* header = reinterpret_cast<const capture_packet_header*>(_buf + _pos);
+    size_t len = le32toh(header->len);
+    if (_len - _pos - sizeof(capture_packet_header) < len) {
+        _truncated = true;
+        return false;
+    }
+    packet.timestamp = le64toh(header->timestamp);
+    packet.line = le16toh(header->line);
+    packet.payload = net::packet_view{_buf + _pos + sizeof(capture_packet_header), len};
+    _pos = std::min(_len, _pos + sizeof(capture_packet_header) + padded_len(len));
+    return true;
+}
+
+uint64_t replay(session& s, capture_reader& reader, bool honor_timestamps)
+{
+    using clock_type = std::chrono::steady_clock;
+    uint64_t count = 0;
+    uint64_t first_timestamp = 0;
+    clock_type::time_point start;
+    capture_packet packet;
+    while (reader.next(packet)) {
+        if (honor_timestamps) {
+            if (!count) {
+                first_timestamp = packet.timestamp;
+                start = clock_type::now();
+            } else if (packet.timestamp > first_timestamp) {
+                std::this_thread::sleep_until(start + std::chrono::nanoseconds{packet.timestamp - first_timestamp});
+            }
+        }
+        s.process_line_packet(packet.line, packet.payload);
+        count++;
+    }
+    return count;
+}
+
+}
@@ -0,0 +1,133 @@
+#include "helix/checkpoint.hh"
+
+#include "helix/compat/endian.h"
+
+#include <cstring>
+
+namespace helix {
+
+static const char checkpoint_magic[8] = {'H', 'E', 'L', 'I', 'X', 'C', 'K', 'P'};
+
+//! Upper bound of a string length, which catches corrupted checkpoints
+//! before they allocate memory.
+static constexpr uint32_t checkpoint_max_string_len = 1 << 16;
+
+checkpoint_writer::checkpoint_writer(std::ostream& out)
+    : _out{out}
+{
+    write(checkpoint_magic, sizeof(checkpoint_magic));
+    write_u32(checkpoint_version);
+}
+
+void checkpoint_writer::write_u8(uint8_t value)
+{
+    write(&value, sizeof(value));
+}
+
+void checkpoint_writer::write_u32(uint32_t value)
+{
+    uint32_t raw = htobe32(value);
+    write(&raw, sizeof(raw));
+}
+
+void checkpoint_writer::write_u64(uint64_t value)
+{
+    uint64_t raw = htobe64(value);
+    write(&raw, sizeof(raw));
+}
+
+void checkpoint_writer::write_string(const std::string& value)
+{
+    if (value.size() > checkpoint_max_string_len) {
+        throw checkpoint_error("string is too long: " + std::to_string(value.size()));
+    }
+    write_u32(value.size());
+    write(value.data(), value.size());
+}
+
+void checkpoint_writer::write_tag(const std::string& tag)
+{
+    write_string(tag);
+}
+
+void checkpoint_writer::write_bytes(const void* buf, size_t len)
+{
+    write(buf, len);
+}
+
+void checkpoint_writer::write(const void* buf, size_t len)
+{
+    _out.write(static_cast<const char*>(buf), len);
+    if (!_out) {
+        throw checkpoint_error("unable to write checkpoint");
+    }
+}
+
+checkpoint_reader::checkpoint_reader(std::istream& in)
+    : _in{in}
+{
+    char magic[sizeof(checkpoint_magic)];
+    read(magic, sizeof(magic));
+    if (std::memcmp(magic, checkpoint_magic, sizeof(magic))) {
+        throw checkpoint_error("not a checkpoint");
+    }
+    auto version = read_u32();
+    if (version != checkpoint_version) {
+        throw checkpoint_error("unsupported checkpoint version: " + std::to_string(version));
+    }
+}
+
+uint8_t checkpoint_reader::read_u8()
+{
+    uint8_t value;
+    read(&value, sizeof(value));
+    return value;
+}
+
+uint32_t checkpoint_reader::read_u32()
+{
+    uint32_t raw;
+    read(&raw, sizeof(raw));
+    return be32toh(raw);
+}
+
+uint64_t checkpoint_reader::read_u64()
+{
+    uint64_t raw;
+    read(&raw, sizeof(raw));
+    return be64toh(raw);
+}
+
+std::string checkpoint_reader::read_string()
+{
+    auto len = read_u32();
+    if (len > checkpoint_max_string_len) {
+        throw checkpoint_error("string is too long: " + std::to_string(len));
+    }
+    std::string value(len, '\0');
+    read(&value[0], len);
+    return value;
+}
+
+void checkpoint_reader::read_tag(const std::string& tag)
+{
+    auto value = read_string();
+    if (value != tag) {
+        throw checkpoint_error("checkpoint contains " + value + " state, expected " + tag);
+    }
+}
+
+void checkpoint_reader::read_bytes(void* buf, size_t len)
+{
+    read(buf, len);
+}
+
+void checkpoint_reader::read(void* buf, size_t len)
+{
+    _in.read(static_cast<char*>(buf), len);
+    if (!_in) {
+        throw checkpoint_error("checkpoint is truncated");
+    }
+}
+
+}
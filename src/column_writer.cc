@@ -0,0 +1,252 @@
+#include "helix/column_writer.hh"
+
+#include "helix/compat/endian.h"
+
+#include <sys/uio.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <system_error>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+
+namespace helix {
+
+//! Time that the writer thread sleeps when there is nothing to write.
+static constexpr std::chrono::milliseconds column_poll_interval{1};
+
+static inline size_t padded_len(size_t len)
+{
+    return (len + 7) & ~size_t(7);
+}
+
+static void write_fully(int fd, struct iovec* iov, size_t count)
+{
+    while (count) {
+        ssize_t nr = ::writev(fd, iov, std::min<size_t>(count, IOV_MAX));
+        if (nr < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "column write failed");
+        }
+        while (count && size_t(nr) >= iov->iov_len) {
+            nr -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + nr;
+            iov->iov_len -= nr;
+        }
+    }
+}
+
+column_writer::column_writer(const std::string& filename, const std::vector<column>& columns, size_t block_rows)
+    : _columns{columns}
+    , _block_rows{block_rows}
+    , _blocks{new block[column_nr_blocks]}
+{
+    if (!block_rows || block_rows > UINT32_MAX) {
+        throw std::invalid_argument("invalid number of rows in a block");
+    }
+    size_t block_size = 0;
+    for (auto&& c : _columns) {
+        if (c.name.size() > column_name_size || (c.width != 1 && c.width != 2 && c.width != 4 && c.width != 8) || !c.scale) {
+            throw std::invalid_argument("invalid column: " + c.name);
+        }
+        _offsets.push_back(block_size);
+        block_size += padded_len(c.width * block_rows);
+    }
+    for (size_t i = 0; i < column_nr_blocks; i++) {
+        _blocks[i].buf.reset(new char[block_size]);
+    }
+
+    _fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (_fd < 0) {
+        throw std::system_error(errno, std::generic_category(), filename);
+    }
+    column_file_header header;
+    std::memcpy(header.magic, column_magic, sizeof(header.magic));
+    header.version = htole32(column_version);
+    header.nr_columns = htole32(_columns.size());
+    header.block_rows = htole32(block_rows);
+    header.reserved = 0;
+    std::vector<column_descriptor> descriptors(_columns.size());
+    for (size_t i = 0; i < _columns.size(); i++) {
+        std::memset(descriptors[i].name, 0, sizeof(descriptors[i].name));
+        std::memcpy(descriptors[i].name, _columns[i].name.data(), _columns[i].name.size());
+        descriptors[i].width = htole32(_columns[i].width);
+        descriptors[i].scale = htole32(_columns[i].scale);
+    }
+    struct iovec iov[2] = {
+        {&header, sizeof(header)},
+        {descriptors.data(), descriptors.size() * sizeof(column_descriptor)},
+    };
+    try {
+        write_fully(_fd, iov, 2);
+    } catch (...) {
+        ::close(_fd);
+        throw;
+    }
+    for (size_t i = 0; i < column_nr_blocks; i++) {
+        *_free.try_alloc() = &_blocks[i];
+    }
+    _free.publish();
+    _thread = std::thread{&column_writer::run, this};
+}
+
+column_writer::~column_writer()
+{
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+uint32_t column_writer::intern(const std::string& s)
+{
+    auto it = _string_ids.find(s);
+    if (it != _string_ids.end()) {
+        return it->second;
+    }
+    uint32_t id = _string_ids.size();
+    _string_ids.emplace(s, id);
+    _pending_strings.append(s.c_str(), s.size() + 1);
+    _nr_pending_strings++;
+    return id;
+}
+
+void column_writer::append(const uint64_t* values)
+{
+    if (!_current) {
+        acquire();
+    }
+    size_t row = _current->nr_rows;
+    char* buf = _current->buf.get();
+    for (size_t i = 0; i < _columns.size(); i++) {
+        char* p = buf + _offsets[i] + row * _columns[i].width;
+        switch (_columns[i].width) {
+        case 1: {
+            uint8_t v = values[i];
+            std::memcpy(p, &v, sizeof(v));
+            break;
+        }
+        case 2: {
+            uint16_t v = htole16(values[i]);
+            std::memcpy(p, &v, sizeof(v));
+            break;
+        }
+        case 4: {
+            uint32_t v = htole32(values[i]);
+            std::memcpy(p, &v, sizeof(v));
+            break;
+        }
+        case 8: {
+            uint64_t v = htole64(values[i]);
+            std::memcpy(p, &v, sizeof(v));
+            break;
+        }
+        }
+    }
+    _nr_rows++;
+    if (++_current->nr_rows == _block_rows) {
+        flush();
+    }
+}
+
+void column_writer::close()
+{
+    if (!_thread.joinable()) {
+        return;
+    }
+    if (_current && _current->nr_rows) {
+        flush();
+    }
+    _closing.store(true, std::memory_order_release);
+    _thread.join();
+    ::close(_fd);
+    int err = _error.load(std::memory_order_relaxed);
+    if (err) {
+        throw std::system_error(err, std::generic_category(), "column write failed");
+    }
+}
+
+void column_writer::acquire()
+{
+    while (!_free.consume([this](block* b) { _current = b; }, 1)) {
+        std::this_thread::yield();
+    }
+}
+
+void column_writer::flush()
+{
+    // Strings go out with the first block written after they were interned,
+    // which holds the first rows that can refer to them.
+    _current->strings.swap(_pending_strings);
+    _current->nr_strings = _nr_pending_strings;
+    _pending_strings.clear();
+    _nr_pending_strings = 0;
+    // There are as many slots in the ring as there are blocks.
+    *_full.try_alloc() = _current;
+    _full.publish();
+    _current = nullptr;
+}
+
+void column_writer::run()
+{
+    for (;;) {
+        // Every block handed over before close() is visible once the closing
+        // flag is.
+        bool closing = _closing.load(std::memory_order_acquire);
+        size_t count = _full.consume([this](block* b) {
+            write_block(b);
+            b->nr_rows = 0;
+            *_free.try_alloc() = b;
+        }, column_nr_blocks);
+        if (!count) {
+            if (closing) {
+                break;
+            }
+            std::this_thread::sleep_for(column_poll_interval);
+            continue;
+        }
+        _free.publish();
+    }
+}
+
+void column_writer::write_block(block* b)
+{
+    if (_error.load(std::memory_order_relaxed)) {
+        return;
+    }
+    size_t strings_len = padded_len(b->strings.size());
+    b->strings.resize(strings_len, '\0');
+    column_block_header header;
+    header.magic = htole32(column_block_magic);
+    header.nr_rows = htole32(b->nr_rows);
+    header.nr_strings = htole32(b->nr_strings);
+    header.strings_len = htole32(strings_len);
+    std::vector<struct iovec> iov;
+    iov.push_back({&header, sizeof(header)});
+    if (strings_len) {
+        iov.push_back({&b->strings[0], strings_len});
+    }
+    for (size_t i = 0; i < _columns.size(); i++) {
+        // Padding is taken from the column, whose tail is zeroed here.
+        size_t len = b->nr_rows * _columns[i].width;
+        char* p = b->buf.get() + _offsets[i];
+        std::memset(p + len, 0, padded_len(len) - len);
+        iov.push_back({p, padded_len(len)});
+    }
+    try {
+        write_fully(_fd, iov.data(), iov.size());
+    } catch (const std::system_error& e) {
+        _error.store(e.code().value(), std::memory_order_relaxed);
+    }
+}
+
+}
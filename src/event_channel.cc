@@ -0,0 +1,233 @@
+#include "helix/event_channel.hh"
+
+#include <stdexcept>
+#include <cstring>
+#include <thread>
+#include <deque>
+
+namespace helix {
+
+// Latest record of a symbol in the conflating mode.
+//
+// The record is guarded by a sequence lock: the publisher makes the sequence
+// odd while it updates the record, and the consumer retries its copy if the
+// sequence was odd or changed in the meantime. The record is stored as atomic
+// words so that the concurrent copies are well-defined.
+struct event_channel::conflation_slot {
+    static constexpr size_t nr_words = (sizeof(event_record) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint64_t> words[nr_words];
+
+    conflation_slot() {
+        for (auto&& w : words) {
+            w.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void store(const event_record& record) {
+        uint64_t buf[nr_words] = {};
+        std::memcpy(buf, &record, sizeof(record));
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        for (;;) {
+            if (!(s & 1) && seq.compare_exchange_weak(s, s + 1, std::memory_order_acquire)) {
+                break;
+            }
+            s = seq.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < nr_words; i++) {
+            words[i].store(buf[i], std::memory_order_relaxed);
+        }
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    void load(event_record& record) const {
+        uint64_t buf[nr_words];
+        for (;;) {
+            uint32_t s = seq.load(std::memory_order_acquire);
+            if (s & 1) {
+                continue;
+            }
+            for (size_t i = 0; i < nr_words; i++) {
+                buf[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == s) {
+                break;
+            }
+        }
+        std::memcpy(&record, buf, sizeof(record));
+    }
+};
+
+// Queue of the symbols that have a record for a consumer in the conflating
+// mode.
+struct event_channel::conflation_queue {
+    mpmc_ring<uint32_t> symbol_ids;
+    //! True for the symbols that are in the queue.
+    std::deque<std::atomic<bool>> pending;
+    //! Number of records superseded before they were consumed.
+    std::atomic<uint64_t> conflated{0};
+
+    conflation_queue(size_t capacity, size_t nr_symbols)
+        : symbol_ids{capacity}
+        , pending(nr_symbols)
+    {
+        for (auto&& p : pending) {
+            p.store(false, std::memory_order_relaxed);
+        }
+    }
+};
+
+event_channel::event_channel(size_t capacity, backpressure policy)
+    : _ring{capacity}
+    , _policy{policy}
+    , _capacity{capacity}
+{
+}
+
+event_channel::~event_channel()
+{
+}
+
+uint32_t event_channel::add_symbol(const std::string& symbol)
+{
+    auto it = _symbol_ids.find(symbol);
+    if (it != _symbol_ids.end()) {
+        return it->second;
+    }
+    uint32_t symbol_id = _symbols.size();
+    _symbol_ids.emplace(symbol, symbol_id);
+    _symbols.emplace_back(symbol);
+    _latest.emplace_back(new conflation_slot);
+    for (auto&& q : _queues) {
+        q->pending.emplace_back(false);
+    }
+    return symbol_id;
+}
+
+const std::string& event_channel::symbol(uint32_t symbol_id) const
+{
+    return _symbols.at(symbol_id);
+}
+
+size_t event_channel::add_consumer()
+{
+    if (_policy == backpressure::conflate) {
+        _queues.emplace_back(new conflation_queue{_capacity, _symbols.size()});
+        return _queues.size() - 1;
+    }
+    return _ring.add_consumer();
+}
+
+bool event_channel::publish(const event& ev)
+{
+    auto it = _symbol_ids.find(ev.get_symbol());
+    if (it == _symbol_ids.end()) {
+        return false;
+    }
+    event_record record = {};
+    record.symbol_id = it->second;
+    record.mask = ev.get_mask();
+    record.timestamp = ev.get_timestamp();
+    auto* ob = ev.get_ob();
+    if (ob) {
+        record.bid_price = ob->bid_price(0);
+        record.bid_size = ob->bid_size(0);
+        record.ask_price = ob->ask_price(0);
+        record.ask_size = ob->ask_size(0);
+    }
+    auto* t = ev.get_trade();
+    if (t) {
+        record.trade_price = t->price;
+        record.trade_size = t->size;
+        record.sign = t->sign;
+    }
+    publish(&record, 1);
+    return true;
+}
+
+void event_channel::publish(const event_record* records, size_t count)
+{
+    switch (_policy) {
+    case backpressure::block:
+        while (count) {
+            size_t n = _ring.try_publish(records, count);
+            if (!n) {
+                if (is_closed()) {
+                    // Nobody waits for the records of a closed channel.
+                    _ring.publish_overwrite(records, count);
+                    return;
+                }
+                std::this_thread::yield();
+            }
+            records += n;
+            count -= n;
+        }
+        break;
+    case backpressure::drop_oldest:
+        _ring.publish_overwrite(records, count);
+        break;
+    case backpressure::conflate:
+        for (size_t i = 0; i < count; i++) {
+            publish_latest(records[i]);
+        }
+        break;
+    }
+}
+
+void event_channel::publish_latest(const event_record& record)
+{
+    auto symbol_id = record.symbol_id;
+    _latest.at(symbol_id)->store(record);
+    for (auto&& q : _queues) {
+        if (q->pending[symbol_id].exchange(true, std::memory_order_acq_rel)) {
+            // The queued entry of the symbol picks up the new record.
+            q->conflated.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        // A symbol is queued at most once, so the queue is full only if
+        // there are more symbols than slots. Wait for the consumer instead
+        // of dropping.
+        while (!q->symbol_ids.try_publish(&symbol_id, 1) && !is_closed()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+size_t event_channel::consume(size_t consumer, event_record* records, size_t max_count)
+{
+    if (_policy != backpressure::conflate) {
+        return _ring.consume(consumer, records, max_count);
+    }
+    auto& q = *_queues.at(consumer);
+    size_t i = 0;
+    auto load = [this, &q, records, &i](uint32_t symbol_id) {
+        // Clear the pending flag before reading the record so that a record
+        // stored concurrently is queued again instead of lost.
+        q.pending[symbol_id].store(false, std::memory_order_seq_cst);
+        _latest[symbol_id]->load(records[i++]);
+    };
+    return q.symbol_ids.consume(load, max_count);
+}
+
+void event_channel::close()
+{
+    _closed.store(true, std::memory_order_release);
+}
+
+bool event_channel::is_closed() const
+{
+    return _closed.load(std::memory_order_acquire);
+}
+
+uint64_t event_channel::dropped(size_t consumer) const
+{
+    if (_policy == backpressure::conflate) {
+        return _queues.at(consumer)->conflated.load(std::memory_order_relaxed);
+    }
+    return _ring.missed(consumer);
+}
+
+}
@@ -0,0 +1,800 @@
+#include "helix/file_reader.hh"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifdef HELIX_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef HELIX_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <zlib.h>
+
+#include <condition_variable>
+#include <system_error>
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+#include <thread>
+#include <vector>
+#include <mutex>
+
+namespace helix {
+
+//! Size of the buffer that zlib reads compressed input into.
+static constexpr unsigned gzip_buffer_size = 1024 * 1024;
+
+static int open_input(const std::string& filename, uint64_t& file_size)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), filename);
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), filename);
+    }
+    file_size = st.st_size;
+    return fd;
+}
+
+//! Read up to @len bytes at @offset, retrying short reads until the end of
+//! the file. Returns the number of bytes read.
+static size_t pread_full(int fd, char* buf, size_t len, uint64_t offset)
+{
+    size_t done = 0;
+    while (done < len) {
+        ssize_t nr = ::pread(fd, buf + done, len - done, offset + done);
+        if (nr < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "pread");
+        }
+        if (!nr) {
+            break;
+        }
+        done += nr;
+    }
+    return done;
+}
+
+// Sliding window mapping.
+//
+// The reader maps a window of the file and moves it forward when less than a
+// frame is left in it. Every new window is advised for sequential access and
+// for reading in full, and the window after it is prefetched into the page
+// cache, so that the consumer rarely stalls on a page fault.
+class mmap_file_reader : public file_reader {
+    int _fd;
+    uint64_t _file_size;
+    size_t _window_size;
+    uint64_t _page_mask;
+    char* _map = nullptr;
+    uint64_t _map_offset = 0;
+    size_t _map_len = 0;
+    //! Offset of the first unconsumed byte.
+    uint64_t _pos;
+public:
+    mmap_file_reader(const std::string& filename, size_t window_size, uint64_t offset)
+        : _fd{open_input(filename, _file_size)}
+        , _window_size{window_size}
+        , _page_mask{~uint64_t(sysconf(_SC_PAGESIZE) - 1)}
+        , _pos{offset}
+    { }
+
+    ~mmap_file_reader() {
+        if (_map) {
+            munmap(_map, _map_len);
+        }
+        ::close(_fd);
+    }
+
+    virtual net::packet_view peek() override {
+        if (_pos >= _file_size) {
+            return net::packet_view{};
+        }
+        uint64_t map_end = _map_offset + _map_len;
+        if (!_map || _pos < _map_offset || (map_end - _pos <= file_reader_max_frame_size && map_end < _file_size)) {
+            remap();
+            map_end = _map_offset + _map_len;
+        }
+        return net::packet_view{_map + (_pos - _map_offset), size_t(map_end - _pos)};
+    }
+
+    virtual bool eof() const override {
+        return _map_offset + _map_len >= _file_size;
+    }
+
+    virtual void consume(size_t len) override {
+        _pos += len;
+    }
+
+private:
+    void remap() {
+        if (_map) {
+            munmap(_map, _map_len);
+            _map = nullptr;
+        }
+        _map_offset = _pos & _page_mask;
+        _map_len = std::min<uint64_t>(_window_size, _file_size - _map_offset);
+        void* p = mmap(nullptr, _map_len, PROT_READ, MAP_SHARED, _fd, _map_offset);
+        if (p == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+        _map = static_cast<char*>(p);
+        // Advice is only a hint, so failures are ignored.
+        madvise(_map, _map_len, MADV_SEQUENTIAL);
+        madvise(_map, _map_len, MADV_WILLNEED);
+#ifdef POSIX_FADV_WILLNEED
+        uint64_t next = _map_offset + _map_len;
+        if (next < _file_size) {
+            posix_fadvise(_fd, next, std::min<uint64_t>(_window_size, _file_size - next), POSIX_FADV_WILLNEED);
+        }
+#endif
+    }
+};
+
+// Buffer of a reader that copies its input.
+//
+// Data is read after a headroom of one frame, into which the unconsumed tail
+// of the previous buffer is copied, so that a frame that straddles two reads
+// is contiguous.
+struct read_buffer {
+    std::unique_ptr<char[]> mem;
+    //! Number of bytes read after the headroom.
+    size_t len = 0;
+    //! True if the read reached the end of the file.
+    bool eof = false;
+
+    explicit read_buffer(size_t window_size)
+        : mem{new char[file_reader_max_frame_size + window_size]}
+    { }
+
+    char* data() {
+        return mem.get() + file_reader_max_frame_size;
+    }
+};
+
+// Input that a reader thread copies into buffers.
+class input_source {
+public:
+    virtual ~input_source()
+    { }
+
+    //! Read up to @len bytes into @buf. Returns zero at the end of the input.
+    virtual size_t read(char* buf, size_t len) = 0;
+
+    //! Skip @len bytes of input.
+    virtual void skip(uint64_t len) {
+        std::unique_ptr<char[]> buf{new char[file_reader_max_frame_size]};
+        while (len) {
+            size_t nr = read(buf.get(), std::min<uint64_t>(len, file_reader_max_frame_size));
+            if (!nr) {
+                break;
+            }
+            len -= nr;
+        }
+    }
+};
+
+class pread_source : public input_source {
+    int _fd;
+    uint64_t _file_size;
+    uint64_t _offset = 0;
+public:
+    explicit pread_source(const std::string& filename)
+        : _fd{open_input(filename, _file_size)}
+    { }
+
+    ~pread_source() {
+        ::close(_fd);
+    }
+
+    virtual size_t read(char* buf, size_t len) override {
+        size_t nr = pread_full(_fd, buf, len, _offset);
+        _offset += nr;
+        return nr;
+    }
+
+    virtual void skip(uint64_t len) override {
+        _offset += len;
+    }
+};
+
+class gzip_source : public input_source {
+    gzFile _file;
+public:
+    explicit gzip_source(const std::string& filename)
+        : _file{gzopen(filename.c_str(), "rb")}
+    {
+        if (!_file) {
+            throw std::system_error(errno ? errno : ENOMEM, std::generic_category(), filename);
+        }
+        gzbuffer(_file, gzip_buffer_size);
+    }
+
+    ~gzip_source() {
+        gzclose(_file);
+    }
+
+    virtual size_t read(char* buf, size_t len) override {
+        int nr = gzread(_file, buf, std::min<size_t>(len, INT_MAX));
+        if (nr <= 0) {
+            // A truncated stream ends with a read of zero bytes.
+            int err;
+            const char* msg = gzerror(_file, &err);
+            if (nr < 0 || err == Z_BUF_ERROR) {
+                throw std::system_error(EIO, std::generic_category(), std::string{"gzip: "} + msg);
+            }
+        }
+        return nr;
+    }
+};
+
+#ifdef HELIX_HAVE_ZSTD
+
+class zstd_source : public input_source {
+    int _fd;
+    uint64_t _file_size;
+    ZSTD_DStream* _stream;
+    std::unique_ptr<char[]> _in_buf;
+    size_t _in_buf_size;
+    ZSTD_inBuffer _in = {nullptr, 0, 0};
+    //! True if the decoder may hold output that did not fit the last read.
+    bool _pending = false;
+    //! True if the input ended in the middle of a frame.
+    bool _in_frame = false;
+public:
+    explicit zstd_source(const std::string& filename)
+        : _fd{open_input(filename, _file_size)}
+        , _stream{ZSTD_createDStream()}
+        , _in_buf{new char[ZSTD_DStreamInSize()]}
+        , _in_buf_size{ZSTD_DStreamInSize()}
+    {
+        if (!_stream) {
+            ::close(_fd);
+            throw std::bad_alloc{};
+        }
+        ZSTD_initDStream(_stream);
+        _in.src = _in_buf.get();
+    }
+
+    ~zstd_source() {
+        ZSTD_freeDStream(_stream);
+        ::close(_fd);
+    }
+
+    virtual size_t read(char* buf, size_t len) override {
+        ZSTD_outBuffer out = {buf, len, 0};
+        while (!out.pos) {
+            if (_in.pos == _in.size && !_pending) {
+                ssize_t nr = ::read(_fd, _in_buf.get(), _in_buf_size);
+                if (nr < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error(errno, std::generic_category(), "read");
+                }
+                if (!nr) {
+                    if (_in_frame) {
+                        throw std::system_error(EIO, std::generic_category(), "zstd: truncated input");
+                    }
+                    return 0;
+                }
+                _in.size = nr;
+                _in.pos = 0;
+            }
+            size_t ret = ZSTD_decompressStream(_stream, &out, &_in);
+            if (ZSTD_isError(ret)) {
+                throw std::system_error(EIO, std::generic_category(), std::string{"zstd: "} + ZSTD_getErrorName(ret));
+            }
+            _in_frame = ret != 0;
+            _pending = out.pos == out.size;
+        }
+        return out.pos;
+    }
+};
+
+#endif
+
+// Reader thread that fills a ring of buffers.
+//
+// A reader thread fills buffers from an input source in turn while the
+// consumer processes the buffers that are ready, so reading, or
+// decompressing, overlaps with processing. The thread waits when every
+// buffer is either ready or being processed.
+class threaded_file_reader : public file_reader {
+    std::unique_ptr<input_source> _source;
+    size_t _window_size;
+    std::vector<read_buffer> _buffers;
+    std::mutex _lock;
+    std::condition_variable _cond;
+    //! True if a buffer is filled and not yet released by the consumer.
+    std::unique_ptr<bool[]> _filled;
+    bool _stop = false;
+    std::exception_ptr _error;
+    //! Buffer that the consumer processes.
+    size_t _current = 0;
+    const char* _pos = nullptr;
+    const char* _end = nullptr;
+    std::thread _thread;
+public:
+    threaded_file_reader(std::unique_ptr<input_source> source, size_t window_size, size_t nr_buffers, uint64_t offset)
+        : _source{std::move(source)}
+        , _window_size{window_size}
+        , _filled{new bool[nr_buffers]()}
+    {
+        for (size_t i = 0; i < nr_buffers; i++) {
+            _buffers.emplace_back(window_size);
+        }
+        _thread = std::thread{[this, offset] { run(offset); }};
+        try {
+            wait(_current);
+        } catch (...) {
+            stop();
+            throw;
+        }
+        auto& b = _buffers[_current];
+        _pos = b.data();
+        _end = b.data() + b.len;
+    }
+
+    ~threaded_file_reader() {
+        stop();
+    }
+
+    virtual net::packet_view peek() override {
+        if (!eof() && size_t(_end - _pos) <= file_reader_max_frame_size) {
+            advance();
+        }
+        return net::packet_view{_pos, size_t(_end - _pos)};
+    }
+
+    virtual bool eof() const override {
+        return _buffers[_current].eof;
+    }
+
+    virtual void consume(size_t len) override {
+        _pos += len;
+    }
+
+private:
+    void stop() {
+        {
+            std::unique_lock<std::mutex> guard{_lock};
+            _stop = true;
+        }
+        _cond.notify_all();
+        _thread.join();
+    }
+
+    void run(uint64_t offset) {
+        try {
+            _source->skip(offset);
+            for (size_t idx = 0;; idx = (idx + 1) % _buffers.size()) {
+                {
+                    std::unique_lock<std::mutex> guard{_lock};
+                    _cond.wait(guard, [this, idx] { return !_filled[idx] || _stop; });
+                    if (_stop) {
+                        return;
+                    }
+                }
+                auto& b = _buffers[idx];
+                b.len = 0;
+                b.eof = false;
+                while (b.len < _window_size) {
+                    size_t nr = _source->read(b.data() + b.len, _window_size - b.len);
+                    if (!nr) {
+                        b.eof = true;
+                        break;
+                    }
+                    b.len += nr;
+                }
+                {
+                    std::unique_lock<std::mutex> guard{_lock};
+                    _filled[idx] = true;
+                }
+                _cond.notify_all();
+                if (b.eof) {
+                    return;
+                }
+            }
+        } catch (...) {
+            std::unique_lock<std::mutex> guard{_lock};
+            _error = std::current_exception();
+            _cond.notify_all();
+        }
+    }
+
+    void wait(size_t idx) {
+        std::unique_lock<std::mutex> guard{_lock};
+        _cond.wait(guard, [this, idx] { return _filled[idx] || _error; });
+        if (!_filled[idx]) {
+            std::rethrow_exception(_error);
+        }
+    }
+
+    void advance() {
+        size_t next = (_current + 1) % _buffers.size();
+        wait(next);
+        auto& b = _buffers[next];
+        size_t tail = _end - _pos;
+        char* start = b.data() - tail;
+        std::memcpy(start, _pos, tail);
+        {
+            std::unique_lock<std::mutex> guard{_lock};
+            _filled[_current] = false;
+        }
+        _cond.notify_all();
+        _current = next;
+        _pos = start;
+        _end = b.data() + b.len;
+    }
+};
+
+#ifdef HELIX_HAVE_IO_URING
+
+// io_uring for reads, set up with the system calls directly.
+//
+// The submission and completion rings are mapped from the kernel. The
+// reader owns the tail of the submission ring and the head of the
+// completion ring, and the kernel the other two, so each side publishes its
+// cursor with a release store and reads the other side's with an acquire
+// load.
+class read_uring {
+    int _fd;
+    size_t _sq_len;
+    size_t _cq_len;
+    size_t _sqes_len;
+    char* _sq = nullptr;
+    char* _cq = nullptr;
+    struct io_uring_sqe* _sqes = nullptr;
+    unsigned* _sq_head;
+    unsigned* _sq_tail;
+    unsigned* _sq_array;
+    unsigned _sq_mask;
+    unsigned _sq_entries;
+    unsigned* _cq_head;
+    unsigned* _cq_tail;
+    struct io_uring_cqe* _cqes;
+    unsigned _cq_mask;
+    //! Number of reads queued since the last submit().
+    unsigned _pending = 0;
+public:
+    explicit read_uring(unsigned entries) {
+        struct io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        _fd = syscall(__NR_io_uring_setup, entries, &params);
+        if (_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+        }
+        _sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        _sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+        try {
+            _sq = map(_sq_len, IORING_OFF_SQ_RING);
+            _cq = map(_cq_len, IORING_OFF_CQ_RING);
+            _sqes = reinterpret_cast<struct io_uring_sqe*>(map(_sqes_len, IORING_OFF_SQES));
+        } catch (...) {
+            unmap();
+            throw;
+        }
+        _sq_head = reinterpret_cast<unsigned*>(_sq + params.sq_off.head);
+        _sq_tail = reinterpret_cast<unsigned*>(_sq + params.sq_off.tail);
+        _sq_array = reinterpret_cast<unsigned*>(_sq + params.sq_off.array);
+        _sq_mask = *reinterpret_cast<unsigned*>(_sq + params.sq_off.ring_mask);
+        _sq_entries = params.sq_entries;
+        _cq_head = reinterpret_cast<unsigned*>(_cq + params.cq_off.head);
+        _cq_tail = reinterpret_cast<unsigned*>(_cq + params.cq_off.tail);
+        _cqes = reinterpret_cast<struct io_uring_cqe*>(_cq + params.cq_off.cqes);
+        _cq_mask = *reinterpret_cast<unsigned*>(_cq + params.cq_off.ring_mask);
+    }
+
+    ~read_uring() {
+        unmap();
+    }
+
+    read_uring(const read_uring&) = delete;
+    read_uring& operator=(const read_uring&) = delete;
+
+    //! Queue a read of @len bytes at @offset of @fd into @buf, which
+    //! completes with @user_data.
+    void queue_read(int fd, char* buf, size_t len, uint64_t offset, uint64_t user_data) {
+        unsigned tail = *_sq_tail;
+        if (tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= _sq_entries) {
+            throw std::runtime_error("io_uring submission queue is full");
+        }
+        unsigned idx = tail & _sq_mask;
+        auto& sqe = _sqes[idx];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uintptr_t>(buf);
+        sqe.len = len;
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        _sq_array[idx] = idx;
+        __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        _pending++;
+    }
+
+    //! Submit the queued reads to the kernel.
+    void submit() {
+        while (_pending) {
+            int ret = syscall(__NR_io_uring_enter, _fd, _pending, 0, 0, nullptr, 0);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+            }
+            _pending -= ret;
+        }
+    }
+
+    //! Wait for a read to complete and return its completion.
+    struct io_uring_cqe wait() {
+        for (;;) {
+            unsigned head = *_cq_head;
+            if (head != __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) {
+                auto cqe = _cqes[head & _cq_mask];
+                __atomic_store_n(_cq_head, head + 1, __ATOMIC_RELEASE);
+                return cqe;
+            }
+            int ret = syscall(__NR_io_uring_enter, _fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret < 0 && errno != EINTR) {
+                throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+            }
+        }
+    }
+private:
+    char* map(size_t len, off_t offset) {
+        void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, offset);
+        if (p == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+        return static_cast<char*>(p);
+    }
+
+    void unmap() {
+        if (_sqes) {
+            munmap(_sqes, _sqes_len);
+        }
+        if (_cq) {
+            munmap(_cq, _cq_len);
+        }
+        if (_sq) {
+            munmap(_sq, _sq_len);
+        }
+        ::close(_fd);
+    }
+};
+
+// Reads queued in an io_uring.
+//
+// The reader keeps a read queued for every buffer that the consumer is not
+// processing, so the kernel reads ahead without a reader thread. Buffers are
+// used in turn and a buffer is queued again as soon as the consumer moves on
+// to the next one.
+class io_uring_file_reader : public file_reader {
+    struct queued_buffer : read_buffer {
+        uint64_t offset = 0;
+        size_t requested = 0;
+        bool queued = false;
+        bool done = false;
+
+        explicit queued_buffer(size_t window_size)
+            : read_buffer{window_size}
+        { }
+    };
+    read_uring _ring;
+    int _fd;
+    uint64_t _file_size;
+    size_t _window_size;
+    std::vector<queued_buffer> _buffers;
+    //! Offset of the next read to queue.
+    uint64_t _read_offset;
+    size_t _current = 0;
+    const char* _pos = nullptr;
+    const char* _end = nullptr;
+public:
+    io_uring_file_reader(const std::string& filename, size_t window_size, uint64_t offset)
+        : _ring{file_reader_queue_depth}
+        , _fd{open_input(filename, _file_size)}
+        , _window_size{window_size}
+        , _read_offset{offset}
+    {
+        for (size_t i = 0; i < file_reader_queue_depth; i++) {
+            _buffers.emplace_back(window_size);
+        }
+        try {
+            for (size_t i = 0; i < file_reader_queue_depth; i++) {
+                queue(i);
+            }
+            _ring.submit();
+            wait(_current);
+        } catch (...) {
+            shutdown();
+            throw;
+        }
+        auto& b = _buffers[_current];
+        _pos = b.data();
+        _end = b.data() + b.len;
+    }
+
+    ~io_uring_file_reader() {
+        shutdown();
+    }
+
+    virtual net::packet_view peek() override {
+        if (!eof() && size_t(_end - _pos) <= file_reader_max_frame_size) {
+            advance();
+        }
+        return net::packet_view{_pos, size_t(_end - _pos)};
+    }
+
+    virtual bool eof() const override {
+        return _buffers[_current].eof;
+    }
+
+    virtual void consume(size_t len) override {
+        _pos += len;
+    }
+
+private:
+    void shutdown() {
+        // Buffers must outlive the reads that are still in flight.
+        try {
+            _ring.submit();
+            for (auto&& b : _buffers) {
+                while (b.queued && !b.done) {
+                    _buffers[_ring.wait().user_data].done = true;
+                }
+            }
+        } catch (...) {
+        }
+        ::close(_fd);
+    }
+
+    void queue(size_t idx) {
+        auto& b = _buffers[idx];
+        b.queued = false;
+        b.done = false;
+        b.len = 0;
+        b.eof = true;
+        if (_read_offset >= _file_size) {
+            return;
+        }
+        b.offset = _read_offset;
+        b.requested = std::min<uint64_t>(_window_size, _file_size - _read_offset);
+        _ring.queue_read(_fd, b.data(), b.requested, b.offset, idx);
+        b.queued = true;
+        _read_offset += b.requested;
+    }
+
+    void wait(size_t idx) {
+        auto& b = _buffers[idx];
+        if (!b.queued) {
+            return;
+        }
+        while (!b.done) {
+            auto cqe = _ring.wait();
+            auto& c = _buffers[cqe.user_data];
+            c.done = true;
+            if (cqe.res < 0) {
+                throw std::system_error(-cqe.res, std::generic_category(), "read");
+            }
+            c.len = cqe.res;
+        }
+        if (b.len < b.requested) {
+            // Complete a short read synchronously.
+            b.len += pread_full(_fd, b.data() + b.len, b.requested - b.len, b.offset + b.len);
+        }
+        b.eof = b.offset + b.len >= _file_size;
+    }
+
+    void advance() {
+        size_t next = (_current + 1) % _buffers.size();
+        wait(next);
+        auto& b = _buffers[next];
+        size_t tail = _end - _pos;
+        char* start = b.data() - tail;
+        std::memcpy(start, _pos, tail);
+        queue(_current);
+        _ring.submit();
+        _current = next;
+        _pos = start;
+        _end = b.data() + b.len;
+    }
+};
+
+#endif
+
+compression detect_compression(const std::string& filename)
+{
+    uint64_t file_size;
+    int fd = open_input(filename, file_size);
+    unsigned char magic[4] = {};
+    size_t nr = pread_full(fd, reinterpret_cast<char*>(magic), sizeof(magic), 0);
+    ::close(fd);
+    if (nr >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return compression::gzip;
+    }
+    if (nr == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        return compression::zstd;
+    }
+    return compression::none;
+}
+
+std::unique_ptr<file_reader> open_file_reader(const std::string& filename, read_mode mode, size_t window_size, uint64_t offset)
+{
+    // A window has to hold a frame wherever it starts in the window.
+    window_size = std::max(window_size, 4 * file_reader_max_frame_size);
+    switch (detect_compression(filename)) {
+    case compression::gzip:
+        return std::unique_ptr<file_reader>{new threaded_file_reader{std::unique_ptr<input_source>{new gzip_source{filename}}, window_size, file_reader_ring_size, offset}};
+    case compression::zstd:
+#ifdef HELIX_HAVE_ZSTD
+        return std::unique_ptr<file_reader>{new threaded_file_reader{std::unique_ptr<input_source>{new zstd_source{filename}}, window_size, file_reader_ring_size, offset}};
+#else
+        throw std::invalid_argument("zstd is not supported");
+#endif
+    case compression::none:
+        break;
+    }
+    switch (mode) {
+    case read_mode::mmap:
+        return std::unique_ptr<file_reader>{new mmap_file_reader{filename, window_size, offset}};
+    case read_mode::pread:
+        return std::unique_ptr<file_reader>{new threaded_file_reader{std::unique_ptr<input_source>{new pread_source{filename}}, window_size, 2, offset}};
+    case read_mode::io_uring:
+#ifdef HELIX_HAVE_IO_URING
+        return std::unique_ptr<file_reader>{new io_uring_file_reader{filename, window_size, offset}};
+#else
+        throw std::invalid_argument("io_uring is not supported");
+#endif
+    default:
+        throw std::invalid_argument("invalid read mode");
+    }
+}
+
+uint64_t replay(session& s, file_reader& reader)
+{
+    uint64_t total = 0;
+    for (;;) {
+        auto chunk = reader.peek();
+        if (!chunk.len()) {
+            break;
+        }
+        // Leave the last frame of a chunk to the next one, unless the chunk
+        // ends at the end of the file, as the frame may be incomplete.
+        size_t limit = reader.eof() ? chunk.len() : chunk.len() - file_reader_max_frame_size;
+        size_t offset = 0;
+        while (offset < limit) {
+            size_t nr = s.process_packet(net::packet_view{chunk.buf() + offset, chunk.len() - offset});
+            if (!nr) {
+                s.finish();
+                return total + offset;
+            }
+            offset += nr;
+        }
+        reader.consume(offset);
+        total += offset;
+    }
+    s.finish();
+    return total;
+}
+
+}
@@ -1,10 +1,28 @@
 #include "helix-c/helix.h"
 
 #include "helix/nasdaq/nordic_itch_protocol.hh"
+#include "helix/nasdaq/itch50_symbol_index.hh"
+#include "helix/nasdaq/itch50_sizing.hh"
 #include "helix/nasdaq/itch50_protocol.hh"
+#include "helix/nasdaq/itch50_handler.hh"
+#include "helix/nasdaq/binaryfile.hh"
 #include "helix/parity/pmd_protocol.hh"
+#include "helix/event_channel.hh"
+#include "helix/replay_index.hh"
+#include "helix/file_reader.hh"
+#include "helix/pcap_reader.hh"
+#include "helix/capture.hh"
+#include "helix/column_writer.hh"
+#include "helix/batch.hh"
 #include "helix/net.hh"
 
+#include <arpa/inet.h>
+
+#include <system_error>
+#include <type_traits>
+#include <stdexcept>
+#include <fstream>
+
 inline helix_order_book_t wrap(helix::order_book* ob)
 {
     return reinterpret_cast<helix_order_book_t>(ob);
@@ -55,12 +73,84 @@ inline helix::session* unwrap(helix_session_t session)
     return reinterpret_cast<helix::session*>(session);
 }
 
+inline helix_channel_t wrap(helix::event_channel* channel)
+{
+    return reinterpret_cast<helix_channel_t>(channel);
+}
+
+inline helix::event_channel* unwrap(helix_channel_t channel)
+{
+    return reinterpret_cast<helix::event_channel*>(channel);
+}
+
+inline helix_index_writer_t wrap(helix::replay_index_writer* writer)
+{
+    return reinterpret_cast<helix_index_writer_t>(writer);
+}
+
+inline helix::replay_index_writer* unwrap(helix_index_writer_t writer)
+{
+    return reinterpret_cast<helix::replay_index_writer*>(writer);
+}
+
+inline helix_capture_t wrap(helix::capture_writer* capture)
+{
+    return reinterpret_cast<helix_capture_t>(capture);
+}
+
+inline helix::capture_writer* unwrap(helix_capture_t capture)
+{
+    return reinterpret_cast<helix::capture_writer*>(capture);
+}
+
+inline helix_column_writer_t wrap(helix::column_writer* writer)
+{
+    return reinterpret_cast<helix_column_writer_t>(writer);
+}
+
+inline helix::column_writer* unwrap(helix_column_writer_t writer)
+{
+    return reinterpret_cast<helix::column_writer*>(writer);
+}
+
+inline helix_batch_t wrap(helix::batch_runner* batch)
+{
+    return reinterpret_cast<helix_batch_t>(batch);
+}
+
+inline helix::batch_runner* unwrap(helix_batch_t batch)
+{
+    return reinterpret_cast<helix::batch_runner*>(batch);
+}
+
+using shared_sizing_hints = std::shared_ptr<const helix::sizing_hints>;
+
+inline helix_sizing_hints_t wrap(shared_sizing_hints* hints)
+{
+    return reinterpret_cast<helix_sizing_hints_t>(hints);
+}
+
+inline shared_sizing_hints* unwrap(helix_sizing_hints_t hints)
+{
+    return reinterpret_cast<shared_sizing_hints*>(hints);
+}
+
+static_assert(sizeof(helix_event_record_t) == sizeof(helix::event_record) &&
+              std::is_standard_layout<helix::event_record>::value,
+              "helix_event_record_t does not match helix::event_record");
+
 const char *helix_strerror(int error)
 {
     switch (error) {
     case HELIX_ERROR_UNKNOWN_MESSAGE_TYPE: return "unknown message type";
     case HELIX_ERROR_TRUNCATED_PACKET: return "truncated packet";
     case HELIX_ERROR_UNKNOWN: return "unknown error";
+    case HELIX_ERROR_CHECKPOINT: return "invalid checkpoint";
+    case HELIX_ERROR_INDEX: return "invalid index";
+    case HELIX_ERROR_IO: return "I/O error";
+    case HELIX_ERROR_CAPTURE: return "invalid capture";
+    case HELIX_ERROR_SIZING_HINTS: return "invalid sizing hints";
+    case HELIX_ERROR_SYMBOL: return "invalid symbol";
     default: return "invalid error";
     }
 }
@@ -94,21 +184,521 @@ helix_session_create(helix_protocol_t proto, helix_event_callback_t callback, vo
     return wrap(session);
 }
 
+helix_session_t
+helix_session_create_parallel(helix_protocol_t proto, helix_event_callback_t callback, void *data, size_t nr_threads)
+{
+    helix::session* session;
+    try {
+        session = unwrap(proto)->new_parallel_session(data, nr_threads);
+    } catch (...) {
+        return NULL;
+    }
+    session->register_callback([session, callback](const helix::event& event) {
+        callback(wrap(session), wrap(const_cast<helix::event*>(&event)));
+    });
+    return wrap(session);
+}
+
+helix_session_t
+helix_session_create_arbitrated(helix_protocol_t proto, helix_event_callback_t callback, void *data)
+{
+    helix::session* session;
+    try {
+        session = unwrap(proto)->new_arbitrated_session(data);
+    } catch (...) {
+        return NULL;
+    }
+    session->register_callback([session, callback](const helix::event& event) {
+        callback(wrap(session), wrap(const_cast<helix::event*>(&event)));
+    });
+    return wrap(session);
+}
+
 void helix_session_destroy(helix_session_t session)
 {
     delete unwrap(session);
 }
 
-void helix_session_subscribe(helix_session_t session, const char *symbol, size_t max_orders)
+int helix_session_subscribe(helix_session_t session, const char *symbol, size_t max_orders)
+{
+    try {
+        unwrap(session)->subscribe(symbol, max_orders);
+        return 0;
+    } catch (const std::invalid_argument&) {
+        return HELIX_ERROR_SYMBOL;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+int helix_session_set_send_callback(helix_session_t session, helix_send_callback_t callback)
+{
+    try {
+        unwrap(session)->set_send_callback([session, callback](char* base, size_t len) {
+            callback(session, base, len);
+        });
+        return 0;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+void helix_session_set_retransmit_config(helix_session_t session, uint64_t timeout_us, uint64_t max_timeout_us, uint64_t coalesce_distance)
+{
+    helix::retransmit_config config;
+    config.timeout = std::chrono::microseconds{timeout_us};
+    config.max_timeout = std::chrono::microseconds{max_timeout_us};
+    config.coalesce_distance = coalesce_distance;
+    unwrap(session)->set_retransmit_config(config);
+}
+
+int helix_session_poll_retransmit(helix_session_t session)
+{
+    try {
+        unwrap(session)->poll_retransmit();
+        return 0;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+helix_retransmit_stats_t helix_session_retransmit_stats(helix_session_t session)
+{
+    auto stats = unwrap(session)->get_retransmit_stats();
+    helix_retransmit_stats_t ret;
+    ret.requests = stats.requests;
+    ret.requested_messages = stats.requested_messages;
+    ret.responses = stats.responses;
+    ret.recovered_messages = stats.recovered_messages;
+    return ret;
+}
+
+int helix_session_set_pacing(helix_session_t session, double speed, helix_pacing_clock_t clock, bool per_packet)
+{
+    helix::pacing_config config;
+    config.speed = speed;
+    switch (clock) {
+    case HELIX_PACING_CLOCK_MONOTONIC: config.clock = helix::pacing_clock::monotonic; break;
+    case HELIX_PACING_CLOCK_TSC:       config.clock = helix::pacing_clock::tsc; break;
+    default:                           return HELIX_ERROR_UNKNOWN;
+    }
+    config.per_packet = per_packet;
+    try {
+        unwrap(session)->set_pacing_config(config);
+        return 0;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+helix_pacing_stats_t helix_session_pacing_stats(helix_session_t session)
+{
+    auto stats = unwrap(session)->get_pacing_stats();
+    helix_pacing_stats_t ret;
+    ret.releases = stats.releases;
+    ret.late = stats.late;
+    ret.p50_ns = stats.p50_ns;
+    ret.p90_ns = stats.p90_ns;
+    ret.p99_ns = stats.p99_ns;
+    ret.p999_ns = stats.p999_ns;
+    ret.max_ns = stats.max_ns;
+    return ret;
+}
+
+uint64_t helix_session_position(helix_session_t session)
+{
+    return unwrap(session)->position();
+}
+
+int helix_session_save_checkpoint(helix_session_t session, const char *filename)
+{
+    try {
+        std::ofstream out{filename, std::ios::binary | std::ios::trunc};
+        helix::checkpoint_writer writer{out};
+        unwrap(session)->save_checkpoint(writer);
+        out.close();
+        if (!out) {
+            return HELIX_ERROR_CHECKPOINT;
+        }
+        return 0;
+    } catch (const helix::checkpoint_error& e) {
+        return HELIX_ERROR_CHECKPOINT;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+int helix_session_load_checkpoint(helix_session_t session, const char *filename)
+{
+    try {
+        std::ifstream in{filename, std::ios::binary};
+        helix::checkpoint_reader reader{in};
+        unwrap(session)->load_checkpoint(reader);
+        return 0;
+    } catch (const helix::checkpoint_error& e) {
+        return HELIX_ERROR_CHECKPOINT;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+int helix_session_seek(helix_session_t session, const char *index_filename, helix_timestamp_t timestamp)
+{
+    try {
+        helix::replay_index index{index_filename};
+        index.seek(timestamp, *unwrap(session));
+        return 0;
+    } catch (const helix::checkpoint_error& e) {
+        return HELIX_ERROR_CHECKPOINT;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+helix_index_writer_t helix_index_writer_create(const char *filename)
+{
+    try {
+        return wrap(new helix::replay_index_writer{filename});
+    } catch (...) {
+        return NULL;
+    }
+}
+
+int helix_index_writer_add(helix_index_writer_t writer, helix_session_t session, helix_timestamp_t timestamp)
+{
+    try {
+        unwrap(writer)->add(timestamp, *unwrap(session));
+        return 0;
+    } catch (const helix::checkpoint_error& e) {
+        return HELIX_ERROR_CHECKPOINT;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+int helix_index_writer_close(helix_index_writer_t writer)
+{
+    int ret = 0;
+    try {
+        unwrap(writer)->close();
+    } catch (const helix::checkpoint_error& e) {
+        ret = HELIX_ERROR_CHECKPOINT;
+    } catch (...) {
+        ret = HELIX_ERROR_UNKNOWN;
+    }
+    delete unwrap(writer);
+    return ret;
+}
+
+int helix_symbol_index_build(const char *index_filename, const char *buf, size_t len)
+{
+    try {
+        auto index = helix::nasdaq::itch50_symbol_index::build(buf, len);
+        index.save(index_filename);
+        return 0;
+    } catch (const helix::truncated_packet_error& e) {
+        return HELIX_ERROR_TRUNCATED_PACKET;
+    } catch (const helix::checkpoint_error& e) {
+        return HELIX_ERROR_INDEX;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+int helix_session_replay_symbols(helix_session_t session, const char *index_filename, const char *const *symbols, size_t nr_symbols, const char *buf, size_t len)
+{
+    using itch50_session = helix::nasdaq::binaryfile_session<helix::nasdaq::itch50_handler>;
+    if (!dynamic_cast<itch50_session*>(unwrap(session))) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+    try {
+        auto index = helix::nasdaq::itch50_symbol_index::load(index_filename);
+        if (index.file_size() != len) {
+            return HELIX_ERROR_INDEX;
+        }
+        auto runs = index.runs(std::vector<std::string>(symbols, symbols + nr_symbols));
+        helix::nasdaq::replay_runs(*unwrap(session), buf, len, runs);
+        return 0;
+    } catch (const helix::unknown_message_type& e) {
+        return HELIX_ERROR_UNKNOWN_MESSAGE_TYPE;
+    } catch (const helix::truncated_packet_error& e) {
+        return HELIX_ERROR_TRUNCATED_PACKET;
+    } catch (const helix::checkpoint_error& e) {
+        return HELIX_ERROR_INDEX;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+int helix_sizing_hints_build(const char *hints_filename, const char *buf, size_t len)
 {
-    unwrap(session)->subscribe(symbol, max_orders);
+    try {
+        auto hints = helix::nasdaq::itch50_scan_sizing(buf, len);
+        hints.save(hints_filename);
+        return 0;
+    } catch (const helix::truncated_packet_error& e) {
+        return HELIX_ERROR_TRUNCATED_PACKET;
+    } catch (const helix::checkpoint_error& e) {
+        return HELIX_ERROR_SIZING_HINTS;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+int helix_session_load_sizing_hints(helix_session_t session, const char *filename)
+{
+    try {
+        auto hints = std::make_shared<helix::sizing_hints>(helix::sizing_hints::load(filename));
+        unwrap(session)->set_sizing_hints(hints);
+        return 0;
+    } catch (const helix::checkpoint_error& e) {
+        return HELIX_ERROR_SIZING_HINTS;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
 }
 
-void helix_session_set_send_callback(helix_session_t session, helix_send_callback_t callback)
+int helix_sizing_hints_load(const char *filename, helix_sizing_hints_t *hints)
 {
-    unwrap(session)->set_send_callback([session, callback](char* base, size_t len) {
-        callback(session, base, len);
+    try {
+        *hints = wrap(new shared_sizing_hints{std::make_shared<helix::sizing_hints>(helix::sizing_hints::load(filename))});
+        return 0;
+    } catch (const helix::checkpoint_error& e) {
+        return HELIX_ERROR_SIZING_HINTS;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+void helix_sizing_hints_destroy(helix_sizing_hints_t hints)
+{
+    delete unwrap(hints);
+}
+
+void helix_session_set_sizing_hints(helix_session_t session, helix_sizing_hints_t hints)
+{
+    unwrap(session)->set_sizing_hints(*unwrap(hints));
+}
+
+static bool to_read_mode(helix_read_mode_t mode, helix::read_mode& read_mode)
+{
+    switch (mode) {
+    case HELIX_READ_MMAP:     read_mode = helix::read_mode::mmap; return true;
+    case HELIX_READ_PREAD:    read_mode = helix::read_mode::pread; return true;
+    case HELIX_READ_IO_URING: read_mode = helix::read_mode::io_uring; return true;
+    default:                  return false;
+    }
+}
+
+int helix_session_replay_file(helix_session_t session, const char *filename, helix_read_mode_t mode, size_t window_size, uint64_t offset)
+{
+    helix::read_mode read_mode;
+    if (!to_read_mode(mode, read_mode)) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+    if (!window_size) {
+        window_size = helix::file_reader_window_size;
+    }
+    try {
+        auto reader = helix::open_file_reader(filename, read_mode, window_size, offset);
+        helix::replay(*unwrap(session), *reader);
+        return 0;
+    } catch (const helix::unknown_message_type& e) {
+        return HELIX_ERROR_UNKNOWN_MESSAGE_TYPE;
+    } catch (const helix::truncated_packet_error& e) {
+        return HELIX_ERROR_TRUNCATED_PACKET;
+    } catch (const std::system_error& e) {
+        return HELIX_ERROR_IO;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+bool helix_file_is_compressed(const char *filename)
+{
+    try {
+        return helix::detect_compression(filename) != helix::compression::none;
+    } catch (...) {
+        return false;
+    }
+}
+
+int helix_session_replay_pcap(helix_session_t session, const char *filename, const char *addr, int port, bool honor_timestamps)
+{
+    helix::pcap_filter filter;
+    if (addr && inet_pton(AF_INET, addr, &filter.addr) != 1) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+    filter.port = port;
+    try {
+        helix::pcap_reader reader{filename, filter};
+        helix::replay(*unwrap(session), reader, honor_timestamps);
+        return 0;
+    } catch (const helix::unknown_message_type& e) {
+        return HELIX_ERROR_UNKNOWN_MESSAGE_TYPE;
+    } catch (const helix::truncated_packet_error& e) {
+        return HELIX_ERROR_TRUNCATED_PACKET;
+    } catch (const helix::pcap_error& e) {
+        return HELIX_ERROR_CAPTURE;
+    } catch (const std::system_error& e) {
+        return HELIX_ERROR_IO;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+int helix_session_replay_capture(helix_session_t session, const char *filename, bool honor_timestamps)
+{
+    try {
+        helix::capture_reader reader{filename};
+        helix::replay(*unwrap(session), reader, honor_timestamps);
+        return 0;
+    } catch (const helix::unknown_message_type& e) {
+        return HELIX_ERROR_UNKNOWN_MESSAGE_TYPE;
+    } catch (const helix::truncated_packet_error& e) {
+        return HELIX_ERROR_TRUNCATED_PACKET;
+    } catch (const helix::capture_error& e) {
+        return HELIX_ERROR_CAPTURE;
+    } catch (const std::system_error& e) {
+        return HELIX_ERROR_IO;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+helix_capture_t helix_capture_open(const char *filename)
+{
+    try {
+        return wrap(new helix::capture_writer{filename});
+    } catch (...) {
+        return NULL;
+    }
+}
+
+void helix_capture_record(helix_capture_t capture, helix_timestamp_t timestamp, size_t line, const char *buf, size_t len)
+{
+    unwrap(capture)->record(timestamp, line, helix::net::packet_view{buf, len});
+}
+
+uint64_t helix_capture_dropped(helix_capture_t capture)
+{
+    return unwrap(capture)->stats().dropped;
+}
+
+int helix_capture_close(helix_capture_t capture)
+{
+    int ret = 0;
+    try {
+        unwrap(capture)->close();
+    } catch (const std::system_error& e) {
+        ret = HELIX_ERROR_IO;
+    } catch (...) {
+        ret = HELIX_ERROR_UNKNOWN;
+    }
+    delete unwrap(capture);
+    return ret;
+}
+
+helix_column_writer_t helix_column_writer_create(const char *filename, const helix_column_t *columns, size_t nr_columns)
+{
+    try {
+        std::vector<helix::column> cols;
+        for (size_t i = 0; i < nr_columns; i++) {
+            cols.push_back(helix::column{columns[i].name, columns[i].width, columns[i].scale});
+        }
+        return wrap(new helix::column_writer{filename, cols});
+    } catch (...) {
+        return NULL;
+    }
+}
+
+uint32_t helix_column_writer_intern(helix_column_writer_t writer, const char *s)
+{
+    return unwrap(writer)->intern(s);
+}
+
+void helix_column_writer_append(helix_column_writer_t writer, const uint64_t *values)
+{
+    unwrap(writer)->append(values);
+}
+
+int helix_column_writer_close(helix_column_writer_t writer)
+{
+    int ret = 0;
+    try {
+        unwrap(writer)->close();
+    } catch (const std::system_error& e) {
+        ret = HELIX_ERROR_IO;
+    } catch (...) {
+        ret = HELIX_ERROR_UNKNOWN;
+    }
+    delete unwrap(writer);
+    return ret;
+}
+
+helix_batch_t helix_batch_create(size_t nr_threads, size_t max_sessions, helix_read_mode_t mode)
+{
+    helix::batch_config config;
+    config.nr_threads = nr_threads;
+    config.max_sessions = max_sessions;
+    if (!to_read_mode(mode, config.mode)) {
+        return NULL;
+    }
+    return wrap(new helix::batch_runner{config});
+}
+
+int helix_batch_add(helix_batch_t batch, helix_protocol_t proto, const char *filename)
+{
+    try {
+        unwrap(batch)->add(helix::batch_file{filename, unwrap(proto)});
+        return 0;
+    } catch (...) {
+        return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+size_t helix_batch_run(helix_batch_t batch, helix_batch_session_callback_t callback, void *data)
+{
+    unwrap(batch)->run([callback, data](size_t index, const helix::batch_file& file) {
+        return std::unique_ptr<helix::session>{unwrap(callback(wrap(file.proto), index, file.filename.c_str(), data))};
     });
+    return unwrap(batch)->stats().failed;
+}
+
+helix_batch_file_stats_t helix_batch_file_stats(helix_batch_t batch, size_t index)
+{
+    auto& stats = unwrap(batch)->file_stats(index);
+    helix_batch_file_stats_t ret;
+    ret.size = stats.size;
+    ret.bytes = stats.bytes;
+    ret.duration_ns = stats.duration_ns;
+    ret.worker = stats.worker;
+    ret.stolen = stats.stolen;
+    ret.error = 0;
+    if (stats.error) {
+        try {
+            std::rethrow_exception(stats.error);
+        } catch (const helix::unknown_message_type& e) {
+            ret.error = HELIX_ERROR_UNKNOWN_MESSAGE_TYPE;
+        } catch (const helix::truncated_packet_error& e) {
+            ret.error = HELIX_ERROR_TRUNCATED_PACKET;
+        } catch (const std::system_error& e) {
+            ret.error = HELIX_ERROR_IO;
+        } catch (...) {
+            ret.error = HELIX_ERROR_UNKNOWN;
+        }
+    }
+    return ret;
+}
+
+size_t helix_batch_nr_workers(helix_batch_t batch)
+{
+    return unwrap(batch)->nr_workers();
+}
+
+void helix_batch_destroy(helix_batch_t batch)
+{
+    delete unwrap(batch);
 }
 
 void *helix_session_data(helix_session_t session)
@@ -134,6 +724,50 @@ int helix_session_process_packet(helix_session_t session, const char* buf, size_
     }
 }
 
+int helix_session_finish(helix_session_t session)
+{
+    try {
+        unwrap(session)->finish();
+        return 0;
+    } catch (const helix::unknown_message_type& e) {
+        return HELIX_ERROR_UNKNOWN_MESSAGE_TYPE;
+    } catch (const helix::truncated_packet_error& e) {
+        return HELIX_ERROR_TRUNCATED_PACKET;
+    } catch (...) {
+       return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+int helix_session_process_line_packet(helix_session_t session, size_t line, const char* buf, size_t len)
+{
+    try {
+        return unwrap(session)->process_line_packet(line, helix::net::packet_view{buf, len});
+    } catch (const helix::unknown_message_type& e) {
+        return HELIX_ERROR_UNKNOWN_MESSAGE_TYPE;
+    } catch (const helix::truncated_packet_error& e) {
+        return HELIX_ERROR_TRUNCATED_PACKET;
+    } catch (...) {
+       return HELIX_ERROR_UNKNOWN;
+    }
+}
+
+helix_line_stats_t helix_session_line_stats(helix_session_t session, size_t line)
+{
+    helix_line_stats_t ret = {};
+    try {
+        auto stats = unwrap(session)->get_line_stats(line);
+        ret.packets = stats.packets;
+        ret.forwarded = stats.forwarded;
+        ret.duplicates = stats.duplicates;
+        ret.lost_messages = stats.lost_messages;
+        ret.lead_ns = stats.lead_ns;
+        ret.lag_ns = stats.lag_ns;
+        ret.max_lag_ns = stats.max_lag_ns;
+    } catch (...) {
+    }
+    return ret;
+}
+
 helix_event_mask_t helix_event_mask(helix_event_t ev)
 {
     return static_cast<helix_event_mask_t>(unwrap(ev)->get_mask());
@@ -241,3 +875,64 @@ helix_trade_sign_t helix_trade_sign(helix_trade_t trade)
     case helix::trade_sign::non_displayable:  return HELIX_TRADE_SIGN_NON_DISPLAYABLE;
     }
 }
+
+helix_channel_t helix_channel_create(size_t capacity, helix_backpressure_t policy)
+{
+    helix::backpressure bp;
+    switch (policy) {
+    case HELIX_BACKPRESSURE_BLOCK:       bp = helix::backpressure::block; break;
+    case HELIX_BACKPRESSURE_DROP_OLDEST: bp = helix::backpressure::drop_oldest; break;
+    case HELIX_BACKPRESSURE_CONFLATE:    bp = helix::backpressure::conflate; break;
+    default:                             return NULL;
+    }
+    try {
+        return wrap(new helix::event_channel{capacity, bp});
+    } catch (...) {
+        return NULL;
+    }
+}
+
+void helix_channel_destroy(helix_channel_t channel)
+{
+    delete unwrap(channel);
+}
+
+uint32_t helix_channel_add_symbol(helix_channel_t channel, const char *symbol)
+{
+    return unwrap(channel)->add_symbol(symbol);
+}
+
+const char *helix_channel_symbol(helix_channel_t channel, uint32_t symbol_id)
+{
+    return unwrap(channel)->symbol(symbol_id).c_str();
+}
+
+bool helix_channel_publish(helix_channel_t channel, helix_event_t ev)
+{
+    return unwrap(channel)->publish(*unwrap(ev));
+}
+
+size_t helix_channel_add_consumer(helix_channel_t channel)
+{
+    return unwrap(channel)->add_consumer();
+}
+
+size_t helix_channel_consume(helix_channel_t channel, size_t consumer, helix_event_record_t *records, size_t max_count)
+{
+    return unwrap(channel)->consume(consumer, reinterpret_cast<helix::event_record*>(records), max_count);
+}
+
+void helix_channel_close(helix_channel_t channel)
+{
+    unwrap(channel)->close();
+}
+
+bool helix_channel_is_closed(helix_channel_t channel)
+{
+    return unwrap(channel)->is_closed();
+}
+
+uint64_t helix_channel_dropped(helix_channel_t channel, size_t consumer)
+{
+    return unwrap(channel)->dropped(consumer);
+}
@@ -0,0 +1,119 @@
+#include "helix/incremental_map.hh"
+
+#include <sys/mman.h>
+
+#include <condition_variable>
+#include <algorithm>
+#include <thread>
+#include <deque>
+#include <mutex>
+
+namespace helix {
+
+namespace {
+
+//! Number of bytes that the pager faults in between checks for cancellation.
+constexpr size_t pager_chunk = 2 * 1024 * 1024;
+
+#ifdef MADV_POPULATE_WRITE
+constexpr int populate_advice = MADV_POPULATE_WRITE;
+#else
+//! MADV_POPULATE_WRITE, which older C libraries do not define.
+constexpr int populate_advice = 23;
+#endif
+
+struct pager_request {
+    char* addr;
+    size_t len;
+    bool unmap;
+};
+
+// Pager thread.
+//
+// An unmap cancels the requests to fault in the same mapping, including the
+// one that is running, which stops at the next chunk. As requests run in
+// order, the mapping is unmapped only after that.
+class pager {
+    std::mutex _lock;
+    std::condition_variable _cond;
+    std::deque<pager_request> _requests;
+    //! Mapping that is being faulted in, if any.
+    char* _current = nullptr;
+    bool _cancel = false;
+public:
+    pager() {
+        // The thread is never joined, so that exiting never waits for it.
+        std::thread{&pager::run, this}.detach();
+    }
+
+    void submit(const pager_request& req) {
+        {
+            std::lock_guard<std::mutex> guard{_lock};
+            if (req.unmap) {
+                _requests.erase(std::remove_if(_requests.begin(), _requests.end(), [&req](const pager_request& r) {
+                    return !r.unmap && r.addr == req.addr;
+                }), _requests.end());
+                if (_current == req.addr) {
+                    _cancel = true;
+                }
+            }
+            _requests.push_back(req);
+        }
+        _cond.notify_one();
+    }
+
+private:
+    void run() {
+        for (;;) {
+            pager_request req;
+            {
+                std::unique_lock<std::mutex> guard{_lock};
+                _cond.wait(guard, [this] { return !_requests.empty(); });
+                req = _requests.front();
+                _requests.pop_front();
+                if (!req.unmap) {
+                    _current = req.addr;
+                    _cancel = false;
+                }
+            }
+            if (req.unmap) {
+                munmap(req.addr, req.len);
+                continue;
+            }
+            for (size_t off = 0; off < req.len; off += pager_chunk) {
+                {
+                    std::lock_guard<std::mutex> guard{_lock};
+                    if (_cancel) {
+                        break;
+                    }
+                }
+                if (madvise(req.addr + off, std::min(pager_chunk, req.len - off), populate_advice) < 0) {
+                    break;
+                }
+            }
+            std::lock_guard<std::mutex> guard{_lock};
+            _current = nullptr;
+        }
+    }
+};
+
+pager& the_pager()
+{
+    // Never destroyed, as the thread outlives it.
+    static pager* p = new pager;
+    return *p;
+}
+
+}
+
+void pager_prefault(void* addr, size_t len)
+{
+    the_pager().submit(pager_request{static_cast<char*>(addr), len, false});
+}
+
+void pager_unmap(void* addr, size_t len)
+{
+    the_pager().submit(pager_request{static_cast<char*>(addr), len, true});
+}
+
+}
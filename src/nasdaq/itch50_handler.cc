@@ -47,23 +47,23 @@ bool itch50_handler::is_rth_timestamp(uint64_t timestamp) const
 }
 
 void itch50_handler::subscribe(std::string sym, size_t max_orders) {
-    auto padding = ITCH_SYMBOL_LEN - sym.size();
-    if (padding > 0) {
-        sym.insert(sym.size(), padding, ' ');
+    if (sym.size() > sizeof(itch50_stock_directory::Stock)) {
+        throw std::invalid_argument("symbol is too long: " + sym);
     }
-    _symbols.insert(sym);
-    _symbol_max_orders.emplace(sym, max_orders);
-    size_t max_all_orders = 0;
-    for (auto&& kv : _symbol_max_orders) {
-        max_all_orders += kv.second;
-    }
-    order_book_id_map.reserve(max_all_orders);
+    _subscriptions.insert(sym, max_orders);
+    // Orders are sized in their order books; the map holds one book per symbol.
+    order_book_id_map.reserve(_subscriptions.size());
 }
 
 void itch50_handler::register_callback(event_callback callback) {
     _process_event = callback;
 }
 
+void itch50_handler::set_pacer(pacer* p)
+{
+    _pacer = p;
+}
+
 size_t itch50_handler::process_packet(const net::packet_view& packet)
 {
     auto* msg = packet.cast<itch50_message>();
@@ -92,10 +92,23 @@ size_t itch50_handler::process_packet(const net::packet_view& packet)
     }
 }
 
+uint64_t itch50_handler::shard_key(const net::packet_view& packet)
+{
+    // Every message type has StockLocate right after MessageType.
+    return be16toh(packet.cast<itch50_system_event>()->StockLocate);
+}
+
 template<typename T>
 size_t itch50_handler::process_msg(const net::packet_view& packet)
 {
-    process_msg(packet.cast<T>());
+    if (packet.len() < sizeof(T)) {
+        throw truncated_packet_error("ITCH 5.0 message is truncated");
+    }
+    auto* m = packet.cast<T>();
+    if (_pacer) {
+        _pacer->pace(itch50_timestamp(m->Timestamp));
+    }
+    process_msg(m);
     return sizeof(T);
 }
 
@@ -105,9 +118,9 @@ void itch50_handler::process_msg(const itch50_system_event* m)
 
 void itch50_handler::process_msg(const itch50_stock_directory* m)
 {
-    std::string sym{m->Stock, ITCH_SYMBOL_LEN};
-    if (_symbols.count(sym) > 0) {
-        order_book ob{sym, itch50_timestamp(m->Timestamp), _symbol_max_orders.at(sym)};
+    auto* max_orders = _subscriptions.find(_subscriptions.key(m->Stock));
+    if (max_orders) {
+        order_book ob{std::string{m->Stock, ITCH_SYMBOL_LEN}, itch50_timestamp(m->Timestamp), *max_orders};
         order_book_id_map.insert({m->StockLocate, std::move(ob)});
     }
 }
@@ -292,6 +305,33 @@ void itch50_handler::process_msg(const itch50_rpii* m)
 {
 }
 
+void itch50_handler::save(checkpoint_writer& writer) const
+{
+    writer.write_tag("itch50");
+    writer.write_u64(order_book_id_map.size());
+    for (auto&& kv : order_book_id_map) {
+        writer.write_u64(kv.first);
+        kv.second.save(writer);
+    }
+}
+
+void itch50_handler::load(checkpoint_reader& reader)
+{
+    reader.read_tag("itch50");
+    order_book_id_map.clear();
+    auto count = reader.read_u64();
+    for (uint64_t i = 0; i < count; i++) {
+        auto order_book_id = reader.read_u64();
+        auto ob = order_book::load(reader, [this](const std::string& symbol) {
+            auto* max_orders = _subscriptions.find(symbol);
+            return max_orders ? *max_orders : 0;
+        });
+        if (_subscriptions.find(ob.symbol())) {
+            order_book_id_map.insert({order_book_id, std::move(ob)});
+        }
+    }
+}
+
 event_mask itch50_handler::sweep_event(const execution& e) const
 {
     if (e.remaining > 0) {
@@ -1,6 +1,7 @@
 #include "helix/nasdaq/itch50_protocol.hh"
 
 #include "helix/nasdaq/itch50_handler.hh"
+#include "helix/nasdaq/binaryfile_parallel.hh"
 #include "helix/nasdaq/binaryfile.hh"
 
 namespace helix {
@@ -26,6 +27,15 @@ session* itch50_protocol::new_session(void *data)
     }
 }
 
+session* itch50_protocol::new_parallel_session(void *data, size_t nr_threads)
+{
+    if (_name == "nasdaq-binaryfile-itch50") {
+        return new parallel_binaryfile_session<itch50_handler>(data, nr_threads);
+    } else {
+        throw std::invalid_argument("unknown protocol: " + _name);
+    }
+}
+
 }
 
 }
@@ -0,0 +1,203 @@
+#include "helix/nasdaq/itch50_sizing.hh"
+
+#include "helix/nasdaq/itch50_messages.h"
+#include "helix/compat/endian.h"
+#include "helix/helix.hh"
+#include "helix/net.hh"
+
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace helix {
+
+namespace nasdaq {
+
+namespace {
+
+//! Expected number of orders that are live at a time over the whole market.
+constexpr size_t sizing_scan_orders = 1024 * 1024;
+
+struct live_order {
+    uint16_t stock_locate;
+    bool     buy;
+    uint32_t price;
+    uint32_t shares;
+};
+
+struct stock_book {
+    std::string symbol;
+    uint64_t orders = 0;
+    //! Number of live orders at every price.
+    std::unordered_map<uint32_t, uint32_t> bids;
+    std::unordered_map<uint32_t, uint32_t> asks;
+    symbol_sizing peak;
+};
+
+class sizing_scan {
+    std::unordered_map<uint16_t, stock_book> _stocks;
+    std::unordered_map<uint64_t, live_order> _orders;
+public:
+    sizing_scan() {
+        _orders.reserve(sizing_scan_orders);
+    }
+
+    void directory(uint16_t stock_locate, const char* stock) {
+        _stocks[stock_locate].symbol.assign(stock, ITCH_SYMBOL_LEN);
+    }
+
+    void add(uint16_t stock_locate, uint64_t ref, bool buy, uint32_t price, uint32_t shares) {
+        if (!_orders.emplace(ref, live_order{stock_locate, buy, price, shares}).second) {
+            return;
+        }
+        auto& stock = _stocks[stock_locate];
+        auto& peak = stock.peak;
+        peak.max_orders = std::max(peak.max_orders, ++stock.orders);
+        if (buy) {
+            stock.bids[price]++;
+            peak.max_bid_levels = std::max<uint64_t>(peak.max_bid_levels, stock.bids.size());
+        } else {
+            stock.asks[price]++;
+            peak.max_ask_levels = std::max<uint64_t>(peak.max_ask_levels, stock.asks.size());
+        }
+    }
+
+    //! Take @shares off an order, which leaves the book when none are left.
+    void reduce(uint64_t ref, uint32_t shares) {
+        auto it = _orders.find(ref);
+        if (it == _orders.end()) {
+            return;
+        }
+        if (shares < it->second.shares) {
+            it->second.shares -= shares;
+            return;
+        }
+        remove(it);
+    }
+
+    void remove(uint64_t ref) {
+        auto it = _orders.find(ref);
+        if (it != _orders.end()) {
+            remove(it);
+        }
+    }
+
+    //! Replace an order with a new one of the same stock and side.
+    void replace(uint64_t ref, uint64_t new_ref, uint32_t price, uint32_t shares) {
+        auto it = _orders.find(ref);
+        if (it == _orders.end()) {
+            return;
+        }
+        auto order = it->second;
+        remove(it);
+        add(order.stock_locate, new_ref, order.buy, price, shares);
+    }
+
+    sizing_hints hints() const {
+        sizing_hints result;
+        for (auto&& kv : _stocks) {
+            if (!kv.second.symbol.empty()) {
+                result.set(kv.second.symbol, kv.second.peak);
+            }
+        }
+        return result;
+    }
+
+private:
+    void remove(std::unordered_map<uint64_t, live_order>::iterator it) {
+        auto& order = it->second;
+        auto& stock = _stocks[order.stock_locate];
+        auto& levels = order.buy ? stock.bids : stock.asks;
+        auto level = levels.find(order.price);
+        if (level != levels.end() && !--level->second) {
+            levels.erase(level);
+        }
+        stock.orders--;
+        _orders.erase(it);
+    }
+};
+
+}
+
+sizing_hints itch50_scan_sizing(const char* buf, size_t len)
+{
+    sizing_scan scan;
+    size_t offset = 0;
+    while (len - offset >= sizeof(uint16_t)) {
+        uint16_t payload_len;
+        std::memcpy(&payload_len, buf + offset, sizeof(payload_len));
+        payload_len = be16toh(payload_len);
+        if (!payload_len) {
+            // End of session.
+            break;
+        }
+        size_t next_offset = offset + sizeof(uint16_t) + payload_len;
+        if (next_offset > len) {
+            throw truncated_packet_error("BinaryFILE frame is truncated");
+        }
+        net::packet_view packet{buf + offset + sizeof(uint16_t), payload_len};
+        offset = next_offset;
+        switch (packet.buf()[0]) {
+        case 'R': {
+            if (payload_len < sizeof(itch50_stock_directory)) {
+                break;
+            }
+            auto* m = packet.cast<itch50_stock_directory>();
+            scan.directory(m->StockLocate, m->Stock);
+            break;
+        }
+        case 'A':
+        case 'F': {
+            // Add Order with MPID Attribution starts with an Add Order.
+            if (payload_len < sizeof(itch50_add_order)) {
+                break;
+            }
+            auto* m = packet.cast<itch50_add_order>();
+            scan.add(m->StockLocate, be64toh(m->OrderReferenceNumber), m->BuySellIndicator == 'B', be32toh(m->Price), be32toh(m->Shares));
+            break;
+        }
+        case 'E':
+        case 'C': {
+            // Order Executed with Price starts with an Order Executed.
+            if (payload_len < sizeof(itch50_order_executed)) {
+                break;
+            }
+            auto* m = packet.cast<itch50_order_executed>();
+            scan.reduce(be64toh(m->OrderReferenceNumber), be32toh(m->ExecutedShares));
+            break;
+        }
+        case 'X': {
+            if (payload_len < sizeof(itch50_order_cancel)) {
+                break;
+            }
+            auto* m = packet.cast<itch50_order_cancel>();
+            scan.reduce(be64toh(m->OrderReferenceNumber), be32toh(m->CanceledShares));
+            break;
+        }
+        case 'D': {
+            if (payload_len < sizeof(itch50_order_delete)) {
+                break;
+            }
+            auto* m = packet.cast<itch50_order_delete>();
+            scan.remove(be64toh(m->OrderReferenceNumber));
+            break;
+        }
+        case 'U': {
+            if (payload_len < sizeof(itch50_order_replace)) {
+                break;
+            }
+            auto* m = packet.cast<itch50_order_replace>();
+            scan.replace(be64toh(m->OriginalOrderReferenceNumber), be64toh(m->NewOrderReferenceNumber), be32toh(m->Price), be32toh(m->Shares));
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return scan.hints();
+}
+
+}
+
+}
@@ -0,0 +1,234 @@
+#include "helix/nasdaq/itch50_symbol_index.hh"
+
+#include "helix/nasdaq/itch50_messages.h"
+#include "helix/compat/endian.h"
+#include "helix/checkpoint.hh"
+#include "helix/net.hh"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+
+namespace helix {
+
+namespace nasdaq {
+
+static const std::string symbol_index_tag = "itch50-symbol-index";
+
+//! Maximum length of a variable-length encoded integer.
+static constexpr size_t varint_max_len = 10;
+
+static void put_varint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
+
+static uint64_t get_varint(const uint8_t*& p, const uint8_t* end)
+{
+    uint64_t value = 0;
+    for (unsigned shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        value |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return value;
+        }
+    }
+    throw checkpoint_error("symbol index is corrupted");
+}
+
+itch50_symbol_index itch50_symbol_index::build(const char* buf, size_t len)
+{
+    itch50_symbol_index index;
+    index._file_size = len;
+    size_t offset = 0;
+    while (len - offset >= sizeof(uint16_t)) {
+        uint16_t payload_len;
+        std::memcpy(&payload_len, buf + offset, sizeof(payload_len));
+        payload_len = be16toh(payload_len);
+        if (!payload_len) {
+            // End of session.
+            break;
+        }
+        size_t next_offset = offset + sizeof(uint16_t) + payload_len;
+        if (next_offset > len) {
+            throw truncated_packet_error("BinaryFILE frame is truncated");
+        }
+        auto* payload = buf + offset + sizeof(uint16_t);
+        if (payload_len >= sizeof(itch50_system_event)) {
+            net::packet_view packet{payload, payload_len};
+            uint16_t stock_locate = be16toh(packet.cast<itch50_system_event>()->StockLocate);
+            if (stock_locate) {
+                if (payload[0] == 'R' && payload_len >= sizeof(itch50_stock_directory)) {
+                    auto* m = packet.cast<itch50_stock_directory>();
+                    index._stocks[stock_locate].symbol.assign(m->Stock, ITCH_SYMBOL_LEN);
+                }
+                index.add_frame(stock_locate, offset, next_offset);
+            }
+        }
+        offset = next_offset;
+    }
+    for (auto&& kv : index._stocks) {
+        close_run(kv.second);
+    }
+    return index;
+}
+
+void itch50_symbol_index::add_frame(uint16_t stock_locate, uint64_t offset, uint64_t next_offset)
+{
+    auto& s = _stocks[stock_locate];
+    if (s.last.count && s.next_offset == offset) {
+        s.last.count++;
+    } else {
+        close_run(s);
+        s.last = frame_run{offset, 1};
+    }
+    s.next_offset = next_offset;
+    s.nr_frames++;
+}
+
+void itch50_symbol_index::close_run(stock& s)
+{
+    if (!s.last.count) {
+        return;
+    }
+    put_varint(s.runs, s.last.offset - s.last_offset);
+    put_varint(s.runs, s.last.count);
+    s.last_offset = s.last.offset;
+    s.last.count = 0;
+    s.nr_runs++;
+}
+
+itch50_symbol_index itch50_symbol_index::load(const std::string& filename)
+{
+    std::ifstream in{filename, std::ios::binary};
+    checkpoint_reader reader{in};
+    reader.read_tag(symbol_index_tag);
+    itch50_symbol_index index;
+    index._file_size = reader.read_u64();
+    auto count = reader.read_u64();
+    for (uint64_t i = 0; i < count; i++) {
+        auto stock_locate = reader.read_u64();
+        auto& s = index._stocks[stock_locate];
+        s.symbol = reader.read_string();
+        s.nr_frames = reader.read_u64();
+        s.nr_runs = reader.read_u64();
+        auto size = reader.read_u64();
+        if (size > s.nr_runs * 2 * varint_max_len) {
+            throw checkpoint_error("symbol index is corrupted");
+        }
+        s.runs.resize(size);
+        reader.read_bytes(s.runs.data(), size);
+    }
+    return index;
+}
+
+void itch50_symbol_index::save(const std::string& filename) const
+{
+    std::ofstream out{filename, std::ios::binary | std::ios::trunc};
+    checkpoint_writer writer{out};
+    writer.write_tag(symbol_index_tag);
+    writer.write_u64(_file_size);
+    writer.write_u64(_stocks.size());
+    for (auto&& kv : _stocks) {
+        auto& s = kv.second;
+        writer.write_u64(kv.first);
+        writer.write_string(s.symbol);
+        writer.write_u64(s.nr_frames);
+        writer.write_u64(s.nr_runs);
+        writer.write_u64(s.runs.size());
+        writer.write_bytes(s.runs.data(), s.runs.size());
+    }
+    out.close();
+    if (!out) {
+        throw checkpoint_error("unable to write symbol index");
+    }
+}
+
+std::vector<frame_run> itch50_symbol_index::runs(const std::vector<std::string>& symbols) const
+{
+    std::vector<std::string> padded;
+    for (auto sym : symbols) {
+        if (sym.size() < ITCH_SYMBOL_LEN) {
+            sym.insert(sym.size(), ITCH_SYMBOL_LEN - sym.size(), ' ');
+        }
+        padded.emplace_back(std::move(sym));
+    }
+    std::vector<bool> found(padded.size());
+    std::vector<frame_run> result;
+    for (auto&& kv : _stocks) {
+        auto& s = kv.second;
+        bool wanted = false;
+        for (size_t i = 0; i < padded.size(); i++) {
+            if (padded[i] == s.symbol) {
+                found[i] = wanted = true;
+            }
+        }
+        if (!wanted) {
+            continue;
+        }
+        const uint8_t* p = s.runs.data();
+        const uint8_t* end = p + s.runs.size();
+        uint64_t offset = 0;
+        for (uint64_t i = 0; i < s.nr_runs; i++) {
+            offset += get_varint(p, end);
+            auto count = get_varint(p, end);
+            result.push_back(frame_run{offset, count});
+        }
+    }
+    for (size_t i = 0; i < found.size(); i++) {
+        if (!found[i]) {
+            throw checkpoint_error("symbol is not in index: " + symbols[i]);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const frame_run& a, const frame_run& b) {
+        return a.offset < b.offset;
+    });
+    return result;
+}
+
+void replay_runs(session& s, const char* buf, size_t len, const std::vector<frame_run>& runs)
+{
+    const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    auto page_of = [page_size](const char* p) {
+        return reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(p) & ~(page_size - 1));
+    };
+    auto prefetch = [&](const frame_run& r) {
+        if (r.offset < len) {
+            // A frame may straddle a page boundary.
+            madvise(page_of(buf + r.offset), 2 * page_size, MADV_WILLNEED);
+        }
+    };
+    // Failing advice only costs performance, for example if the buffer is not
+    // memory-mapped, so errors are ignored.
+    auto* base = page_of(buf);
+    madvise(base, buf + len - base, MADV_RANDOM);
+    for (size_t i = 0; i < std::min(runs.size(), symbol_index_prefetch_distance); i++) {
+        prefetch(runs[i]);
+    }
+    for (size_t i = 0; i < runs.size(); i++) {
+        if (i + symbol_index_prefetch_distance < runs.size()) {
+            prefetch(runs[i + symbol_index_prefetch_distance]);
+        }
+        uint64_t offset = runs[i].offset;
+        for (uint64_t j = 0; j < runs[i].count; j++) {
+            if (offset >= len) {
+                throw truncated_packet_error("BinaryFILE frame is out of bounds");
+            }
+            size_t nr = s.process_packet(net::packet_view{buf + offset, len - offset});
+            if (!nr) {
+                return;
+            }
+            offset += nr;
+        }
+    }
+}
+
+}
+
+}
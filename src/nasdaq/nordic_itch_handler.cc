@@ -1,9 +1,11 @@
 #include "helix/nasdaq/nordic_itch_handler.hh"
 
 #include "helix/nasdaq/nordic_itch_messages.h"
+#include "helix/nasdaq/nordic_itch_decode.hh"
 #include "helix/order_book.hh"
 
 #include <unordered_map>
+#include <algorithm>
 #include <stdexcept>
 #include <cstring>
 #include <cstdint>
@@ -24,10 +26,12 @@ nordic_itch_handler::nordic_itch_handler()
 
 void nordic_itch_handler::subscribe(std::string sym, size_t max_orders)
 {
-    _symbols.insert(sym);
-    _symbol_max_orders.emplace(sym, max_orders);
+    if (sym.size() > sizeof(itch_order_book_directory::Symbol)) {
+        throw std::invalid_argument("symbol is too long: " + sym);
+    }
+    _subscriptions.insert(sym, max_orders);
     size_t max_all_orders = 0;
-    for (auto&& kv : _symbol_max_orders) {
+    for (auto&& kv : _subscriptions) {
          max_all_orders += kv.second;
     }
     order_id_map.reserve(max_all_orders);
@@ -66,9 +70,17 @@ bool nordic_itch_handler::is_rth_timestamp(uint64_t timestamp) const
     return timestamp >= rth_start && timestamp < rth_end;
 }
 
+void nordic_itch_handler::set_pacer(pacer* p)
+{
+    _pacer = p;
+}
+
 size_t nordic_itch_handler::process_packet(const net::packet_view& packet)
 {
     auto* msg = packet.cast<itch_message>();
+    if (_pacer && msg->MsgType != 'T' && msg->MsgType != 'M') {
+        _pacer->pace(timestamp() * 1000000);
+    }
     switch (msg->MsgType) {
     case 'T': return process_msg<itch_seconds>(packet);
     case 'M': return process_msg<itch_milliseconds>(packet);
@@ -90,6 +102,16 @@ size_t nordic_itch_handler::process_packet(const net::packet_view& packet)
     }
 }
 
+void nordic_itch_handler::process_packets(const net::packet_view* packets, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        auto nr = process_packet(packets[i]);
+        if (nr > packets[i].len()) {
+            throw std::runtime_error("parsed message is larger than the framing");
+        }
+    }
+}
+
 template<typename T>
 size_t nordic_itch_handler::process_msg(const net::packet_view& packet)
 {
@@ -99,13 +121,13 @@ size_t nordic_itch_handler::process_msg(const net::packet_view& packet)
 
 void nordic_itch_handler::process_msg(const itch_seconds* m)
 {
-    auto second = itch_uatoi(m->Second, 5);
+    auto second = itch_decode(m->Second);
     time_sec = second;
 }
 
 void nordic_itch_handler::process_msg(const itch_milliseconds* m)
 {
-    auto millisecond = itch_uatoi(m->Millisecond, 3);
+    auto millisecond = itch_decode(m->Millisecond);
     time_msec = millisecond;
 }
 
@@ -119,22 +141,22 @@ void nordic_itch_handler::process_msg(const itch_system_event* m)
 
 void nordic_itch_handler::process_msg(const itch_order_book_directory* m)
 {
-    auto order_book_id = itch_uatoi(m->OrderBook, sizeof(m->OrderBook));
-
-    std::string sym{m->Symbol, ITCH_SYMBOL_LEN};
-    std::size_t end = sym.find_first_of(" ");
-    if (end != std::string::npos) {
-        sym = sym.substr(0, end);
-    }
-    if (_symbols.count(sym) > 0) {
-        order_book ob{sym, timestamp(), _symbol_max_orders.at(sym)};
+    auto order_book_id = itch_decode(m->OrderBook);
+
+    // The symbol ends at its first space.
+    auto* end = std::find(m->Symbol, m->Symbol + ITCH_SYMBOL_LEN, ' ');
+    char sym[ITCH_SYMBOL_LEN];
+    std::fill(std::copy(m->Symbol, end, sym), sym + ITCH_SYMBOL_LEN, ' ');
+    auto* max_orders = _subscriptions.find(_subscriptions.key(sym));
+    if (max_orders) {
+        order_book ob{std::string{m->Symbol, end}, timestamp(), *max_orders};
         order_book_id_map.insert({order_book_id, std::move(ob)});
     }
 }
 
 void nordic_itch_handler::process_msg(const itch_order_book_trading_action* m)
 {
-    auto order_book_id = itch_uatoi(m->OrderBook, sizeof(m->OrderBook));
+    auto order_book_id = itch_decode(m->OrderBook);
     auto it = order_book_id_map.find(order_book_id);
     if (it != order_book_id_map.end()) {
         auto& ob = it->second;
@@ -151,14 +173,14 @@ void nordic_itch_handler::process_msg(const itch_order_book_trading_action* m)
 
 void nordic_itch_handler::process_msg(const itch_add_order* m)
 {
-    auto order_book_id = itch_uatoi(m->OrderBook, sizeof(m->OrderBook));
+    auto order_book_id = itch_decode(m->OrderBook);
     auto it = order_book_id_map.find(order_book_id);
     if (it != order_book_id_map.end()) {
         auto& ob = it->second;
 
-        uint64_t order_id = itch_uatoi(m->OrderReferenceNumber, sizeof(m->OrderReferenceNumber));
-        uint64_t price    = itch_uatoi(m->Price, sizeof(m->Price));;
-        uint32_t quantity = itch_uatoi(m->Quantity, sizeof(m->Quantity));;
+        uint64_t order_id, quantity;
+        itch_decode(m->OrderReferenceNumber, order_id, m->Quantity, quantity);
+        uint64_t price    = itch_decode(m->Price);
         auto     side     = itch_side(m->BuySellIndicator);
 
         order o{order_id, price, quantity, side, timestamp()};
@@ -172,14 +194,14 @@ void nordic_itch_handler::process_msg(const itch_add_order* m)
 
 void nordic_itch_handler::process_msg(const itch_add_order_mpid* m)
 {
-    auto order_book_id = itch_uatoi(m->OrderBook, sizeof(m->OrderBook));
+    auto order_book_id = itch_decode(m->OrderBook);
     auto it = order_book_id_map.find(order_book_id);
     if (it != order_book_id_map.end()) {
         auto& ob = it->second;
 
-        uint64_t order_id = itch_uatoi(m->OrderReferenceNumber, sizeof(m->OrderReferenceNumber));
-        uint64_t price    = itch_uatoi(m->Price, sizeof(m->Price));;
-        uint32_t quantity = itch_uatoi(m->Quantity, sizeof(m->Quantity));;
+        uint64_t order_id, quantity;
+        itch_decode(m->OrderReferenceNumber, order_id, m->Quantity, quantity);
+        uint64_t price    = itch_decode(m->Price);
         auto     side     = itch_side(m->BuySellIndicator);
 
         order o{order_id, price, quantity, side, timestamp()};
@@ -193,12 +215,15 @@ void nordic_itch_handler::process_msg(const itch_add_order_mpid* m)
 
 void nordic_itch_handler::process_msg(const itch_order_executed* m)
 {
-   uint64_t order_id = itch_uatoi(m->OrderReferenceNumber, sizeof(m->OrderReferenceNumber));
+   uint64_t order_id, quantity;
+   itch_decode(m->OrderReferenceNumber, order_id, m->ExecutedQuantity, quantity);
    auto it = order_id_map.find(order_id);
    if (it != order_id_map.end()) {
-       uint64_t quantity = itch_uatoi(m->ExecutedQuantity, sizeof(m->ExecutedQuantity));
        auto& ob = it->second;
        auto result = ob.execute(order_id, quantity);
+       if (result.filled) {
+           order_id_map.erase(it);
+       }
        ob.set_timestamp(timestamp());
        trade t{timestamp(), result.price, quantity, itch_trade_sign(result.side)};
         _process_event(make_event(ob.symbol(), timestamp(), &ob, &t, sweep_event(result)));
@@ -207,13 +232,16 @@ void nordic_itch_handler::process_msg(const itch_order_executed* m)
 
 void nordic_itch_handler::process_msg(const itch_order_executed_with_price* m)
 {
-    uint64_t order_id = itch_uatoi(m->OrderReferenceNumber, sizeof(m->OrderReferenceNumber));
+    uint64_t order_id, quantity;
+    itch_decode(m->OrderReferenceNumber, order_id, m->ExecutedQuantity, quantity);
     auto it = order_id_map.find(order_id);
     if (it != order_id_map.end()) {
-        uint64_t quantity = itch_uatoi(m->ExecutedQuantity, sizeof(m->ExecutedQuantity));
-        uint64_t price = itch_uatoi(m->TradePrice, sizeof(m->TradePrice));
+        uint64_t price = itch_decode(m->TradePrice);
         auto& ob = it->second;
         auto result = ob.execute(order_id, quantity);
+        if (result.filled) {
+            order_id_map.erase(it);
+        }
         ob.set_timestamp(timestamp());
         trade t{timestamp(), price, quantity, itch_trade_sign(result.side)};
         _process_event(make_event(ob.symbol(), timestamp(), &ob, &t, sweep_event(result)));
@@ -222,12 +250,14 @@ void nordic_itch_handler::process_msg(const itch_order_executed_with_price* m)
 
 void nordic_itch_handler::process_msg(const itch_order_cancel* m)
 {
-    uint64_t order_id = itch_uatoi(m->OrderReferenceNumber, sizeof(m->OrderReferenceNumber));
+    uint64_t order_id, quantity;
+    itch_decode(m->OrderReferenceNumber, order_id, m->CanceledQuantity, quantity);
     auto it = order_id_map.find(order_id);
     if (it != order_id_map.end()) {
-        uint64_t quantity = itch_uatoi(m->CanceledQuantity, sizeof(m->CanceledQuantity));
         auto& ob = it->second;
-        ob.cancel(order_id, quantity);
+        if (ob.cancel(order_id, quantity)) {
+            order_id_map.erase(it);
+        }
         ob.set_timestamp(timestamp());
         _process_event(make_ob_event(ob.symbol(), timestamp(), &ob));
     }
@@ -235,11 +265,12 @@ void nordic_itch_handler::process_msg(const itch_order_cancel* m)
 
 void nordic_itch_handler::process_msg(const itch_order_delete* m)
 {
-    uint64_t order_id = itch_uatoi(m->OrderReferenceNumber, sizeof(m->OrderReferenceNumber));
+    uint64_t order_id = itch_decode(m->OrderReferenceNumber);
     auto it = order_id_map.find(order_id);
     if (it != order_id_map.end()) {
         auto& ob = it->second;
         ob.remove(order_id);
+        order_id_map.erase(it);
         ob.set_timestamp(timestamp());
         _process_event(make_ob_event(ob.symbol(), timestamp(), &ob));
     }
@@ -247,11 +278,11 @@ void nordic_itch_handler::process_msg(const itch_order_delete* m)
 
 void nordic_itch_handler::process_msg(const itch_trade* m)
 {
-    auto order_book_id = itch_uatoi(m->OrderBook, sizeof(m->OrderBook));
+    auto order_book_id = itch_decode(m->OrderBook);
     auto it = order_book_id_map.find(order_book_id);
     if (it != order_book_id_map.end()) {
-        uint64_t trade_price = itch_uatoi(m->TradePrice, sizeof(m->TradePrice));
-        uint64_t quantity = itch_uatoi(m->Quantity, sizeof(m->Quantity));
+        uint64_t trade_price, quantity;
+        itch_decode(m->TradePrice, trade_price, m->Quantity, quantity);
         auto& ob = it->second;
         trade t{timestamp(), trade_price, quantity, trade_sign::non_displayable};
         _process_event(make_trade_event(ob.symbol(), timestamp(), &t));
@@ -260,11 +291,11 @@ void nordic_itch_handler::process_msg(const itch_trade* m)
 
 void nordic_itch_handler::process_msg(const itch_cross_trade* m)
 {
-    auto order_book_id = itch_uatoi(m->OrderBook, sizeof(m->OrderBook));
+    auto order_book_id = itch_decode(m->OrderBook);
     auto it = order_book_id_map.find(order_book_id);
     if (it != order_book_id_map.end()) {
-        uint64_t cross_price = itch_uatoi(m->CrossPrice, sizeof(m->CrossPrice));
-        uint64_t quantity = itch_uatoi(m->Quantity, sizeof(m->Quantity));
+        uint64_t cross_price, quantity;
+        itch_decode(m->CrossPrice, cross_price, m->Quantity, quantity);
         auto& ob = it->second;
         trade t{timestamp(), cross_price, quantity, trade_sign::crossing};
         _process_event(make_trade_event(ob.symbol(), timestamp(), &t));
@@ -279,6 +310,44 @@ void nordic_itch_handler::process_msg(const itch_noii* m)
 {
 }
 
+void nordic_itch_handler::save(checkpoint_writer& writer) const
+{
+    writer.write_tag("nordic-itch");
+    writer.write_u64(time_sec);
+    writer.write_u64(time_msec);
+    writer.write_u64(order_book_id_map.size());
+    for (auto&& kv : order_book_id_map) {
+        writer.write_u64(kv.first);
+        kv.second.save(writer);
+    }
+}
+
+void nordic_itch_handler::load(checkpoint_reader& reader)
+{
+    reader.read_tag("nordic-itch");
+    time_sec = reader.read_u64();
+    time_msec = reader.read_u64();
+    order_id_map.clear();
+    order_book_id_map.clear();
+    auto count = reader.read_u64();
+    for (uint64_t i = 0; i < count; i++) {
+        auto order_book_id = reader.read_u64();
+        auto ob = order_book::load(reader, [this](const std::string& symbol) {
+            auto* max_orders = _subscriptions.find(symbol);
+            return max_orders ? *max_orders : 0;
+        });
+        if (_subscriptions.find(ob.symbol())) {
+            order_book_id_map.insert({order_book_id, std::move(ob)});
+        }
+    }
+    for (auto&& kv : order_book_id_map) {
+        auto& ob = kv.second;
+        ob.for_each_order([this, &ob](const order& o) {
+            order_id_map.insert({o.id, ob});
+        });
+    }
+}
+
 uint64_t nordic_itch_handler::timestamp() const
 {
     return time_sec * 1000 + time_msec;
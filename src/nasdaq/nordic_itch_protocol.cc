@@ -2,6 +2,7 @@
 
 #include "helix/nasdaq/nordic_itch_handler.hh"
 #include "helix/nasdaq/soupfile.hh"
+#include "helix/nasdaq/line_arbitration.hh"
 #include "helix/nasdaq/moldudp.hh"
 
 namespace helix {
@@ -30,6 +31,15 @@ session* nordic_itch_protocol::new_session(void *data)
     }
 }
 
+session* nordic_itch_protocol::new_arbitrated_session(void *data)
+{
+    if (_name == "nasdaq-nordic-moldudp-itch") {
+        return new arbitrated_session<moldudp_session<nordic_itch_handler>>(data);
+    } else {
+        throw std::invalid_argument("protocol does not support line arbitration: " + _name);
+    }
+}
+
 }
 
 }
@@ -1,15 +1,18 @@
 #include "helix/order_book.hh"
 
+#include "helix/checkpoint.hh"
+
 #include <boost/version.hpp>
 #include <stdexcept>
 #include <limits>
 
 namespace helix {
 
-execution::execution(uint64_t price, side_type side, uint64_t remaining)
+execution::execution(uint64_t price, side_type side, uint64_t remaining, bool filled)
     : price{price}
     , side{side}
     , remaining{remaining}
+    , filled{filled}
 {
 }
 
@@ -50,7 +53,7 @@ void order_book::replace(uint64_t order_id, order order)
     add(std::move(order));
 }
 
-void order_book::cancel(uint64_t order_id, uint64_t quantity)
+bool order_book::cancel(uint64_t order_id, uint64_t quantity)
 {
     auto it = _orders.find(order_id);
     if (it == _orders.end()) {
@@ -62,7 +65,9 @@ void order_book::cancel(uint64_t order_id, uint64_t quantity)
     });
     if (!it->quantity) {
         remove(it);
+        return true;
     }
+    return false;
 }
 
 execution order_book::execute(uint64_t order_id, uint64_t quantity)
@@ -75,8 +80,8 @@ execution order_book::execute(uint64_t order_id, uint64_t quantity)
         order.quantity -= quantity;
         order.level->size -= quantity;
     });
-    auto result = execution(it->price, it->side, it->level->size);
-    if (!it->quantity) {
+    auto result = execution(it->price, it->side, it->level->size, !it->quantity);
+    if (result.filled) {
         remove(it);
     }
     return result;
@@ -216,4 +221,68 @@ uint64_t order_book::midprice(size_t level) const
     return (bid + ask) / 2;
 }
 
+template<typename T>
+static void save_levels(checkpoint_writer& writer, const T& levels)
+{
+    writer.write_u64(levels.size());
+    for (auto&& kv : levels) {
+        writer.write_u64(kv.second.price);
+        writer.write_u64(kv.second.size);
+    }
+}
+
+template<typename T>
+static void check_levels(checkpoint_reader& reader, const T& levels)
+{
+    auto count = reader.read_u64();
+    if (count != levels.size()) {
+        throw checkpoint_error("price level count mismatch: " + std::to_string(count) + ", expected: " + std::to_string(levels.size()));
+    }
+    for (auto&& kv : levels) {
+        auto price = reader.read_u64();
+        auto size = reader.read_u64();
+        if (price != kv.second.price || size != kv.second.size) {
+            throw checkpoint_error("price level mismatch at price: " + std::to_string(price));
+        }
+    }
+}
+
+void order_book::save(checkpoint_writer& writer) const
+{
+    writer.write_string(_symbol);
+    writer.write_u64(_timestamp);
+    writer.write_u8(static_cast<uint8_t>(_state));
+    writer.write_u64(_orders.size());
+    for (auto&& o : _orders) {
+        writer.write_u64(o.id);
+        writer.write_u64(o.price);
+        writer.write_u64(o.quantity);
+        writer.write_u8(static_cast<uint8_t>(o.side));
+        writer.write_u64(o.timestamp);
+    }
+    save_levels(writer, _bids);
+    save_levels(writer, _asks);
+}
+
+order_book order_book::load(checkpoint_reader& reader, const std::function<size_t(const std::string&)>& max_orders)
+{
+    auto symbol = reader.read_string();
+    auto timestamp = reader.read_u64();
+    auto n = max_orders(symbol);
+    order_book ob{std::move(symbol), timestamp, n};
+    ob.set_state(static_cast<trading_state>(reader.read_u8()));
+    auto count = reader.read_u64();
+    for (uint64_t i = 0; i < count; i++) {
+        auto id = reader.read_u64();
+        auto price = reader.read_u64();
+        auto quantity = reader.read_u64();
+        auto side = static_cast<side_type>(reader.read_u8());
+        auto order_timestamp = reader.read_u64();
+        ob.add(order{id, price, quantity, side, order_timestamp});
+    }
+    check_levels(reader, ob._bids);
+    check_levels(reader, ob._asks);
+    return ob;
+}
+
 }
@@ -0,0 +1,154 @@
+#include "helix/pacer.hh"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HELIX_HAVE_TSC 1
+#endif
+
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <time.h>
+
+namespace helix {
+
+//! Time that the time-stamp counter is calibrated over.
+static constexpr std::chrono::milliseconds tsc_calibration_time{20};
+
+static inline void cpu_relax()
+{
+#ifdef HELIX_HAVE_TSC
+    _mm_pause();
+#endif
+}
+
+static inline uint64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static size_t bucket_of(uint64_t ns)
+{
+    if (ns < 16) {
+        return ns;
+    }
+    unsigned exp = 63 - __builtin_clzll(ns);
+    return 16 + (exp - 4) * 8 + ((ns >> (exp - 3)) & 7);
+}
+
+//! Returns the largest value in bucket @idx.
+static uint64_t bucket_max(size_t idx)
+{
+    if (idx < 16) {
+        return idx;
+    }
+    unsigned exp = (idx - 16) / 8 + 4;
+    uint64_t sub = (idx - 16) % 8;
+    uint64_t width = uint64_t(1) << (exp - 3);
+    return (8 + sub) * width + width - 1;
+}
+
+void pacer::configure(const pacing_config& config)
+{
+    if (config.speed < 0 || !std::isfinite(config.speed)) {
+        throw std::invalid_argument("invalid replay speed");
+    }
+    _config = config;
+    _started = false;
+    _stats = pacing_stats{};
+    _histogram.fill(0);
+    switch (config.clock) {
+    case pacing_clock::monotonic:
+        _ticks_per_ns = 1.0;
+        break;
+    case pacing_clock::tsc: {
+#ifdef HELIX_HAVE_TSC
+        using clock_type = std::chrono::steady_clock;
+        auto t0 = clock_type::now();
+        uint64_t c0 = __rdtsc();
+        clock_type::time_point t1;
+        do {
+            t1 = clock_type::now();
+        } while (t1 - t0 < tsc_calibration_time);
+        uint64_t c1 = __rdtsc();
+        _ticks_per_ns = double(c1 - c0) / std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        break;
+#else
+        throw std::invalid_argument("TSC is not supported");
+#endif
+    }
+    }
+}
+
+pacing_stats pacer::stats() const
+{
+    pacing_stats stats = _stats;
+    auto percentile = [this](double q) -> uint64_t {
+        uint64_t rank = std::ceil(q * _stats.releases);
+        uint64_t count = 0;
+        for (size_t i = 0; i < _histogram.size(); i++) {
+            count += _histogram[i];
+            if (count >= rank && count > 0) {
+                return std::min(bucket_max(i), _stats.max_ns);
+            }
+        }
+        return _stats.max_ns;
+    };
+    stats.p50_ns = percentile(0.5);
+    stats.p90_ns = percentile(0.9);
+    stats.p99_ns = percentile(0.99);
+    stats.p999_ns = percentile(0.999);
+    return stats;
+}
+
+void pacer::wait(uint64_t timestamp)
+{
+    if (!_started) {
+        _started = true;
+        _first_timestamp = timestamp;
+        _start = now();
+        record(0);
+        return;
+    }
+    // Timestamps that go back in time, for example at a new trading day,
+    // are due immediately.
+    double offset_ns = timestamp > _first_timestamp ? (timestamp - _first_timestamp) / _config.speed : 0;
+    uint64_t deadline = _start + uint64_t(offset_ns * _ticks_per_ns);
+    uint64_t t = now();
+    if (t > deadline) {
+        _stats.late++;
+        record((t - deadline) / _ticks_per_ns);
+        return;
+    }
+    uint64_t remaining_ns = (deadline - t) / _ticks_per_ns;
+    if (remaining_ns > pacer_spin_threshold_ns) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds{remaining_ns - pacer_spin_threshold_ns});
+    }
+    while ((t = now()) < deadline) {
+        cpu_relax();
+    }
+    record((t - deadline) / _ticks_per_ns);
+}
+
+void pacer::record(uint64_t error_ns)
+{
+    _stats.releases++;
+    _stats.max_ns = std::max(_stats.max_ns, error_ns);
+    _histogram[bucket_of(error_ns)]++;
+}
+
+uint64_t pacer::now() const
+{
+#ifdef HELIX_HAVE_TSC
+    if (_config.clock == pacing_clock::tsc) {
+        return __rdtsc();
+    }
+#endif
+    return monotonic_ns();
+}
+
+}
@@ -4,6 +4,7 @@
 #include "helix/order_book.hh"
 
 #include <stdexcept>
+#include <cstring>
 
 namespace helix {
 
@@ -27,6 +28,20 @@ trade_sign pmd_trade_sign(side_type s)
     }
 }
 
+static_assert(PMD_INSTRUMENT_LEN == sizeof(uint64_t), "instrument does not fit an integer");
+
+static uint64_t pmd_instrument(const char* instrument)
+{
+    uint64_t key;
+    std::memcpy(&key, instrument, sizeof(key));
+    return key;
+}
+
+static std::string pmd_instrument_name(uint64_t key)
+{
+    return std::string{reinterpret_cast<const char*>(&key), sizeof(key)};
+}
+
 pmd_handler::pmd_handler()
 {
 }
@@ -38,14 +53,14 @@ bool pmd_handler::is_rth_timestamp(uint64_t timestamp) const
 
 void pmd_handler::subscribe(std::string sym, size_t max_orders)
 {
+    if (sym.size() > PMD_INSTRUMENT_LEN) {
+        throw std::invalid_argument("instrument is too long: " + sym);
+    }
     helix::order_book ob{sym, 0, max_orders};
     ob.set_state(trading_state::trading);
-    auto padding = PMD_INSTRUMENT_LEN - sym.size();
-    if (padding > 0) {
-        sym.insert(sym.size(), padding, ' ');
-    }
-    _symbols.insert(sym);
-    _order_book_id_map.emplace(sym, std::move(ob));
+    sym.append(PMD_INSTRUMENT_LEN - sym.size(), ' ');
+    _symbols[sym] = max_orders;
+    _order_book_id_map.emplace(pmd_instrument(sym.data()), std::move(ob));
 }
 
 void pmd_handler::register_callback(event_callback callback)
@@ -53,6 +68,11 @@ void pmd_handler::register_callback(event_callback callback)
     _process_event = callback;
 }
 
+void pmd_handler::set_pacer(pacer* p)
+{
+    _pacer = p;
+}
+
 size_t pmd_handler::process_packet(const net::packet_view& packet, bool sync)
 {
     auto* msg = packet.cast<pmd_message>();
@@ -71,10 +91,32 @@ size_t pmd_handler::process_packet(const net::packet_view& packet, bool sync)
 template<typename T>
 size_t pmd_handler::process_msg(const net::packet_view& packet, bool sync)
 {
-    process_msg(packet.cast<T>(), sync);
+    if (packet.len() < sizeof(T)) {
+        throw truncated_packet_error("PMD message is truncated");
+    }
+    auto* m = packet.cast<T>();
+    pace(m);
+    process_msg(m, sync);
     return sizeof(T);
 }
 
+template<typename T>
+void pmd_handler::pace(const T* m)
+{
+    if (_pacer) {
+        _pacer->pace(uint64_t(_seconds) * 1000000000 + be32toh(m->Timestamp));
+    }
+}
+
+// Version and Seconds messages have no timestamp.
+void pmd_handler::pace(const pmd_version* m)
+{
+}
+
+void pmd_handler::pace(const pmd_second* m)
+{
+}
+
 void pmd_handler::process_msg(const pmd_version* m, bool sync)
 {
 }
@@ -86,8 +128,7 @@ void pmd_handler::process_msg(const pmd_second* m, bool sync)
 
 void pmd_handler::process_msg(const pmd_order_added* m, bool sync)
 {
-    std::string symbol{m->Instrument, PMD_INSTRUMENT_LEN};
-    auto it = _order_book_id_map.find(symbol);
+    auto it = _order_book_id_map.find(pmd_instrument(m->Instrument));
     if (it != _order_book_id_map.end()) {
         auto& ob = it->second;
         uint64_t order_id  = be64toh(m->OrderNumber);
@@ -114,6 +155,9 @@ void pmd_handler::process_msg(const pmd_order_executed* m, bool sync)
         uint32_t quantity  = be32toh(m->Quantity);
         uint64_t timestamp = to_timestamp(be32toh(m->Timestamp));
         auto result = ob.execute(order_id, quantity);
+        if (result.filled) {
+            _order_id_map.erase(it);
+        }
         ob.set_timestamp(timestamp);
         trade t{timestamp, result.price, quantity, pmd_trade_sign(result.side)};
         if (sync) {
@@ -130,7 +174,9 @@ void pmd_handler::process_msg(const pmd_order_canceled* m, bool sync)
         auto& ob = it->second;
         uint32_t quantity  = be32toh(m->CanceledQuantity);
         uint64_t timestamp = to_timestamp(be32toh(m->Timestamp));
-        ob.cancel(order_id, quantity);
+        if (ob.cancel(order_id, quantity)) {
+            _order_id_map.erase(it);
+        }
         ob.set_timestamp(timestamp);
         if (sync) {
             _process_event(make_ob_event(ob.symbol(), timestamp, &ob));
@@ -146,6 +192,7 @@ void pmd_handler::process_msg(const pmd_order_deleted* m, bool sync)
         auto& ob = it->second;
         uint64_t timestamp = to_timestamp(be32toh(m->Timestamp));
         ob.remove(order_id);
+        _order_id_map.erase(it);
         ob.set_timestamp(timestamp);
         if (sync) {
             _process_event(make_ob_event(ob.symbol(), timestamp, &ob));
@@ -157,6 +204,43 @@ void pmd_handler::process_msg(const pmd_broken_trade* m, bool sync)
 {
 }
 
+void pmd_handler::save(checkpoint_writer& writer) const
+{
+    writer.write_tag("parity-pmd");
+    writer.write_u32(_seconds);
+    writer.write_u64(_order_book_id_map.size());
+    for (auto&& kv : _order_book_id_map) {
+        writer.write_string(pmd_instrument_name(kv.first));
+        kv.second.save(writer);
+    }
+}
+
+void pmd_handler::load(checkpoint_reader& reader)
+{
+    reader.read_tag("parity-pmd");
+    _seconds = reader.read_u32();
+    _order_id_map.clear();
+    auto count = reader.read_u64();
+    for (uint64_t i = 0; i < count; i++) {
+        auto instrument = reader.read_string();
+        auto it = _symbols.find(instrument);
+        auto ob = order_book::load(reader, [this, &it](const std::string&) {
+            return it != _symbols.end() ? it->second : 0;
+        });
+        if (it != _symbols.end()) {
+            auto key = pmd_instrument(instrument.data());
+            _order_book_id_map.erase(key);
+            _order_book_id_map.emplace(key, std::move(ob));
+        }
+    }
+    for (auto&& kv : _order_book_id_map) {
+        auto& ob = kv.second;
+        ob.for_each_order([this, &ob](const order& o) {
+            _order_id_map.insert({o.id, ob});
+        });
+    }
+}
+
 event_mask pmd_handler::sweep_event(const execution& e) const
 {
     if (e.remaining > 0) {
@@ -1,6 +1,7 @@
 #include "helix/parity/pmd_protocol.hh"
 
 #include "helix/parity/pmd_handler.hh"
+#include "helix/nasdaq/line_arbitration.hh"
 #include "helix/nasdaq/moldudp64.hh"
 
 namespace helix {
@@ -22,6 +23,11 @@ session* pmd_protocol::new_session(void *data)
     return new nasdaq::moldudp64_session<pmd_handler>(data);
 }
 
+session* pmd_protocol::new_arbitrated_session(void *data)
+{
+    return new nasdaq::arbitrated_session<nasdaq::moldudp64_session<pmd_handler>>(data);
+}
+
 }
 
 }
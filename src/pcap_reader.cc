@@ -0,0 +1,444 @@
+#include "helix/pcap_reader.hh"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <system_error>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+
+namespace helix {
+
+static constexpr uint32_t pcap_magic_usec = 0xa1b2c3d4;
+static constexpr uint32_t pcap_magic_nsec = 0xa1b23c4d;
+static constexpr size_t pcap_file_header_size = 24;
+static constexpr size_t pcap_record_header_size = 16;
+
+static constexpr uint32_t pcapng_section_header_block = 0x0a0d0d0a;
+static constexpr uint32_t pcapng_interface_description_block = 0x00000001;
+static constexpr uint32_t pcapng_packet_block = 0x00000002;
+static constexpr uint32_t pcapng_simple_packet_block = 0x00000003;
+static constexpr uint32_t pcapng_enhanced_packet_block = 0x00000006;
+static constexpr uint32_t pcapng_byte_order_magic = 0x1a2b3c4d;
+
+static constexpr uint16_t pcapng_opt_endofopt = 0;
+static constexpr uint16_t pcapng_opt_if_tsresol = 9;
+static constexpr uint16_t pcapng_opt_if_tsoffset = 14;
+
+static constexpr uint16_t linktype_ethernet = 1;
+static constexpr uint16_t linktype_raw = 101;
+static constexpr uint16_t linktype_linux_sll = 113;
+static constexpr uint16_t linktype_ipv4 = 228;
+static constexpr uint16_t linktype_linux_sll2 = 276;
+
+static constexpr uint16_t ethertype_ipv4 = 0x0800;
+static constexpr uint16_t ethertype_vlan = 0x8100;
+static constexpr uint16_t ethertype_qinq = 0x88a8;
+
+static constexpr uint8_t ip_proto_udp = 17;
+
+static constexpr uint64_t nsec_per_sec = 1000000000;
+
+static inline uint16_t swap16(uint16_t v)
+{
+    return (v >> 8) | (v << 8);
+}
+
+static inline uint32_t swap32(uint32_t v)
+{
+    return (uint32_t(swap16(v)) << 16) | swap16(v >> 16);
+}
+
+static inline uint64_t swap64(uint64_t v)
+{
+    return (uint64_t(swap32(v)) << 32) | swap32(v >> 32);
+}
+
+//! Read a big-endian (network byte order) 16-bit value.
+static inline uint16_t be16(const char* p)
+{
+    auto* b = reinterpret_cast<const uint8_t*>(p);
+    return (uint16_t(b[0]) << 8) | b[1];
+}
+
+//! Convert a timestamp in units of 1/@resolution seconds to nanoseconds.
+static inline uint64_t to_nsec(uint64_t ts, uint64_t resolution)
+{
+    if (resolution == nsec_per_sec) {
+        return ts;
+    }
+    uint64_t frac = ts % resolution;
+    return (ts / resolution) * nsec_per_sec + uint64_t((unsigned __int128)frac * nsec_per_sec / resolution);
+}
+
+pcap_reader::pcap_reader(const std::string& filename, const pcap_filter& filter)
+    : _filter{filter}
+{
+    _fd = ::open(filename.c_str(), O_RDONLY);
+    if (_fd < 0) {
+        throw std::system_error(errno, std::generic_category(), filename);
+    }
+    struct stat st;
+    if (fstat(_fd, &st) < 0) {
+        int err = errno;
+        ::close(_fd);
+        throw std::system_error(err, std::generic_category(), filename);
+    }
+    _len = st.st_size;
+    if (_len < pcap_file_header_size) {
+        ::close(_fd);
+        throw pcap_error(filename + ": not a capture file");
+    }
+    void* p = mmap(nullptr, _len, PROT_READ, MAP_SHARED, _fd, 0);
+    if (p == MAP_FAILED) {
+        int err = errno;
+        ::close(_fd);
+        throw std::system_error(err, std::generic_category(), filename);
+    }
+    _buf = static_cast<const char*>(p);
+    madvise(const_cast<char*>(_buf), _len, MADV_SEQUENTIAL);
+
+    uint32_t magic;
+    std::memcpy(&magic, _buf, sizeof(magic));
+    try {
+        if (magic == pcapng_section_header_block) {
+            _pcapng = true;
+        } else if (magic == pcap_magic_usec || magic == pcap_magic_nsec || swap32(magic) == pcap_magic_usec || swap32(magic) == pcap_magic_nsec) {
+            _pcapng = false;
+            _swap = magic != pcap_magic_usec && magic != pcap_magic_nsec;
+            bool nsec = magic == pcap_magic_nsec || swap32(magic) == pcap_magic_nsec;
+            _interfaces.push_back(interface{uint16_t(u32(_buf + 20)), nsec ? nsec_per_sec : 1000000, 0});
+            _pos = pcap_file_header_size;
+        } else {
+            throw pcap_error(filename + ": not a capture file");
+        }
+    } catch (...) {
+        munmap(const_cast<char*>(_buf), _len);
+        ::close(_fd);
+        throw;
+    }
+}
+
+pcap_reader::~pcap_reader()
+{
+    munmap(const_cast<char*>(_buf), _len);
+    ::close(_fd);
+}
+
+bool pcap_reader::next(pcap_datagram& datagram)
+{
+    const interface* iface;
+    uint64_t timestamp;
+    net::packet_view frame;
+    size_t orig_len;
+    while (next_frame(iface, timestamp, frame, orig_len)) {
+        _stats.frames++;
+        if (frame.len() < orig_len) {
+            _stats.truncated++;
+        }
+        net::packet_view payload;
+        if (decode(iface->link_type, frame, payload)) {
+            _stats.datagrams++;
+            datagram.timestamp = timestamp;
+            datagram.payload = payload;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool pcap_reader::next_frame(const interface*& iface, uint64_t& timestamp, net::packet_view& frame, size_t& orig_len)
+{
+    if (_pcapng) {
+        return next_pcapng_frame(iface, timestamp, frame, orig_len);
+    }
+    return next_pcap_frame(iface, timestamp, frame, orig_len);
+}
+
+bool pcap_reader::next_pcap_frame(const interface*& iface, uint64_t& timestamp, net::packet_view& frame, size_t& orig_len)
+{
+    if (_pos == _len) {
+        return false;
+    }
+    if (_len - _pos < pcap_record_header_size) {
+        throw pcap_error("capture record header is truncated");
+    }
+    const char* p = _buf + _pos;
+    uint64_t ts_sec = u32(p);
+    uint64_t ts_frac = u32(p + 4);
+    uint32_t incl_len = u32(p + 8);
+    orig_len = u32(p + 12);
+    if (_len - _pos - pcap_record_header_size < incl_len) {
+        throw pcap_error("captured frame is truncated");
+    }
+    iface = &_interfaces[0];
+    timestamp = ts_sec * nsec_per_sec + ts_frac * (nsec_per_sec / iface->resolution);
+    frame = net::packet_view{p + pcap_record_header_size, incl_len};
+    _pos += pcap_record_header_size + incl_len;
+    return true;
+}
+
+bool pcap_reader::next_pcapng_frame(const interface*& iface, uint64_t& timestamp, net::packet_view& frame, size_t& orig_len)
+{
+    while (_pos < _len) {
+        if (_len - _pos < 12) {
+            throw pcap_error("pcapng block is truncated");
+        }
+        const char* p = _buf + _pos;
+        uint32_t type;
+        std::memcpy(&type, p, sizeof(type));
+        if (type == pcapng_section_header_block) {
+            // The byte order of a section is given by its header, so the
+            // block length can only be read after the byte order is known.
+            uint32_t bom;
+            std::memcpy(&bom, p + 8, sizeof(bom));
+            if (bom == pcapng_byte_order_magic) {
+                _swap = false;
+            } else if (swap32(bom) == pcapng_byte_order_magic) {
+                _swap = true;
+            } else {
+                throw pcap_error("invalid pcapng byte order magic");
+            }
+        } else {
+            type = u32(p);
+        }
+        uint32_t block_len = u32(p + 4);
+        if (block_len < 12 || block_len % 4 || block_len > _len - _pos) {
+            throw pcap_error("invalid pcapng block length: " + std::to_string(block_len));
+        }
+        const char* body = p + 8;
+        size_t body_len = block_len - 12;
+        _pos += block_len;
+        switch (type) {
+        case pcapng_section_header_block:
+            parse_section_header(body, body_len);
+            break;
+        case pcapng_interface_description_block:
+            parse_interface_description(body, body_len);
+            break;
+        case pcapng_enhanced_packet_block:
+        case pcapng_packet_block: {
+            if (body_len < 20) {
+                throw pcap_error("pcapng packet block is truncated");
+            }
+            uint32_t if_id = type == pcapng_enhanced_packet_block ? u32(body) : u16(body);
+            if (if_id >= _interfaces.size()) {
+                throw pcap_error("pcapng packet refers to unknown interface " + std::to_string(if_id));
+            }
+            iface = &_interfaces[if_id];
+            uint64_t ts = (uint64_t(u32(body + 4)) << 32) | u32(body + 8);
+            uint32_t cap_len = u32(body + 12);
+            orig_len = u32(body + 16);
+            if (cap_len > body_len - 20) {
+                throw pcap_error("pcapng packet data is truncated");
+            }
+            timestamp = to_nsec(ts, iface->resolution) + iface->offset * int64_t(nsec_per_sec);
+            _last_timestamp = timestamp;
+            frame = net::packet_view{body + 20, cap_len};
+            return true;
+        }
+        case pcapng_simple_packet_block: {
+            if (body_len < 4 || _interfaces.empty()) {
+                throw pcap_error("invalid pcapng simple packet block");
+            }
+            // Simple packets have no timestamp, so they inherit the time of
+            // the previous packet.
+            iface = &_interfaces[0];
+            timestamp = _last_timestamp;
+            orig_len = u32(body);
+            frame = net::packet_view{body + 4, std::min<size_t>(orig_len, body_len - 4)};
+            return true;
+        }
+        default:
+            // Statistics, name resolution and custom blocks carry no packets.
+            break;
+        }
+    }
+    return false;
+}
+
+void pcap_reader::parse_section_header(const char* body, size_t len)
+{
+    if (len < 16) {
+        throw pcap_error("pcapng section header is truncated");
+    }
+    uint16_t major = u16(body + 4);
+    if (major != 1) {
+        throw pcap_error("unsupported pcapng version: " + std::to_string(major));
+    }
+    // Interface IDs are local to a section.
+    _interfaces.clear();
+}
+
+void pcap_reader::parse_interface_description(const char* body, size_t len)
+{
+    if (len < 8) {
+        throw pcap_error("pcapng interface description is truncated");
+    }
+    interface iface{u16(body), 1000000, 0};
+    const char* opt = body + 8;
+    const char* end = body + len;
+    while (end - opt >= 4) {
+        uint16_t code = u16(opt);
+        uint16_t opt_len = u16(opt + 2);
+        const char* value = opt + 4;
+        if (code == pcapng_opt_endofopt || end - value < opt_len) {
+            break;
+        }
+        if (code == pcapng_opt_if_tsresol && opt_len >= 1) {
+            uint8_t tsresol = *value;
+            unsigned exp = tsresol & 0x7f;
+            if (tsresol & 0x80) {
+                if (exp > 63) {
+                    throw pcap_error("unsupported pcapng timestamp resolution");
+                }
+                iface.resolution = uint64_t(1) << exp;
+            } else {
+                if (exp > 19) {
+                    throw pcap_error("unsupported pcapng timestamp resolution");
+                }
+                iface.resolution = 1;
+                for (unsigned i = 0; i < exp; i++) {
+                    iface.resolution *= 10;
+                }
+            }
+        } else if (code == pcapng_opt_if_tsoffset && opt_len >= 8) {
+            iface.offset = int64_t(u64(value));
+        }
+        opt = value + ((opt_len + 3) & ~3);
+    }
+    _interfaces.push_back(iface);
+}
+
+bool pcap_reader::decode(uint16_t link_type, const net::packet_view& frame, net::packet_view& payload)
+{
+    const char* p = frame.buf();
+    const char* end = frame.end();
+    uint16_t ethertype;
+    switch (link_type) {
+    case linktype_ethernet:
+        if (end - p < 14) {
+            return false;
+        }
+        ethertype = be16(p + 12);
+        p += 14;
+        while (ethertype == ethertype_vlan || ethertype == ethertype_qinq) {
+            if (end - p < 4) {
+                return false;
+            }
+            ethertype = be16(p + 2);
+            p += 4;
+        }
+        break;
+    case linktype_linux_sll:
+        if (end - p < 16) {
+            return false;
+        }
+        ethertype = be16(p + 14);
+        p += 16;
+        break;
+    case linktype_linux_sll2:
+        if (end - p < 20) {
+            return false;
+        }
+        ethertype = be16(p);
+        p += 20;
+        break;
+    case linktype_raw:
+    case linktype_ipv4:
+        ethertype = ethertype_ipv4;
+        break;
+    default:
+        throw pcap_error("unsupported link type: " + std::to_string(link_type));
+    }
+    if (ethertype != ethertype_ipv4 || end - p < 20) {
+        return false;
+    }
+    auto* ip = reinterpret_cast<const uint8_t*>(p);
+    size_t ihl = (ip[0] & 0x0f) * 4;
+    size_t total_len = be16(p + 2);
+    if ((ip[0] >> 4) != 4 || ihl < 20 || total_len < ihl) {
+        return false;
+    }
+    // Ethernet pads short frames, so the IP length bounds the datagram.
+    if (size_t(end - p) < total_len) {
+        return false;
+    }
+    end = p + total_len;
+    if (ip[9] != ip_proto_udp) {
+        return false;
+    }
+    if (be16(p + 6) & 0x3fff) {
+        _stats.fragments++;
+        return false;
+    }
+    uint32_t dst_addr;
+    std::memcpy(&dst_addr, p + 16, sizeof(dst_addr));
+    if (_filter.addr && dst_addr != _filter.addr) {
+        return false;
+    }
+    p += ihl;
+    if (end - p < 8) {
+        return false;
+    }
+    uint16_t dst_port = be16(p + 2);
+    size_t udp_len = be16(p + 4);
+    if (_filter.port && dst_port != _filter.port) {
+        return false;
+    }
+    if (udp_len < 8 || size_t(end - p) < udp_len) {
+        return false;
+    }
+    payload = net::packet_view{p + 8, udp_len - 8};
+    return true;
+}
+
+uint16_t pcap_reader::u16(const char* p) const
+{
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return _swap ? swap16(v) : v;
+}
+
+uint32_t pcap_reader::u32(const char* p) const
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return _swap ? swap32(v) : v;
+}
+
+uint64_t pcap_reader::u64(const char* p) const
+{
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return _swap ? swap64(v) : v;
+}
+
+uint64_t replay(session& s, pcap_reader& reader, bool honor_timestamps)
+{
+    using clock_type = std::chrono::steady_clock;
+    uint64_t count = 0;
+    uint64_t first_timestamp = 0;
+    clock_type::time_point start;
+    pcap_datagram datagram;
+    while (reader.next(datagram)) {
+        if (honor_timestamps) {
+            if (!count) {
+                first_timestamp = datagram.timestamp;
+                start = clock_type::now();
+            } else if (datagram.timestamp > first_timestamp) {
+                std::this_thread::sleep_until(start + std::chrono::nanoseconds{datagram.timestamp - first_timestamp});
+            }
+        }
+        s.process_packet(datagram.payload);
+        count++;
+    }
+    return count;
+}
+
+}
@@ -0,0 +1,94 @@
+#include "helix/replay_index.hh"
+
+#include <algorithm>
+#include <sstream>
+
+namespace helix {
+
+// A replay index is a checkpoint stream of its own: a tag, followed by
+// entries that are each prefixed with a non-zero marker and terminated by a
+// zero marker. The checkpoint of an entry is embedded after its size, so
+// that the reader can skip over it.
+
+static const std::string replay_index_tag = "replay-index";
+
+replay_index_writer::replay_index_writer(const std::string& filename)
+    : _out{filename, std::ios::binary | std::ios::trunc}
+    , _writer{_out}
+{
+    _writer.write_tag(replay_index_tag);
+}
+
+void replay_index_writer::add(uint64_t timestamp, const session& s)
+{
+    if (timestamp < _last_timestamp) {
+        throw checkpoint_error("replay index entries are out of order: " + std::to_string(timestamp));
+    }
+    _last_timestamp = timestamp;
+    std::ostringstream buf;
+    checkpoint_writer writer{buf};
+    s.save_checkpoint(writer);
+    auto checkpoint = buf.str();
+    _writer.write_u8(1);
+    _writer.write_u64(timestamp);
+    _writer.write_u64(s.position());
+    _writer.write_u64(checkpoint.size());
+    _out.write(checkpoint.data(), checkpoint.size());
+}
+
+void replay_index_writer::close()
+{
+    _writer.write_u8(0);
+    _out.close();
+    if (!_out) {
+        throw checkpoint_error("unable to write replay index");
+    }
+}
+
+replay_index::replay_index(const std::string& filename)
+    : _filename{filename}
+{
+    std::ifstream in{filename, std::ios::binary};
+    checkpoint_reader reader{in};
+    reader.read_tag(replay_index_tag);
+    while (reader.read_u8()) {
+        replay_index_entry entry;
+        entry.timestamp = reader.read_u64();
+        entry.position = reader.read_u64();
+        auto size = reader.read_u64();
+        entry.checkpoint_offset = in.tellg();
+        in.seekg(size, std::ios::cur);
+        _entries.push_back(entry);
+    }
+}
+
+const replay_index_entry* replay_index::lookup(uint64_t timestamp) const
+{
+    auto it = std::upper_bound(_entries.begin(), _entries.end(), timestamp, [](uint64_t t, const replay_index_entry& e) {
+        return t < e.timestamp;
+    });
+    if (it == _entries.begin()) {
+        return nullptr;
+    }
+    return &*(it - 1);
+}
+
+void replay_index::load(const replay_index_entry& entry, session& s) const
+{
+    std::ifstream in{_filename, std::ios::binary};
+    in.seekg(entry.checkpoint_offset);
+    checkpoint_reader reader{in};
+    s.load_checkpoint(reader);
+}
+
+bool replay_index::seek(uint64_t timestamp, session& s) const
+{
+    auto* entry = lookup(timestamp);
+    if (!entry) {
+        return false;
+    }
+    load(*entry, s);
+    return true;
+}
+
+}
@@ -0,0 +1,85 @@
+#include "helix/sizing_hints.hh"
+
+#include "helix/checkpoint.hh"
+
+#include <algorithm>
+#include <fstream>
+
+namespace helix {
+
+static const std::string sizing_hints_tag = "sizing-hints";
+
+static std::string unpadded(const std::string& symbol)
+{
+    auto end = symbol.find_last_not_of(' ');
+    return end == std::string::npos ? std::string{} : symbol.substr(0, end + 1);
+}
+
+void sizing_hints::set(const std::string& symbol, const symbol_sizing& sizing)
+{
+    _symbols[unpadded(symbol)] = sizing;
+}
+
+const symbol_sizing* sizing_hints::find(const std::string& symbol) const
+{
+    auto it = _symbols.find(unpadded(symbol));
+    if (it == _symbols.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+size_t sizing_hints::max_orders(const std::string& symbol, size_t max_orders) const
+{
+    auto* sizing = find(symbol);
+    return sizing ? std::max<size_t>(sizing->max_orders, max_orders) : max_orders;
+}
+
+std::vector<std::string> sizing_hints::symbols() const
+{
+    std::vector<std::string> result;
+    for (auto&& kv : _symbols) {
+        result.push_back(kv.first);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+sizing_hints sizing_hints::load(const std::string& filename)
+{
+    std::ifstream in{filename, std::ios::binary};
+    checkpoint_reader reader{in};
+    reader.read_tag(sizing_hints_tag);
+    sizing_hints hints;
+    auto count = reader.read_u64();
+    for (uint64_t i = 0; i < count; i++) {
+        auto symbol = reader.read_string();
+        symbol_sizing sizing;
+        sizing.max_orders = reader.read_u64();
+        sizing.max_bid_levels = reader.read_u64();
+        sizing.max_ask_levels = reader.read_u64();
+        hints._symbols.emplace(std::move(symbol), sizing);
+    }
+    return hints;
+}
+
+void sizing_hints::save(const std::string& filename) const
+{
+    std::ofstream out{filename, std::ios::binary | std::ios::trunc};
+    checkpoint_writer writer{out};
+    writer.write_tag(sizing_hints_tag);
+    writer.write_u64(_symbols.size());
+    for (auto&& symbol : symbols()) {
+        auto& sizing = _symbols.at(symbol);
+        writer.write_string(symbol);
+        writer.write_u64(sizing.max_orders);
+        writer.write_u64(sizing.max_bid_levels);
+        writer.write_u64(sizing.max_ask_levels);
+    }
+    out.close();
+    if (!out) {
+        throw checkpoint_error("unable to write sizing hints");
+    }
+}
+
+}
@@ -0,0 +1,152 @@
+#include <helix/net.hh>
+#include <helix/nasdaq/binaryfile.hh>
+#include <helix/batch.hh>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <random>
+
+using namespace helix;
+using namespace helix::nasdaq;
+
+// Sizes of the files of the batch in MiB: one large day among many small
+// ones. Files are dealt to the workers largest first, so the worker that gets
+// the large day is left with small files queued behind it, which the other
+// workers steal once their own queues are empty.
+static const std::vector<size_t> file_sizes_mib = {2, 2, 4, 2, 96, 2, 4, 2, 2, 4, 2, 2, 2, 4, 2, 2};
+
+//! Smallest number of workers, so that there is someone to steal from even
+//! on a machine with a single core.
+static constexpr size_t min_workers = 2;
+
+// Handler that accepts every message.
+struct null_handler {
+    bool is_rth_timestamp(uint64_t) { return true; }
+    void subscribe(const std::string&, size_t) { }
+    void register_callback(event_callback) { }
+    void save(checkpoint_writer&) const { }
+    void load(checkpoint_reader&) { }
+    void set_pacer(pacer*) { }
+
+    size_t process_packet(const net::packet_view& packet) {
+        return packet.len();
+    }
+};
+
+struct checksum_session : binaryfile_session<null_handler> {
+    uint64_t* sum;
+
+    explicit checksum_session(uint64_t* sum)
+        : binaryfile_session<null_handler>{nullptr}
+        , sum{sum}
+    { }
+
+    virtual size_t process_packet(const net::packet_view& packet) override {
+        size_t nr = binaryfile_session<null_handler>::process_packet(packet);
+        if (!nr) {
+            return 0;
+        }
+        // Stand in for decoding and order book work on every message.
+        uint64_t h = *sum;
+        for (size_t i = 2; i < nr; i++) {
+            h = (h ^ uint8_t(packet.buf()[i])) * 0x100000001b3;
+        }
+        *sum = h;
+        return nr;
+    }
+};
+
+struct checksum_protocol : protocol {
+    virtual session* new_session(void* data) override {
+        return new checksum_session{static_cast<uint64_t*>(data)};
+    }
+};
+
+// Write a BinaryFILE of ITCH-sized frames.
+static void make_file(const std::string& filename, size_t size, uint64_t seed)
+{
+    std::mt19937_64 rng{seed};
+    FILE* f = fopen(filename.c_str(), "w");
+    if (!f) {
+        throw std::runtime_error("unable to create " + filename);
+    }
+    char frame[2 + 50];
+    size_t written = 0;
+    while (written < size) {
+        uint16_t len = 20 + rng() % 30;
+        uint16_t be_len = htobe16(len);
+        std::memcpy(frame, &be_len, sizeof(be_len));
+        for (size_t i = 0; i < len; i++) {
+            frame[2 + i] = rng();
+        }
+        fwrite(frame, 1, 2 + len, f);
+        written += 2 + len;
+    }
+    fclose(f);
+}
+
+static void test_batch(const char* name, const std::vector<std::string>& filenames, size_t nr_threads, size_t max_sessions, bool expect_steals, std::vector<uint64_t>& sums)
+{
+    checksum_protocol proto;
+    batch_config config;
+    config.nr_threads = nr_threads;
+    config.max_sessions = max_sessions;
+    batch_runner batch{config};
+    for (auto&& filename : filenames) {
+        batch.add(batch_file{filename, &proto});
+    }
+    sums.assign(filenames.size(), 0);
+    batch.run([&](size_t index, const batch_file& file) {
+        return std::unique_ptr<session>{file.proto->new_session(&sums[index])};
+    });
+    auto& stats = batch.stats();
+    if (stats.failed) {
+        std::cerr << "error: " << stats.failed << " files failed" << std::endl;
+        std::abort();
+    }
+    if (expect_steals && !stats.steals) {
+        std::cerr << "error: " << name << "no files were stolen" << std::endl;
+        std::abort();
+    }
+    auto ms = stats.duration_ns / 1000000;
+    std::cout << name << batch.nr_workers() << " workers: " << ms << " ms, "
+              << (stats.bytes / 1024 / 1024) * 1000 / std::max<uint64_t>(ms, 1) << " MiB/s, "
+              << stats.steals << " stolen" << std::endl;
+}
+
+int main()
+{
+    std::vector<std::string> filenames;
+    for (size_t i = 0; i < file_sizes_mib.size(); i++) {
+        char filename[] = "/tmp/helix-batch-XXXXXX";
+        int fd = mkstemp(filename);
+        if (fd < 0) {
+            std::cerr << "error: unable to create a temporary file" << std::endl;
+            std::abort();
+        }
+        close(fd);
+        make_file(filename, file_sizes_mib[i] * 1024 * 1024, i);
+        filenames.push_back(filename);
+    }
+
+    size_t nr_workers = std::max<size_t>(min_workers, std::thread::hardware_concurrency());
+    std::vector<uint64_t> serial_sums, parallel_sums, bounded_sums;
+    test_batch("serial          ", filenames, 1, 0, false, serial_sums);
+    test_batch("work stealing   ", filenames, nr_workers, 0, true, parallel_sums);
+    test_batch("two sessions    ", filenames, nr_workers, 2, true, bounded_sums);
+    if (parallel_sums != serial_sums || bounded_sums != serial_sums) {
+        std::cerr << "error: batch replays disagree" << std::endl;
+        std::abort();
+    }
+
+    for (auto&& filename : filenames) {
+        unlink(filename.c_str());
+    }
+}
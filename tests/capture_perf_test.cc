@@ -0,0 +1,152 @@
+#include <helix/net.hh>
+#include <helix/capture.hh>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <vector>
+#include <chrono>
+#include <random>
+
+using namespace helix;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+static constexpr size_t nr_packets = 2000000;
+
+// Packets per second that the capture writer records, well above the peak
+// of a busy MoldUDP feed. Every packet must be recorded at this rate.
+static constexpr uint64_t capture_rate = 1000000;
+
+// Packet lengths of a MoldUDP feed: mostly a few messages, sometimes full.
+static std::vector<size_t> make_lengths()
+{
+    std::mt19937_64 rng{42};
+    std::vector<size_t> lengths(nr_packets);
+    for (auto&& len : lengths) {
+        len = rng() % 100 ? 40 + rng() % 200 : 1400;
+    }
+    return lengths;
+}
+
+static void report(const char* name, std::vector<uint64_t>& latencies, clock_type::duration duration)
+{
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) {
+        return latencies[std::min(latencies.size() - 1, size_t(p * latencies.size()))];
+    };
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    std::cout << name << ms << " ms, latency p50 " << pct(0.5) << " ns, p99 " << pct(0.99) << " ns, p99.9 " << pct(0.999)
+              << " ns, max " << latencies.back() << " ns" << std::endl;
+}
+
+// Write every packet with a system call of its own, the way a naive
+// recorder on the receive path would.
+auto test_write(const char* filename, const std::vector<size_t>& lengths, const char* payload, std::vector<uint64_t>& latencies)
+{
+    int fd = open(filename, O_WRONLY | O_TRUNC);
+    auto start = clock_type::now();
+    for (size_t i = 0; i < lengths.size(); i++) {
+        auto t0 = clock_type::now();
+        capture_packet_header header{};
+        header.len = lengths[i];
+        write(fd, &header, sizeof(header));
+        write(fd, payload, lengths[i]);
+        latencies[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - t0).count();
+    }
+    auto end = clock_type::now();
+    close(fd);
+    return end - start;
+}
+
+// Record packets as they arrive at capture_rate, timing every record.
+auto test_capture(const char* filename, const std::vector<size_t>& lengths, const char* payload, std::vector<uint64_t>& latencies, capture_stats& stats)
+{
+    unlink(filename);
+    auto start = clock_type::now();
+    capture_writer writer{filename};
+    std::chrono::nanoseconds interval{1000000000 / capture_rate};
+    for (size_t i = 0; i < lengths.size(); i++) {
+        while (clock_type::now() < start + i * interval) {
+        }
+        auto t0 = clock_type::now();
+        writer.record(i, i % 2, net::packet_view{payload, lengths[i]});
+        latencies[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - t0).count();
+    }
+    writer.close();
+    auto end = clock_type::now();
+    stats = writer.stats();
+    return end - start;
+}
+
+int main()
+{
+    char filename[] = "/tmp/helix-capture-XXXXXX";
+    int fd = mkstemp(filename);
+    if (fd < 0) {
+        std::cerr << "error: unable to create a temporary file" << std::endl;
+        std::abort();
+    }
+    close(fd);
+
+    auto lengths = make_lengths();
+    std::vector<char> payload(1400);
+    std::iota(payload.begin(), payload.end(), 0);
+    std::vector<uint64_t> latencies(nr_packets);
+
+    auto write_duration = test_write(filename, lengths, payload.data(), latencies);
+    report("write() per packet  ", latencies, write_duration);
+
+    capture_stats stats;
+    auto capture_duration = test_capture(filename, lengths, payload.data(), latencies, stats);
+    report("capture writer      ", latencies, capture_duration);
+    std::cout << "recorded " << stats.packets << " packets at " << capture_rate << " packets/s, dropped " << stats.dropped << std::endl;
+    if (stats.dropped) {
+        std::cerr << "error: the capture writer dropped packets" << std::endl;
+        std::abort();
+    }
+
+    capture_reader reader{filename};
+    capture_packet packet;
+    uint64_t count = 0;
+    while (reader.next(packet)) {
+        if (packet.line != packet.timestamp % 2 || packet.payload.len() != lengths[packet.timestamp]
+                || std::memcmp(packet.payload.buf(), payload.data(), packet.payload.len())) {
+            std::cerr << "error: packet " << count << " does not match" << std::endl;
+            std::abort();
+        }
+        count++;
+    }
+    if (count != stats.packets || reader.truncated()) {
+        std::cerr << "error: read " << count << " packets of " << stats.packets << std::endl;
+        std::abort();
+    }
+
+    // Cut the last packet short, the way a killed recording does, and
+    // append to the recording. The truncated packet is dropped.
+    struct stat st;
+    if (stat(filename, &st) < 0 || truncate(filename, st.st_size - 3) < 0) {
+        std::cerr << "error: unable to truncate the capture" << std::endl;
+        std::abort();
+    }
+    {
+        capture_writer writer{filename};
+        writer.record(lengths.size() - 1, 0, net::packet_view{payload.data(), 64});
+        writer.close();
+    }
+    capture_reader appended{filename};
+    count = 0;
+    while (appended.next(packet)) {
+        count++;
+    }
+    if (count != stats.packets || appended.truncated() || packet.payload.len() != 64) {
+        std::cerr << "error: read " << count << " packets of an appended capture of " << stats.packets << std::endl;
+        std::abort();
+    }
+
+    unlink(filename);
+}
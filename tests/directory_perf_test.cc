@@ -0,0 +1,118 @@
+#include <helix/nasdaq/nordic_itch_handler.hh>
+// The message headers of both feeds define ITCH_SYMBOL_LEN.
+#undef ITCH_SYMBOL_LEN
+#include <helix/nasdaq/itch50_handler.hh>
+#include <helix/net.hh>
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+
+using namespace helix;
+using namespace helix::nasdaq;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+// Stocks in the directory of a trading day, and how many of them a
+// session subscribes to.
+static constexpr size_t nr_stocks = 8000;
+static constexpr size_t nr_subscribed = 1000;
+static constexpr size_t nr_sessions = 50;
+
+static std::string stock_symbol(size_t i)
+{
+    char symbol[32];
+    snprintf(symbol, sizeof(symbol), "S%05u", unsigned(i));
+    return symbol;
+}
+
+static std::vector<itch50_stock_directory> make_itch50_directory()
+{
+    std::vector<itch50_stock_directory> msgs(nr_stocks);
+    for (size_t i = 0; i < msgs.size(); i++) {
+        auto& m = msgs[i];
+        std::memset(&m, 0, sizeof(m));
+        m.MessageType = 'R';
+        m.StockLocate = i + 1;
+        auto symbol = stock_symbol(i);
+        std::memset(m.Stock, ' ', sizeof(m.Stock));
+        std::memcpy(m.Stock, symbol.data(), symbol.size());
+    }
+    return msgs;
+}
+
+static std::vector<itch_order_book_directory> make_nordic_directory()
+{
+    std::vector<itch_order_book_directory> msgs(nr_stocks);
+    for (size_t i = 0; i < msgs.size(); i++) {
+        auto& m = msgs[i];
+        std::memset(&m, ' ', sizeof(m));
+        m.MsgType = 'R';
+        char order_book[32];
+        snprintf(order_book, sizeof(order_book), "%6u", unsigned(i + 1));
+        std::memcpy(m.OrderBook, order_book, sizeof(m.OrderBook));
+        auto symbol = stock_symbol(i);
+        std::memcpy(m.Symbol, symbol.data(), symbol.size());
+    }
+    return msgs;
+}
+
+// Process the directory of a day in new sessions that subscribe to every
+// eighth stock without pre-allocating their order books, so that matching
+// symbols dominates, and return the time spent in directory messages.
+template<typename Handler, typename Message>
+clock_type::duration test_directory(const std::vector<Message>& msgs)
+{
+    clock_type::duration duration{};
+    for (size_t session = 0; session < nr_sessions; session++) {
+        Handler handler;
+        handler.register_callback([](const event&) { });
+        for (size_t i = 0; i < nr_subscribed; i++) {
+            handler.subscribe(stock_symbol(i * (nr_stocks / nr_subscribed)), 0);
+        }
+        auto start = clock_type::now();
+        for (auto&& m : msgs) {
+            handler.process_packet(net::packet_view{reinterpret_cast<const char*>(&m), sizeof(m)});
+        }
+        duration += clock_type::now() - start;
+    }
+    return duration;
+}
+
+// Check that a symbol that does not fit the symbol field of the feed is
+// rejected instead of never matching.
+template<typename Handler>
+void test_long_symbol(const char* name, size_t field_len)
+{
+    Handler handler;
+    handler.subscribe(std::string(field_len, 'S'), 0);
+    bool rejected = false;
+    try {
+        handler.subscribe(std::string(field_len + 1, 'S'), 0);
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    if (!rejected) {
+        std::cerr << "error: " << name << " accepted a symbol that is too long" << std::endl;
+        std::abort();
+    }
+}
+
+int main()
+{
+    test_long_symbol<itch50_handler>("itch50_handler", sizeof(itch50_stock_directory::Stock));
+    test_long_symbol<nordic_itch_handler>("nordic_itch_handler", sizeof(itch_order_book_directory::Symbol));
+    auto itch50_msgs = make_itch50_directory();
+    auto nordic_msgs = make_nordic_directory();
+    auto itch50_duration = test_directory<itch50_handler>(itch50_msgs);
+    auto nordic_duration = test_directory<nordic_itch_handler>(nordic_msgs);
+    auto nr_msgs = nr_stocks * nr_sessions;
+    std::cout << "itch50_handler stock directory           "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(itch50_duration).count() / nr_msgs << " ns/msg" << std::endl;
+    std::cout << "nordic_itch_handler order book directory "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(nordic_duration).count() / nr_msgs << " ns/msg" << std::endl;
+}
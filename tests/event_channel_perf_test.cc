@@ -0,0 +1,140 @@
+#include <helix/event_channel.hh>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <string>
+
+using namespace helix;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+static constexpr size_t nr_records = 2000000;
+static constexpr size_t nr_producers = 2;
+static constexpr size_t nr_consumers = 3;
+static constexpr size_t nr_symbols = 64;
+static constexpr size_t batch_size = 16;
+
+// Records that a consumer received, and the timestamp of the latest record
+// of every symbol.
+struct delivery {
+    size_t received = 0;
+    std::vector<uint64_t> last_timestamp = std::vector<uint64_t>(nr_symbols);
+    bool out_of_order = false;
+};
+
+// Publish the records of a session: every producer has symbols of its own,
+// whose records are timestamped in the order they are published.
+static void produce(event_channel& channel, size_t producer, std::vector<uint64_t>& last_timestamp)
+{
+    std::vector<event_record> batch(batch_size);
+    for (size_t i = 0; i < nr_records / nr_producers; i += batch_size) {
+        for (size_t j = 0; j < batch_size; j++) {
+            auto& record = batch[j];
+            record = {};
+            record.symbol_id = producer + nr_producers * ((i + j) % (nr_symbols / nr_producers));
+            record.mask = ev_order_book_update;
+            record.timestamp = i + j + 1;
+            last_timestamp[record.symbol_id] = record.timestamp;
+        }
+        channel.publish(batch.data(), batch.size());
+    }
+}
+
+// Consume records until the channel is closed and drained. The last
+// consumer spends some time on every record, the way a consumer that
+// formats its records would. A conflating channel may deliver the latest
+// record of a symbol again if it was stored while the symbol was consumed.
+static void consume(event_channel& channel, size_t consumer, bool conflate, delivery& d)
+{
+    std::vector<event_record> batch(batch_size);
+    for (;;) {
+        bool closed = channel.is_closed();
+        size_t n = channel.consume(consumer, batch.data(), batch.size());
+        if (!n) {
+            if (closed) {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < n; i++) {
+            auto& record = batch[i];
+            auto last = d.last_timestamp[record.symbol_id];
+            if (record.timestamp < last || (record.timestamp == last && !conflate)) {
+                d.out_of_order = true;
+            }
+            d.last_timestamp[record.symbol_id] = record.timestamp;
+            if (consumer == nr_consumers - 1) {
+                for (volatile int spin = 0; spin < 100; spin++) {
+                }
+            }
+        }
+        d.received += n;
+    }
+}
+
+// Fan the records of several producers out to every consumer and check
+// that each consumer either received or was told it missed every record.
+static void test_channel(const char* name, backpressure policy)
+{
+    event_channel channel{4096, policy};
+    for (size_t i = 0; i < nr_symbols; i++) {
+        channel.add_symbol("S" + std::to_string(i));
+    }
+    std::vector<delivery> deliveries(nr_consumers);
+    std::vector<std::thread> consumers;
+    for (size_t i = 0; i < nr_consumers; i++) {
+        channel.add_consumer();
+    }
+    auto start = clock_type::now();
+    for (size_t i = 0; i < nr_consumers; i++) {
+        consumers.emplace_back(consume, std::ref(channel), i, policy == backpressure::conflate, std::ref(deliveries[i]));
+    }
+    std::vector<std::vector<uint64_t>> last_timestamps(nr_producers, std::vector<uint64_t>(nr_symbols));
+    std::vector<std::thread> producers;
+    for (size_t i = 0; i < nr_producers; i++) {
+        producers.emplace_back(produce, std::ref(channel), i, std::ref(last_timestamps[i]));
+    }
+    for (auto&& t : producers) {
+        t.join();
+    }
+    channel.close();
+    for (auto&& t : consumers) {
+        t.join();
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::now() - start).count();
+
+    std::cout << name << ms << " ms";
+    for (size_t i = 0; i < nr_consumers; i++) {
+        auto& d = deliveries[i];
+        auto dropped = channel.dropped(i);
+        std::cout << ", consumer " << i << " received " << d.received << " dropped " << dropped;
+        bool lost = d.received + dropped != nr_records;
+        if (policy == backpressure::block && dropped) {
+            lost = true;
+        }
+        if (policy == backpressure::conflate) {
+            // Conflation drops updates, but never the latest one of a symbol.
+            for (size_t symbol_id = 0; symbol_id < nr_symbols; symbol_id++) {
+                if (d.last_timestamp[symbol_id] != last_timestamps[symbol_id % nr_producers][symbol_id]) {
+                    lost = true;
+                }
+            }
+        }
+        if (lost || d.out_of_order) {
+            std::cout << std::endl;
+            std::cerr << "error: " << name << "consumer " << i << (lost ? " lost records" : " received records out of order") << std::endl;
+            std::abort();
+        }
+    }
+    std::cout << std::endl;
+}
+
+int main()
+{
+    test_channel("block       ", backpressure::block);
+    test_channel("drop oldest ", backpressure::drop_oldest);
+    test_channel("conflate    ", backpressure::conflate);
+}
@@ -0,0 +1,240 @@
+#include <helix/net.hh>
+#include <helix/nasdaq/binaryfile.hh>
+#include <helix/file_reader.hh>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <zlib.h>
+#ifdef HELIX_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <chrono>
+#include <random>
+
+using namespace helix;
+using namespace helix::nasdaq;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+static constexpr size_t file_size = 256 * 1024 * 1024;
+
+// Handler that accepts every message.
+struct null_handler {
+    bool is_rth_timestamp(uint64_t) { return true; }
+    void subscribe(const std::string&, size_t) { }
+    void register_callback(event_callback) { }
+    void save(checkpoint_writer&) const { }
+    void load(checkpoint_reader&) { }
+    void set_pacer(pacer*) { }
+
+    size_t process_packet(const net::packet_view& packet) {
+        return packet.len();
+    }
+};
+
+struct checksum_session : binaryfile_session<null_handler> {
+    checksum_session()
+        : binaryfile_session<null_handler>{nullptr}
+    { }
+
+    //! Checksum of the frames that the session has processed.
+    uint64_t sum = 0;
+
+    virtual size_t process_packet(const net::packet_view& packet) override {
+        size_t nr = binaryfile_session<null_handler>::process_packet(packet);
+        if (!nr) {
+            return 0;
+        }
+        sum += uint8_t(packet.buf()[2]) + uint8_t(packet.buf()[nr - 1]) + nr - 2;
+        return nr;
+    }
+};
+
+// Write a BinaryFILE of ITCH-sized frames, with an occasional frame of the
+// largest size so that frames straddle reads.
+static void make_file(const char* filename)
+{
+    std::mt19937_64 rng{42};
+    FILE* f = fopen(filename, "w");
+    if (!f) {
+        throw std::runtime_error(std::string{"unable to create "} + filename);
+    }
+    std::vector<char> frame(file_reader_max_frame_size);
+    size_t written = 0;
+    while (written < file_size) {
+        uint16_t len = rng() % 1000 ? 20 + rng() % 30 : 65535;
+        uint16_t be_len = htobe16(len);
+        std::memcpy(frame.data(), &be_len, sizeof(be_len));
+        for (size_t i = 0; i < len; i++) {
+            frame[2 + i] = rng();
+        }
+        fwrite(frame.data(), 1, 2 + len, f);
+        written += 2 + len;
+    }
+    fclose(f);
+}
+
+// Compress a file with gzip at the fastest level.
+static void gzip_file(const char* filename, const char* gz_filename)
+{
+    FILE* in = fopen(filename, "r");
+    gzFile out = gzopen(gz_filename, "wb1");
+    if (!in || !out) {
+        throw std::runtime_error(std::string{"unable to create "} + gz_filename);
+    }
+    std::vector<char> buf(1024 * 1024);
+    size_t nr;
+    while ((nr = fread(buf.data(), 1, buf.size(), in)) > 0) {
+        gzwrite(out, buf.data(), nr);
+    }
+    gzclose(out);
+    fclose(in);
+}
+
+#ifdef HELIX_HAVE_ZSTD
+// Compress a file with zstd at the fastest level.
+static void zstd_file(const char* filename, const char* zst_filename)
+{
+    FILE* in = fopen(filename, "r");
+    FILE* out = fopen(zst_filename, "w");
+    ZSTD_CStream* stream = ZSTD_createCStream();
+    if (!in || !out || !stream) {
+        throw std::runtime_error(std::string{"unable to create "} + zst_filename);
+    }
+    ZSTD_initCStream(stream, 1);
+    std::vector<char> in_buf(ZSTD_CStreamInSize());
+    std::vector<char> out_buf(ZSTD_CStreamOutSize());
+    size_t nr;
+    do {
+        nr = fread(in_buf.data(), 1, in_buf.size(), in);
+        ZSTD_inBuffer input = {in_buf.data(), nr, 0};
+        auto mode = nr < in_buf.size() ? ZSTD_e_end : ZSTD_e_continue;
+        size_t remaining;
+        do {
+            ZSTD_outBuffer output = {out_buf.data(), out_buf.size(), 0};
+            remaining = ZSTD_compressStream2(stream, &output, &input, mode);
+            if (ZSTD_isError(remaining)) {
+                throw std::runtime_error(std::string{"zstd: "} + ZSTD_getErrorName(remaining));
+            }
+            fwrite(out_buf.data(), 1, output.pos, out);
+        } while (mode == ZSTD_e_end ? remaining : input.pos < input.size);
+    } while (nr == in_buf.size());
+    ZSTD_freeCStream(stream);
+    fclose(out);
+    fclose(in);
+}
+#endif
+
+// Evict the file from the page cache so that every run reads it from disk.
+static void drop_cache(const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// Replay the file mapped whole, the way helix-trace used to.
+auto test_mmap_whole(const char* filename, uint64_t& sum)
+{
+    drop_cache(filename);
+    auto start = clock_type::now();
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    fstat(fd, &st);
+    auto* p = static_cast<const char*>(mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0));
+    checksum_session s;
+    size_t offset = 0;
+    while (offset < size_t(st.st_size)) {
+        offset += s.process_packet(net::packet_view{p + offset, st.st_size - offset});
+    }
+    munmap(const_cast<char*>(p), st.st_size);
+    close(fd);
+    auto end = clock_type::now();
+    sum = s.sum;
+    return end - start;
+}
+
+auto test_reader(const char* filename, read_mode mode, uint64_t& sum)
+{
+    drop_cache(filename);
+    auto start = clock_type::now();
+    auto reader = open_file_reader(filename, mode);
+    checksum_session s;
+    replay(s, *reader);
+    auto end = clock_type::now();
+    sum = s.sum;
+    return end - start;
+}
+
+static void report(const char* name, clock_type::duration duration)
+{
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    std::cout << name << ms << " ms, " << (file_size / 1024 / 1024) * 1000 / std::max<int64_t>(ms, 1) << " MiB/s" << std::endl;
+}
+
+int main()
+{
+    char filename[] = "/tmp/helix-file-reader-XXXXXX";
+    int fd = mkstemp(filename);
+    if (fd < 0) {
+        std::cerr << "error: unable to create a temporary file" << std::endl;
+        std::abort();
+    }
+    close(fd);
+    make_file(filename);
+
+    uint64_t whole_sum = 0, mmap_sum = 0, pread_sum = 0;
+    auto whole_duration = test_mmap_whole(filename, whole_sum);
+    auto mmap_duration = test_reader(filename, read_mode::mmap, mmap_sum);
+    auto pread_duration = test_reader(filename, read_mode::pread, pread_sum);
+    if (mmap_sum != whole_sum || pread_sum != whole_sum) {
+        std::cerr << "error: file readers disagree" << std::endl;
+        std::abort();
+    }
+    report("whole-file mmap     ", whole_duration);
+    report("sliding-window mmap ", mmap_duration);
+    report("double-buffer pread ", pread_duration);
+
+    std::string gz_filename = std::string{filename} + ".gz";
+    gzip_file(filename, gz_filename.c_str());
+    uint64_t gzip_sum = 0;
+    auto gzip_duration = test_reader(gz_filename.c_str(), read_mode::mmap, gzip_sum);
+    if (gzip_sum != whole_sum) {
+        std::cerr << "error: file readers disagree" << std::endl;
+        std::abort();
+    }
+    report("gzip                ", gzip_duration);
+    unlink(gz_filename.c_str());
+#ifdef HELIX_HAVE_ZSTD
+    std::string zst_filename = std::string{filename} + ".zst";
+    zstd_file(filename, zst_filename.c_str());
+    uint64_t zstd_sum = 0;
+    auto zstd_duration = test_reader(zst_filename.c_str(), read_mode::mmap, zstd_sum);
+    if (zstd_sum != whole_sum) {
+        std::cerr << "error: file readers disagree" << std::endl;
+        std::abort();
+    }
+    report("zstd                ", zstd_duration);
+    unlink(zst_filename.c_str());
+#endif
+#ifdef HELIX_HAVE_IO_URING
+    uint64_t io_uring_sum = 0;
+    auto io_uring_duration = test_reader(filename, read_mode::io_uring, io_uring_sum);
+    if (io_uring_sum != whole_sum) {
+        std::cerr << "error: file readers disagree" << std::endl;
+        std::abort();
+    }
+    report("io_uring            ", io_uring_duration);
+#endif
+
+    unlink(filename);
+}
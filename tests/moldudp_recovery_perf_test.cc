@@ -0,0 +1,392 @@
+#include <helix/nasdaq/line_arbitration.hh>
+#include <helix/nasdaq/moldudp64.hh>
+#include <helix/nasdaq/moldudp.hh>
+#include <helix/net.hh>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <random>
+
+using namespace helix;
+using namespace helix::nasdaq;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+static constexpr size_t message_size = 6;
+static constexpr size_t messages_per_packet = 20;
+
+// Number of messages processed by the handler.
+static uint64_t processed;
+
+// Handler that counts the messages it receives and checks their order.
+struct counting_handler {
+    bool is_rth_timestamp(uint64_t) { return true; }
+    void subscribe(const std::string&, size_t) { }
+    void register_callback(event_callback) { }
+    void save(checkpoint_writer&) const { }
+    void load(checkpoint_reader&) { }
+    void set_pacer(pacer*) { }
+
+    void process_packet(const net::packet_view& packet) {
+        uint32_t seq_num;
+        std::memcpy(&seq_num, packet.buf(), sizeof(seq_num));
+        if (seq_num != ++processed) {
+            throw std::runtime_error("message out of order: " + std::to_string(seq_num));
+        }
+    }
+};
+
+// MoldUDP64 counterpart of counting_handler.
+struct counting_handler64 : counting_handler {
+    void process_packet(const net::packet_view& packet, bool sync) {
+        counting_handler::process_packet(packet);
+    }
+};
+
+// Build a MoldUDP packet with messages from @seq_num. The payload of each
+// message is its sequence number.
+static std::vector<char> make_packet(uint32_t seq_num, size_t count)
+{
+    std::vector<char> buf(sizeof(moldudp_header));
+    auto* header = reinterpret_cast<moldudp_header*>(buf.data());
+    std::memcpy(header->Session, "0000000001", sizeof(header->Session));
+    header->SequenceNumber = seq_num;
+    header->MessageCount = count;
+    for (size_t i = 0; i < count; i++) {
+        moldudp_message_block block;
+        block.MessageLength = message_size;
+        auto* p = reinterpret_cast<const char*>(&block);
+        buf.insert(buf.end(), p, p + sizeof(block));
+        char msg[message_size] = {};
+        uint32_t n = seq_num + i;
+        std::memcpy(msg, &n, sizeof(n));
+        buf.insert(buf.end(), msg, msg + message_size);
+    }
+    return buf;
+}
+
+// Build a MoldUDP64 packet with messages from @seq_no, like make_packet().
+static std::vector<char> make_packet64(uint64_t seq_no, size_t count)
+{
+    std::vector<char> buf(sizeof(moldudp64_header));
+    auto* header = reinterpret_cast<moldudp64_header*>(buf.data());
+    std::memcpy(header->Session, "0000000001", sizeof(header->Session));
+    header->SequenceNumber = htobe64(seq_no);
+    header->MessageCount = htobe16(count);
+    for (size_t i = 0; i < count; i++) {
+        moldudp64_message_block block;
+        block.MessageLength = htobe16(message_size);
+        auto* p = reinterpret_cast<const char*>(&block);
+        buf.insert(buf.end(), p, p + sizeof(block));
+        char msg[message_size] = {};
+        uint32_t n = seq_no + i;
+        std::memcpy(msg, &n, sizeof(n));
+        buf.insert(buf.end(), msg, msg + message_size);
+    }
+    return buf;
+}
+
+// Stand-in for a MoldUDP request server on the loopback interface. It answers
+// every request with the requested messages.
+class request_server {
+    int _fd;
+    uint32_t _nr_messages;
+    std::thread _thread;
+    std::atomic<bool> _stop{false};
+public:
+    std::atomic<uint64_t> messages{0};
+
+    explicit request_server(uint32_t nr_messages)
+        : _fd{socket(AF_INET, SOCK_DGRAM, 0)}
+        , _nr_messages{nr_messages}
+    {
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            throw std::runtime_error("bind");
+        }
+        timeval tv = {0, 100000};
+        setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        _thread = std::thread{[this] { run(); }};
+    }
+
+    ~request_server() {
+        _stop.store(true);
+        _thread.join();
+        close(_fd);
+    }
+
+    sockaddr_in address() const {
+        sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        getsockname(_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        return addr;
+    }
+
+private:
+    void run() {
+        while (!_stop.load()) {
+            moldudp_request_packet request;
+            sockaddr_in peer;
+            socklen_t len = sizeof(peer);
+            auto nr = recvfrom(_fd, &request, sizeof(request), 0, reinterpret_cast<sockaddr*>(&peer), &len);
+            if (nr != sizeof(request)) {
+                continue;
+            }
+            uint32_t seq_num = request.SequenceNumber;
+            uint32_t end = std::min<uint32_t>(seq_num + request.MessageCount, _nr_messages + 1);
+            while (seq_num < end) {
+                size_t count = std::min<size_t>(end - seq_num, messages_per_packet);
+                auto packet = make_packet(seq_num, count);
+                sendto(_fd, packet.data(), packet.size(), 0, reinterpret_cast<sockaddr*>(&peer), len);
+                messages += count;
+                seq_num += count;
+            }
+        }
+    }
+};
+
+struct recovery_stats {
+    std::vector<double> recovery_us;
+    retransmit_stats retransmit;
+    uint64_t lost_messages = 0;
+    uint64_t retransmitted_messages = 0;
+    uint64_t unrecovered_messages = 0;
+};
+
+// Replay @nr_messages messages, losing @burst consecutive packets at a time
+// with probability @loss.
+static recovery_stats test_recovery(uint32_t nr_messages, double loss, size_t burst)
+{
+    request_server server{nr_messages};
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    auto addr = server.address();
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        throw std::runtime_error("connect");
+    }
+    timeval tv = {0, 10000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    recovery_stats stats;
+    moldudp_session<counting_handler> session{nullptr};
+    session.set_send_callback([fd](char* base, size_t len) {
+        send(fd, base, len, 0);
+    });
+    processed = 0;
+    std::mt19937_64 rng{42};
+    std::bernoulli_distribution lose{loss};
+    bool recovering = false;
+    clock_type::time_point recovery_start;
+    char buf[65536];
+    auto process_retransmissions = [&](int flags) {
+        bool received = false;
+        ssize_t nr;
+        while ((nr = recv(fd, buf, sizeof(buf), flags)) > 0) {
+            session.process_packet(net::packet_view{buf, size_t(nr)});
+            flags = MSG_DONTWAIT;
+            received = true;
+        }
+        return received;
+    };
+    uint64_t received = 0;
+    size_t nr_lost = 0;
+    for (uint32_t seq_num = 1; seq_num <= nr_messages; seq_num += messages_per_packet) {
+        size_t count = std::min<size_t>(nr_messages - seq_num + 1, messages_per_packet);
+        if (!nr_lost && lose(rng)) {
+            nr_lost = burst;
+        }
+        // The last packet is never lost so that every gap is detected.
+        if (seq_num + count <= nr_messages && nr_lost) {
+            nr_lost--;
+            stats.lost_messages += count;
+            continue;
+        }
+        received = seq_num + count - 1;
+        auto packet = make_packet(seq_num, count);
+        auto requests = session.get_retransmit_stats().requests;
+        session.process_packet(net::packet_view{packet.data(), packet.size()});
+        if (!recovering && session.get_retransmit_stats().requests != requests) {
+            recovering = true;
+            recovery_start = clock_type::now();
+        }
+        if (recovering) {
+            // Let the request server run when it shares a CPU with us.
+            std::this_thread::yield();
+        }
+        process_retransmissions(MSG_DONTWAIT);
+        if (recovering && processed == received) {
+            recovering = false;
+            stats.recovery_us.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - recovery_start).count());
+        }
+    }
+    // Wait for the last gap to close. No more packets arrive on the feed,
+    // so the retransmission timeouts of the session are polled.
+    auto deadline = clock_type::now() + std::chrono::seconds{5};
+    while (processed < received && clock_type::now() < deadline) {
+        if (!process_retransmissions(0)) {
+            session.poll_retransmit();
+        }
+    }
+    stats.retransmit = session.get_retransmit_stats();
+    stats.unrecovered_messages = received - processed;
+    if (recovering && !stats.unrecovered_messages) {
+        stats.recovery_us.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - recovery_start).count());
+    }
+    stats.retransmitted_messages = server.messages;
+    close(fd);
+    return stats;
+}
+
+// Replay @nr_messages messages on two feed lines. Line A loses packets with
+// probability @loss and line B delivers every packet right after the next
+// packet of line A, so line B fills every gap of line A long before the
+// arbitration delay has passed, even though the retransmission config that
+// the session is given has no delay of its own.
+static void test_arbitration(uint32_t nr_messages, double loss)
+{
+    arbitrated_session<moldudp_session<counting_handler>> session{nullptr};
+    retransmit_config config;
+    config.delay = std::chrono::microseconds{0};
+    session.set_retransmit_config(config);
+    size_t nr_requests = 0;
+    session.set_send_callback([&nr_requests](char*, size_t) {
+        nr_requests++;
+    });
+    processed = 0;
+    std::mt19937_64 rng{42};
+    std::bernoulli_distribution lose{loss};
+    std::vector<char> line_b_packet;
+    auto start = clock_type::now();
+    for (uint32_t seq_num = 1; seq_num <= nr_messages; seq_num += messages_per_packet) {
+        size_t count = std::min<size_t>(nr_messages - seq_num + 1, messages_per_packet);
+        auto packet = make_packet(seq_num, count);
+        if (!lose(rng)) {
+            session.process_line_packet(0, net::packet_view{packet.data(), packet.size()});
+        }
+        if (!line_b_packet.empty()) {
+            session.process_line_packet(1, net::packet_view{line_b_packet.data(), line_b_packet.size()});
+        }
+        line_b_packet = std::move(packet);
+    }
+    session.process_line_packet(1, net::packet_view{line_b_packet.data(), line_b_packet.size()});
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - start).count();
+    auto line_a = session.get_line_stats(0);
+    auto line_b = session.get_line_stats(1);
+    std::cout << "arbitration, line A loss " << loss * 100 << "%: " << us << " us, "
+              << line_a.lost_messages << " messages lost on line A, "
+              << line_b.forwarded << " packets forwarded from line B, "
+              << session.get_retransmit_stats().requests << " requests" << std::endl;
+    if (processed != nr_messages || nr_requests || session.get_retransmit_stats().requests) {
+        std::cerr << "error: line B did not fill the gaps of line A before they were requested" << std::endl;
+        std::abort();
+    }
+}
+
+// Lose a packet and its retransmission while the feed is quiet, and check
+// that polling the session requests the packet again once the timeout has
+// expired, and not before.
+static void test_poll()
+{
+    moldudp_session<counting_handler> session{nullptr};
+    size_t nr_requests = 0;
+    session.set_send_callback([&nr_requests](char*, size_t) {
+        nr_requests++;
+    });
+    processed = 0;
+    auto first = make_packet(1, messages_per_packet);
+    auto third = make_packet(1 + 2 * messages_per_packet, messages_per_packet);
+    session.process_packet(net::packet_view{first.data(), first.size()});
+    session.process_packet(net::packet_view{third.data(), third.size()});
+    session.poll_retransmit();
+    auto requests = nr_requests;
+    std::this_thread::sleep_for(retransmit_config{}.timeout * 2);
+    session.poll_retransmit();
+    std::cout << "poll: " << requests << " requests at the gap, " << nr_requests - requests << " after the timeout" << std::endl;
+    if (requests != 1 || nr_requests != 2) {
+        std::cerr << "error: polling did not request the lost retransmission again" << std::endl;
+        std::abort();
+    }
+}
+
+// Replay @nr_messages messages on a MoldUDP64 session, delivering every
+// @window packets in reverse order, and check that the reorder buffer
+// applies them in order without requesting them.
+static void test_reorder64(uint32_t nr_messages, size_t window)
+{
+    moldudp64_session<counting_handler64> session{nullptr};
+    retransmit_config config;
+    config.delay = std::chrono::seconds{10};
+    session.set_retransmit_config(config);
+    size_t nr_requests = 0;
+    session.set_send_callback([&nr_requests](char*, size_t) {
+        nr_requests++;
+    });
+    processed = 0;
+    std::vector<std::vector<char>> packets;
+    auto start = clock_type::now();
+    for (uint64_t seq_no = 1; seq_no <= nr_messages; seq_no += messages_per_packet) {
+        size_t count = std::min<size_t>(nr_messages - seq_no + 1, messages_per_packet);
+        packets.push_back(make_packet64(seq_no, count));
+        if (packets.size() == window || seq_no + count > nr_messages) {
+            for (auto it = packets.rbegin(); it != packets.rend(); ++it) {
+                session.process_packet(net::packet_view{it->data(), it->size()});
+            }
+            packets.clear();
+        }
+    }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - start).count();
+    std::cout << "moldudp64 reorder, window " << window << ": " << us << " us, "
+              << processed << " messages processed" << std::endl;
+    if (processed != nr_messages || nr_requests) {
+        std::cerr << "error: reordered packets were not applied in order" << std::endl;
+        std::abort();
+    }
+}
+
+int main()
+{
+    uint32_t nr_messages = 2000000;
+
+    std::pair<double, size_t> scenarios[] = {
+        {0.0001, 1},
+        {0.001, 1},
+        {0.01, 1},
+        {0.001, 10},
+    };
+    for (auto&& scenario : scenarios) {
+        auto loss = scenario.first;
+        auto burst = scenario.second;
+        auto stats = test_recovery(nr_messages, loss, burst);
+        auto& r = stats.recovery_us;
+        std::sort(r.begin(), r.end());
+        double mean = 0;
+        for (auto us : r) {
+            mean += us;
+        }
+        mean = r.empty() ? 0 : mean / r.size();
+        double p99 = r.empty() ? 0 : r[std::min(r.size() - 1, r.size() * 99 / 100)];
+        std::cout << "loss " << loss * 100 << "% x " << burst << ": "
+                  << r.size() << " gaps, "
+                  << "recovery mean " << mean << " us, p99 " << p99 << " us, "
+                  << stats.retransmit.requests << " requests for "
+                  << stats.retransmit.requested_messages << " messages, "
+                  << stats.retransmit.responses << " responses, "
+                  << stats.retransmitted_messages << " messages retransmitted for "
+                  << stats.lost_messages << " lost, "
+                  << stats.unrecovered_messages << " unrecovered" << std::endl;
+    }
+    test_arbitration(nr_messages, 0.01);
+    test_poll();
+    test_reorder64(nr_messages, 2);
+    test_reorder64(nr_messages, 64);
+}
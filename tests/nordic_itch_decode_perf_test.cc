@@ -0,0 +1,71 @@
+#include <helix/nasdaq/nordic_itch_decode.hh>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <chrono>
+#include <random>
+
+using namespace helix::nasdaq;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+static std::vector<itch_add_order> make_messages(unsigned long count)
+{
+    std::mt19937_64 rng{42};
+    std::vector<itch_add_order> msgs(count);
+    for (auto&& m : msgs) {
+        char buf[sizeof(m) + 1];
+        snprintf(buf, sizeof(buf), "A%9lu%c%9lu%6lu%10lu",
+                 rng() % 1000000000UL, (rng() & 1) ? 'B' : 'S',
+                 rng() % 100000UL, rng() % 1000UL, rng() % 10000000000UL);
+        memcpy(&m, buf, sizeof(m));
+    }
+    return msgs;
+}
+
+auto test_uatoi(const std::vector<itch_add_order>& msgs, uint64_t& sum)
+{
+    auto start = clock_type::now();
+    for (auto&& m : msgs) {
+        sum += itch_uatoi(m.OrderReferenceNumber, sizeof(m.OrderReferenceNumber));
+        sum += itch_uatoi(m.Quantity, sizeof(m.Quantity));
+        sum += itch_uatoi(m.OrderBook, sizeof(m.OrderBook));
+        sum += itch_uatoi(m.Price, sizeof(m.Price));
+    }
+    auto end = clock_type::now();
+    return end - start;
+}
+
+auto test_decode(const std::vector<itch_add_order>& msgs, uint64_t& sum)
+{
+    auto start = clock_type::now();
+    for (auto&& m : msgs) {
+        uint64_t order_id, quantity;
+        itch_decode(m.OrderReferenceNumber, order_id, m.Quantity, quantity);
+        sum += order_id + quantity;
+        sum += itch_decode(m.OrderBook);
+        sum += itch_decode(m.Price);
+    }
+    auto end = clock_type::now();
+    return end - start;
+}
+
+int main()
+{
+    unsigned long count = 10000000;
+
+    auto msgs = make_messages(count);
+
+    uint64_t uatoi_sum = 0, decode_sum = 0;
+    auto uatoi_duration = test_uatoi(msgs, uatoi_sum);
+    auto decode_duration = test_decode(msgs, decode_sum);
+    if (uatoi_sum != decode_sum) {
+        std::cerr << "error: itch_decode() and itch_uatoi() disagree" << std::endl;
+        std::abort();
+    }
+
+    std::cout << "itch_uatoi()  " << std::chrono::duration_cast<std::chrono::nanoseconds>(uatoi_duration).count() / count << " ns/msg" << std::endl;
+    std::cout << "itch_decode() " << std::chrono::duration_cast<std::chrono::nanoseconds>(decode_duration).count() / count << " ns/msg" << std::endl;
+}
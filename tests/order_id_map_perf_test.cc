@@ -0,0 +1,115 @@
+#include <helix/incremental_map.hh>
+#include <helix/order_book.hh>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include <random>
+
+using namespace helix;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+static constexpr size_t nr_orders = 8000000;
+//! Number of orders that are live at a time in a day of churn.
+static constexpr size_t nr_live = 4096;
+
+// Order IDs of a day: increasing, with gaps of the orders of other books.
+static std::vector<uint64_t> make_order_ids()
+{
+    std::mt19937_64 rng{42};
+    std::vector<uint64_t> ids(nr_orders);
+    uint64_t id = 1;
+    for (auto&& i : ids) {
+        id += 1 + rng() % 16;
+        i = id;
+    }
+    return ids;
+}
+
+static void report(const char* name, std::vector<uint64_t>& latencies, clock_type::duration insert_duration, clock_type::duration find_duration)
+{
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) {
+        return latencies[std::min(latencies.size() - 1, size_t(p * latencies.size()))];
+    };
+    auto insert_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(insert_duration).count();
+    auto find_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(find_duration).count();
+    std::cout << name << "insert " << insert_ns / nr_orders << " ns/op, p50 " << pct(0.5) << " ns, p99 " << pct(0.99)
+              << " ns, p99.99 " << pct(0.9999) << " ns, max " << latencies.back() << " ns, find "
+              << find_ns / nr_orders << " ns/op" << std::endl;
+}
+
+// Grow a map from empty, the way an order ID map grows past its reserve
+// during a busy day, timing every insert.
+template<typename Map>
+void test_map(const char* name, const std::vector<uint64_t>& ids, order_book& ob)
+{
+    std::vector<uint64_t> latencies(ids.size());
+    Map map;
+    auto start = clock_type::now();
+    for (size_t i = 0; i < ids.size(); i++) {
+        auto t0 = clock_type::now();
+        map.insert({ids[i], ob});
+        latencies[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - t0).count();
+    }
+    auto insert_duration = clock_type::now() - start;
+
+    size_t found = 0;
+    start = clock_type::now();
+    for (auto&& id : ids) {
+        found += map.find(id) != map.end();
+    }
+    auto find_duration = clock_type::now() - start;
+    if (found != ids.size() || map.size() != ids.size()) {
+        std::cerr << "error: " << name << "lost orders" << std::endl;
+        std::abort();
+    }
+    report(name, latencies, insert_duration, find_duration);
+}
+
+// Add and remove orders the way a feed handler does, removing every order
+// through the iterator that found it once it leaves the book, and check
+// that the size of the map follows the orders that are live.
+template<typename Map>
+void test_churn(const char* name, const std::vector<uint64_t>& ids, order_book& ob)
+{
+    Map map;
+    auto start = clock_type::now();
+    for (size_t i = 0; i < ids.size(); i++) {
+        map.insert({ids[i], ob});
+        if (i >= nr_live) {
+            auto it = map.find(ids[i - nr_live]);
+            if (it == map.end()) {
+                std::cerr << "error: " << name << "lost orders" << std::endl;
+                std::abort();
+            }
+            map.erase(it);
+        }
+        if (map.size() != std::min(i + 1, nr_live)) {
+            std::cerr << "error: " << name << "size does not follow live orders" << std::endl;
+            std::abort();
+        }
+    }
+    auto duration = clock_type::now() - start;
+    for (size_t i = 0; i < ids.size(); i++) {
+        if ((map.find(ids[i]) != map.end()) != (i >= ids.size() - nr_live)) {
+            std::cerr << "error: " << name << "found a removed order" << std::endl;
+            std::abort();
+        }
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    std::cout << name << "churn " << ns / nr_orders << " ns/op, " << map.size() << " live" << std::endl;
+}
+
+int main()
+{
+    auto ids = make_order_ids();
+    order_book ob{"AAPL", 0};
+    test_map<std::unordered_map<uint64_t, order_book&>>("std::unordered_map ", ids, ob);
+    test_map<incremental_map<uint64_t, order_book&>>("incremental_map    ", ids, ob);
+    test_churn<std::unordered_map<uint64_t, order_book&>>("std::unordered_map ", ids, ob);
+    test_churn<incremental_map<uint64_t, order_book&>>("incremental_map    ", ids, ob);
+}
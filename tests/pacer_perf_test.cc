@@ -0,0 +1,120 @@
+#include <helix/nasdaq/itch50_handler.hh>
+#include <helix/nasdaq/binaryfile.hh>
+#include <helix/compat/endian.h>
+#include <helix/pacer.hh>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <chrono>
+
+using namespace helix;
+using namespace helix::nasdaq;
+
+using clock_type = std::chrono::steady_clock;
+
+static constexpr size_t nr_messages = 2000;
+//! Market time between messages.
+static constexpr uint64_t message_interval_ns = 100000;
+static constexpr uint64_t first_timestamp = 34200000000000ULL;
+
+static void check(bool ok, const char* name, const char* what)
+{
+    if (!ok) {
+        std::cerr << "error: " << name << what << std::endl;
+        std::abort();
+    }
+}
+
+static void report(const char* name, const pacing_stats& stats, clock_type::duration duration)
+{
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    std::cout << name << ms << " ms, " << stats.late << " late, error p50 " << stats.p50_ns
+              << " ns, p99 " << stats.p99_ns << " ns, p99.9 " << stats.p999_ns << " ns, max " << stats.max_ns << " ns" << std::endl;
+}
+
+// Check that the pacer released every message, no earlier than its time,
+// and that the percentiles of the pacing error are ordered and well within
+// the time between messages.
+static void check_stats(const char* name, const pacing_stats& stats, clock_type::duration duration, double speed)
+{
+    auto span = std::chrono::nanoseconds{uint64_t((nr_messages - 1) * message_interval_ns / speed)};
+    check(stats.releases == nr_messages, name, "released the wrong number of messages");
+    check(duration >= span, name, "released messages early");
+    check(stats.p50_ns <= stats.p90_ns && stats.p90_ns <= stats.p99_ns
+          && stats.p99_ns <= stats.p999_ns && stats.p999_ns <= stats.max_ns, name, "percentiles are out of order");
+    check(stats.p50_ns < message_interval_ns / speed, name, "median pacing error is too large");
+}
+
+static void test_pacer(const char* name, pacing_clock clock)
+{
+    pacing_config config;
+    config.speed = 1.0;
+    config.clock = clock;
+    pacer p;
+    p.configure(config);
+    auto start = clock_type::now();
+    for (size_t i = 0; i < nr_messages; i++) {
+        p.pace(first_timestamp + i * message_interval_ns);
+    }
+    auto duration = clock_type::now() - start;
+    auto stats = p.stats();
+    check_stats(name, stats, duration, config.speed);
+    report(name, stats, duration);
+}
+
+// Returns a BinaryFILE frame of a system event message at @timestamp.
+static std::vector<char> system_event_frame(uint64_t timestamp)
+{
+    itch50_system_event m;
+    std::memset(&m, 0, sizeof(m));
+    m.MessageType = 'S';
+    m.Timestamp = htobe64(timestamp) >> 16;
+    m.EventCode = 'Q';
+    std::vector<char> frame(sizeof(uint16_t) + sizeof(m));
+    uint16_t len = htobe16(sizeof(m));
+    std::memcpy(frame.data(), &len, sizeof(len));
+    std::memcpy(frame.data() + sizeof(len), &m, sizeof(m));
+    return frame;
+}
+
+// Pace an ITCH 5.0 replay at twice the speed of the market, and check that
+// a truncated message is rejected before it is paced.
+static void test_session(const char* name)
+{
+    pacing_config config;
+    config.speed = 2.0;
+    binaryfile_session<itch50_handler> s{nullptr};
+    s.register_callback([](const event&) { });
+    s.set_pacing_config(config);
+    auto start = clock_type::now();
+    for (size_t i = 0; i < nr_messages; i++) {
+        auto frame = system_event_frame(first_timestamp + i * message_interval_ns);
+        s.process_packet(net::packet_view{frame.data(), frame.size()});
+    }
+    auto duration = clock_type::now() - start;
+    auto stats = s.get_pacing_stats();
+    check_stats(name, stats, duration, config.speed);
+
+    auto frame = system_event_frame(first_timestamp + nr_messages * message_interval_ns);
+    uint16_t len = htobe16(sizeof(itch50_message));
+    std::memcpy(frame.data(), &len, sizeof(len));
+    bool truncated = false;
+    try {
+        s.process_packet(net::packet_view{frame.data(), sizeof(uint16_t) + sizeof(itch50_message)});
+    } catch (const truncated_packet_error&) {
+        truncated = true;
+    }
+    check(truncated, name, "accepted a truncated message");
+    check(s.get_pacing_stats().releases == nr_messages, name, "paced a truncated message");
+    report(name, stats, duration);
+}
+
+int main()
+{
+    test_pacer("pacer (monotonic)      ", pacing_clock::monotonic);
+#if defined(__x86_64__) || defined(__i386__)
+    test_pacer("pacer (tsc)            ", pacing_clock::tsc);
+#endif
+    test_session("itch50 session (2.0x)  ");
+}
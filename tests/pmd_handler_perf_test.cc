@@ -0,0 +1,116 @@
+#include <helix/parity/pmd_handler.hh>
+#include <helix/compat/endian.h>
+#include <helix/net.hh>
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <string>
+
+using namespace helix;
+using namespace helix::parity;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+static constexpr size_t nr_orders = 4000000;
+
+// Instruments on the feed, of which the first few are subscribed to.
+static const std::vector<std::string> instruments = {
+    "AAPL    ", "MSFT    ", "GOOG    ", "AMZN    ", "FB      ", "INTC    ", "CSCO    ", "ORCL    ",
+    "IBM     ", "NFLX    ", "TSLA    ", "NVDA    ", "AMD     ", "QCOM    ", "ADBE    ", "PYPL    ",
+};
+static constexpr size_t nr_subscribed = 4;
+
+template<typename T>
+static void append(std::vector<char>& buf, const T& m)
+{
+    auto* p = reinterpret_cast<const char*>(&m);
+    buf.insert(buf.end(), p, p + sizeof(m));
+}
+
+// Messages of a PMD feed: every order is added, partly executed or
+// canceled, and then deleted, with a few hundred orders live at a time.
+static std::vector<char> make_messages(std::vector<size_t>& offsets)
+{
+    std::mt19937_64 rng{42};
+    std::vector<char> buf;
+    auto add_offset = [&] { offsets.push_back(buf.size()); };
+    pmd_second s{};
+    s.MessageType = 'S';
+    s.Second = htobe32(34200);
+    add_offset();
+    append(buf, s);
+    constexpr uint64_t window = 256;
+    for (uint64_t i = 0; i < nr_orders + window; i++) {
+        if (i < nr_orders) {
+            pmd_order_added m{};
+            m.MessageType = 'A';
+            m.Timestamp = htobe32(i);
+            m.OrderNumber = htobe64(i + 1);
+            m.Side = rng() % 2 ? 'B' : 'S';
+            std::memcpy(m.Instrument, instruments[i % instruments.size()].data(), sizeof(m.Instrument));
+            m.Quantity = htobe32(100);
+            m.Price = htobe32(10000 + rng() % 100);
+            add_offset();
+            append(buf, m);
+        }
+        if (i < window) {
+            continue;
+        }
+        uint64_t order_number = i - window + 1;
+        if (rng() % 4 == 0) {
+            pmd_order_executed m{};
+            m.MessageType = 'E';
+            m.Timestamp = htobe32(i);
+            m.OrderNumber = htobe64(order_number);
+            m.Quantity = htobe32(10);
+            m.MatchNumber = htobe32(i);
+            add_offset();
+            append(buf, m);
+        } else if (rng() % 4 == 0) {
+            pmd_order_canceled m{};
+            m.MessageType = 'X';
+            m.Timestamp = htobe32(i);
+            m.OrderNumber = htobe64(order_number);
+            m.CanceledQuantity = htobe32(10);
+            add_offset();
+            append(buf, m);
+        }
+        pmd_order_deleted m{};
+        m.MessageType = 'D';
+        m.Timestamp = htobe32(i);
+        m.OrderNumber = htobe64(order_number);
+        add_offset();
+        append(buf, m);
+    }
+    offsets.push_back(buf.size());
+    return buf;
+}
+
+int main()
+{
+    std::vector<size_t> offsets;
+    auto buf = make_messages(offsets);
+    size_t nr_messages = offsets.size() - 1;
+
+    pmd_handler handler;
+    size_t nr_events = 0;
+    handler.register_callback([&nr_events](const event&) {
+        nr_events++;
+    });
+    for (size_t i = 0; i < nr_subscribed; i++) {
+        handler.subscribe(instruments[i].substr(0, instruments[i].find(' ')), 1024);
+    }
+
+    auto start = clock_type::now();
+    for (size_t i = 0; i < nr_messages; i++) {
+        net::packet_view packet{buf.data() + offsets[i], offsets[i + 1] - offsets[i]};
+        handler.process_packet(packet, true);
+    }
+    auto end = clock_type::now();
+
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    std::cout << "pmd_handler::process_packet() " << ns / nr_messages << " ns/msg, "
+              << nr_messages << " messages, " << nr_events << " events" << std::endl;
+}
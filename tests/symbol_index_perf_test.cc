@@ -0,0 +1,177 @@
+#include <helix/nasdaq/itch50_symbol_index.hh>
+#include <helix/nasdaq/itch50_handler.hh>
+#include <helix/nasdaq/binaryfile.hh>
+#include <helix/compat/endian.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+
+using namespace helix;
+using namespace helix::nasdaq;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+// Stocks in the file, how many of them are replayed, and how many add
+// order messages are spread uniformly over the stocks.
+static constexpr size_t nr_stocks = 4000;
+static constexpr size_t nr_subscribed = 4;
+static constexpr size_t nr_messages = 4000000;
+
+static std::string stock_symbol(size_t i)
+{
+    char symbol[32];
+    snprintf(symbol, sizeof(symbol), "S%05u", unsigned(i));
+    return symbol;
+}
+
+template<typename Message>
+static void write_frame(FILE* f, const Message& m)
+{
+    uint16_t len = htobe16(sizeof(m));
+    fwrite(&len, sizeof(len), 1, f);
+    fwrite(&m, sizeof(m), 1, f);
+}
+
+// Write a BinaryFILE with the directory of every stock followed by add
+// orders of randomly chosen stocks, so that the messages of a single stock
+// are spread thinly over the whole file.
+static void make_file(const char* filename)
+{
+    FILE* f = fopen(filename, "w");
+    if (!f) {
+        throw std::runtime_error(std::string{"unable to create "} + filename);
+    }
+    for (size_t i = 0; i < nr_stocks; i++) {
+        itch50_stock_directory m;
+        std::memset(&m, 0, sizeof(m));
+        m.MessageType = 'R';
+        m.StockLocate = htobe16(i + 1);
+        auto symbol = stock_symbol(i);
+        std::memset(m.Stock, ' ', sizeof(m.Stock));
+        std::memcpy(m.Stock, symbol.data(), symbol.size());
+        write_frame(f, m);
+    }
+    std::mt19937_64 rng{42};
+    for (size_t i = 0; i < nr_messages; i++) {
+        itch50_add_order m;
+        std::memset(&m, 0, sizeof(m));
+        m.MessageType = 'A';
+        m.StockLocate = htobe16(1 + rng() % nr_stocks);
+        m.Timestamp = htobe64(34200000000000ULL + i * 1000) >> 16;
+        m.OrderReferenceNumber = htobe64(i + 1);
+        m.BuySellIndicator = rng() % 2 ? 'B' : 'S';
+        m.Shares = htobe32(100);
+        m.Price = htobe32(10000 + rng() % 100);
+        write_frame(f, m);
+    }
+    uint16_t end_of_session = 0;
+    fwrite(&end_of_session, sizeof(end_of_session), 1, f);
+    fclose(f);
+}
+
+// Evict the file from the page cache so that every run reads it from disk.
+static void drop_cache(const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// Replay the subscribed stocks of the file, either by decoding every frame
+// or by reading only the frames in the runs of the symbol index, and
+// return the checksum of the events.
+static uint64_t replay(const char* filename, const std::vector<std::string>& symbols, const itch50_symbol_index* index)
+{
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    fstat(fd, &st);
+    auto* p = static_cast<const char*>(mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0));
+    uint64_t sum = 0;
+    binaryfile_session<itch50_handler> s{nullptr};
+    s.register_callback([&sum](const event& e) {
+        sum += e.get_timestamp();
+    });
+    for (auto&& symbol : symbols) {
+        s.subscribe(symbol, 2 * nr_messages / nr_stocks);
+    }
+    if (index) {
+        replay_runs(s, p, st.st_size, index->runs(symbols));
+    } else {
+        size_t offset = 0;
+        while (offset < size_t(st.st_size)) {
+            size_t nr = s.process_packet(net::packet_view{p + offset, st.st_size - offset});
+            if (!nr) {
+                break;
+            }
+            offset += nr;
+        }
+    }
+    munmap(const_cast<char*>(p), st.st_size);
+    close(fd);
+    return sum;
+}
+
+static void report(const char* name, clock_type::duration duration)
+{
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    std::cout << name << ms << " ms" << std::endl;
+}
+
+int main()
+{
+    char filename[] = "/tmp/helix-symbol-index-XXXXXX";
+    int fd = mkstemp(filename);
+    if (fd < 0) {
+        std::cerr << "error: unable to create a temporary file" << std::endl;
+        std::abort();
+    }
+    close(fd);
+    make_file(filename);
+
+    std::vector<std::string> symbols;
+    for (size_t i = 0; i < nr_subscribed; i++) {
+        symbols.push_back(stock_symbol(i * (nr_stocks / nr_subscribed)));
+    }
+
+    auto start = clock_type::now();
+    int in = open(filename, O_RDONLY);
+    struct stat st;
+    fstat(in, &st);
+    auto* p = static_cast<const char*>(mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, in, 0));
+    auto index = itch50_symbol_index::build(p, st.st_size);
+    munmap(const_cast<char*>(p), st.st_size);
+    close(in);
+    auto build_duration = clock_type::now() - start;
+
+    drop_cache(filename);
+    start = clock_type::now();
+    auto full_sum = replay(filename, symbols, nullptr);
+    auto full_duration = clock_type::now() - start;
+
+    drop_cache(filename);
+    start = clock_type::now();
+    auto sparse_sum = replay(filename, symbols, &index);
+    auto sparse_duration = clock_type::now() - start;
+
+    if (!full_sum || sparse_sum != full_sum) {
+        std::cerr << "error: sparse replay disagrees with full replay" << std::endl;
+        std::abort();
+    }
+    report("index build         ", build_duration);
+    report("full replay         ", full_duration);
+    report("sparse replay       ", sparse_duration);
+
+    unlink(filename);
+}
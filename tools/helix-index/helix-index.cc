@@ -0,0 +1,356 @@
+#include <helix-c/helix.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define __STDC_FORMAT_MACROS 1
+#include <inttypes.h>
+#include <getopt.h>
+#include <libgen.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+static const char *program;
+
+struct config {
+	std::vector<std::string> symbols;
+	size_t max_orders;
+	uint64_t interval;
+	bool symbol_index;
+	bool sizing_hints;
+	const char *proto;
+	const char *input;
+	const char *output;
+};
+
+/* File protocols that can be indexed and their timestamp units per second. */
+struct index_protocol {
+	const char *name;
+	uint64_t units_per_sec;
+};
+
+static struct index_protocol index_protocols[] = {
+	{"nasdaq-binaryfile-itch50",    1000000000},
+	{"nasdaq-nordic-soupfile-itch", 1000},
+	{NULL, 0},
+};
+
+/* Market time of the last event, which the checkpoints are taken at. */
+static uint64_t last_timestamp;
+
+static void process_event(helix_session_t session, helix_event_t event)
+{
+	uint64_t timestamp = helix_event_timestamp(event);
+	if (timestamp > last_timestamp) {
+		last_timestamp = timestamp;
+	}
+}
+
+static void usage(void)
+{
+	fprintf(stdout,
+		"usage: %s [options]\n"
+		"  options:\n"
+		"    -s, --symbol symbol            Ticker symbol to index.\n"
+		"    -m, --max-orders number        Maximum number of orders per symbol (for pre-allocation).\n"
+		"    -P, --proto proto              Market data protocol to read. Supported values:\n"
+		"              nasdaq-nordic-soupfile-itch\n"
+		"              nasdaq-binaryfile-itch50\n"
+		"    -n, --interval seconds         Market time between checkpoints (default: 60).\n"
+		"    -S, --symbol-index             Build a per-symbol message index of every symbol\n"
+		"                                   (nasdaq-binaryfile-itch50) instead of a replay index.\n"
+		"    -H, --sizing-hints             Measure the peak order book sizes of every symbol for helix-trace -H\n"
+		"                                   (nasdaq-binaryfile-itch50) instead of building a replay index.\n"
+		"    -i, --input filename           Input filename.\n"
+		"    -o, --output filename          Index filename (default: input filename with .idx, .sidx or .hints suffix).\n"
+		"    -h, --help                     display this help and exit\n",
+		program);
+	exit(1);
+}
+
+static struct option index_options[] = {
+	{"symbol",          required_argument, 0, 's'},
+	{"max-orders",      required_argument, 0, 'm'},
+	{"proto",           required_argument, 0, 'P'},
+	{"interval",        required_argument, 0, 'n'},
+	{"symbol-index",    no_argument,       0, 'S'},
+	{"sizing-hints",    no_argument,       0, 'H'},
+	{"input",           required_argument, 0, 'i'},
+	{"output",          required_argument, 0, 'o'},
+	{"help",            no_argument,       0, 'h'},
+	{0, 0, 0, 0}
+};
+
+static void parse_options(struct config *cfg, int argc, char *argv[])
+{
+	cfg->interval = 60;
+
+	for (;;) {
+		int opt_idx = 0;
+		int c;
+
+		c = getopt_long(argc, argv, "s:m:P:n:SHi:o:h", index_options, &opt_idx);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 's':
+			cfg->symbols.emplace_back(optarg);
+			break;
+		case 'm':
+			cfg->max_orders = strtol(optarg, NULL, 10);
+			break;
+		case 'P':
+			cfg->proto = optarg;
+			break;
+		case 'n':
+			cfg->interval = strtoull(optarg, NULL, 10);
+			break;
+		case 'S':
+			cfg->symbol_index = true;
+			break;
+		case 'H':
+			cfg->sizing_hints = true;
+			break;
+		case 'i':
+			cfg->input = optarg;
+			break;
+		case 'o':
+			cfg->output = optarg;
+			break;
+		case 'h':
+			usage();
+		default:
+			usage();
+		}
+	}
+}
+
+static void *map_input(const char *filename, struct stat *st)
+{
+	void *p;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "error: %s: %s\n", filename, strerror(errno));
+		exit(1);
+	}
+	if (fstat(fd, st) < 0) {
+		fprintf(stderr, "error: %s: %s\n", filename, strerror(errno));
+		exit(1);
+	}
+	p = mmap(NULL, st->st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		fprintf(stderr, "error: %s: %s\n", filename, strerror(errno));
+		exit(1);
+	}
+	close(fd);
+	return p;
+}
+
+static void build_symbol_index(struct config *cfg)
+{
+	struct stat input_st;
+	std::string output;
+	void *input_mmap;
+	int err;
+
+	if (strcmp(cfg->proto, "nasdaq-binaryfile-itch50")) {
+		fprintf(stderr, "error: protocol '%s' does not support per-symbol indexes\n", cfg->proto);
+		exit(1);
+	}
+
+	output = cfg->output ? cfg->output : std::string(cfg->input) + ".sidx";
+
+	input_mmap = map_input(cfg->input, &input_st);
+
+	/* The whole file is read once, front to back. */
+	madvise(input_mmap, input_st.st_size, MADV_SEQUENTIAL);
+
+	err = helix_symbol_index_build(output.c_str(), reinterpret_cast<const char*>(input_mmap), input_st.st_size);
+	if (err) {
+		fprintf(stderr, "error: %s: %s\n", output.c_str(), helix_strerror(err));
+		exit(1);
+	}
+
+	if (munmap(input_mmap, input_st.st_size) < 0) {
+		fprintf(stderr, "error: %s: %s\n", cfg->input, strerror(errno));
+		exit(1);
+	}
+
+	fprintf(stderr, "index: %s\n", output.c_str());
+}
+
+static void build_sizing_hints(struct config *cfg)
+{
+	struct stat input_st;
+	std::string output;
+	void *input_mmap;
+	int err;
+
+	if (strcmp(cfg->proto, "nasdaq-binaryfile-itch50")) {
+		fprintf(stderr, "error: protocol '%s' does not support sizing hints\n", cfg->proto);
+		exit(1);
+	}
+
+	output = cfg->output ? cfg->output : std::string(cfg->input) + ".hints";
+
+	input_mmap = map_input(cfg->input, &input_st);
+
+	madvise(input_mmap, input_st.st_size, MADV_SEQUENTIAL);
+
+	err = helix_sizing_hints_build(output.c_str(), reinterpret_cast<const char*>(input_mmap), input_st.st_size);
+	if (err) {
+		fprintf(stderr, "error: %s: %s\n", output.c_str(), helix_strerror(err));
+		exit(1);
+	}
+
+	if (munmap(input_mmap, input_st.st_size) < 0) {
+		fprintf(stderr, "error: %s: %s\n", cfg->input, strerror(errno));
+		exit(1);
+	}
+
+	fprintf(stderr, "sizing hints: %s\n", output.c_str());
+}
+
+int main(int argc, char *argv[])
+{
+	struct index_protocol *iproto;
+	helix_index_writer_t writer;
+	helix_session_t session;
+	helix_protocol_t proto;
+	struct config cfg = {};
+	struct stat input_st;
+	std::string output;
+	void *input_mmap;
+	int err;
+
+	program = basename(argv[0]);
+
+	parse_options(&cfg, argc, argv);
+
+	if (cfg.symbols.empty() && !cfg.symbol_index && !cfg.sizing_hints) {
+		fprintf(stderr, "error: no symbols are specified. Use the '-s' option to specify them.\n");
+		exit(1);
+	}
+
+	if (!cfg.proto) {
+		fprintf(stderr, "error: protocol is not specified. Use the '-P' option to specify it.\n");
+		exit(1);
+	}
+
+	if (!cfg.input) {
+		fprintf(stderr, "error: no input file specified. Use the '-i' option to specify it.\n");
+		exit(1);
+	}
+
+	if (!cfg.interval) {
+		fprintf(stderr, "error: checkpoint interval must be positive\n");
+		exit(1);
+	}
+
+	if (cfg.symbol_index) {
+		build_symbol_index(&cfg);
+		return 0;
+	}
+
+	if (cfg.sizing_hints) {
+		build_sizing_hints(&cfg);
+		return 0;
+	}
+
+	for (iproto = index_protocols; iproto->name; iproto++) {
+		if (!strcmp(iproto->name, cfg.proto))
+			break;
+	}
+	if (!iproto->name) {
+		fprintf(stderr, "error: protocol '%s' cannot be indexed\n", cfg.proto);
+		exit(1);
+	}
+
+	proto = helix_protocol_lookup(cfg.proto);
+	if (!proto) {
+		fprintf(stderr, "error: protocol '%s' is not supported\n", cfg.proto);
+		exit(1);
+	}
+
+	session = helix_session_create(proto, process_event, NULL);
+	if (!session) {
+		fprintf(stderr, "error: unable to create new session\n");
+		exit(1);
+	}
+
+	for (auto&& symbol : cfg.symbols) {
+		err = helix_session_subscribe(session, symbol.c_str(), cfg.max_orders);
+		if (err) {
+			fprintf(stderr, "error: symbol '%s': %s\n", symbol.c_str(), helix_strerror(err));
+			exit(1);
+		}
+	}
+
+	output = cfg.output ? cfg.output : std::string(cfg.input) + ".idx";
+
+	writer = helix_index_writer_create(output.c_str());
+	if (!writer) {
+		fprintf(stderr, "error: %s: unable to create index\n", output.c_str());
+		exit(1);
+	}
+
+	input_mmap = map_input(cfg.input, &input_st);
+
+	/*
+	 * Checkpoints are taken between packets, after the first packet whose
+	 * events cross an interval boundary of market time.
+	 */
+	uint64_t interval = cfg.interval * iproto->units_per_sec;
+	uint64_t next_checkpoint = 0;
+	uint64_t nr_checkpoints = 0;
+	const char *p = reinterpret_cast<const char*>(input_mmap);
+	size_t size = input_st.st_size;
+	while (size > 0) {
+		int nr;
+
+		nr = helix_session_process_packet(session, p, size);
+		if (!nr)
+			break;
+		if (nr < 0) {
+			fprintf(stderr, "error: %s: %s\n", cfg.input, helix_strerror(nr));
+			exit(1);
+		}
+		p += nr;
+		size -= nr;
+
+		if (last_timestamp && last_timestamp >= next_checkpoint) {
+			if (next_checkpoint) {
+				err = helix_index_writer_add(writer, session, last_timestamp);
+				if (err) {
+					fprintf(stderr, "error: %s: %s\n", output.c_str(), helix_strerror(err));
+					exit(1);
+				}
+				nr_checkpoints++;
+			}
+			next_checkpoint = (last_timestamp / interval + 1) * interval;
+		}
+	}
+
+	err = helix_index_writer_close(writer);
+	if (err) {
+		fprintf(stderr, "error: %s: %s\n", output.c_str(), helix_strerror(err));
+		exit(1);
+	}
+
+	helix_session_destroy(session);
+
+	if (munmap(input_mmap, input_st.st_size) < 0) {
+		fprintf(stderr, "error: %s: %s\n", cfg.input, strerror(errno));
+		exit(1);
+	}
+
+	fprintf(stderr, "checkpoints: %" PRIu64 ", index: %s\n", nr_checkpoints, output.c_str());
+}
@@ -185,7 +185,11 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
-	helix_session_subscribe(session, cfg.symbol, cfg.max_orders);
+	err = helix_session_subscribe(session, cfg.symbol, cfg.max_orders);
+	if (err) {
+		fprintf(stderr, "error: symbol '%s': %s\n", cfg.symbol, helix_strerror(err));
+		exit(1);
+	}
 
 	err = uv_udp_init(uv_default_loop(), &socket);
 	if (err) {
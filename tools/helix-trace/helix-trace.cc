@@ -1,5 +1,7 @@
 #include <helix-c/helix.h>
+#include <helix/spsc_ring.hh>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #define __STDC_FORMAT_MACROS 1
 #include <inttypes.h>
 #include <stdbool.h>
@@ -10,25 +12,41 @@
 #include <errno.h>
 #include <stdio.h>
 #include <math.h>
+#include <signal.h>
+#include <time.h>
 #include <uv.h>
 
 #include <stdexcept>
+#include <algorithm>
 #include <string>
+#include <unordered_map>
 #include <vector>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <mutex>
 
 static const char *program;
 
 FILE* output;
 bool flush;
 
-size_t max_price_levels	= 0;
-size_t max_order_count	= 0;
-uint64_t quotes			= 0;
-uint64_t trades			= 0;
-uint64_t volume_shs		= 0;
-double volume_ccy		= 0.0;
-double high				= -INFINITY;
-double low				= +INFINITY;
+/* Serializes event processing when the session runs on multiple threads. */
+std::mutex event_lock;
+bool parallel;
+
+/* Events before this timestamp are not traced when seeking with an index. */
+uint64_t seek_timestamp;
+
+/* Capture that received packets are recorded to, if any. */
+helix_capture_t capture;
+
+/* Only statistics are gathered and printed, no events are traced. */
+bool stats_only;
+
+/* Every symbol is traced to an output file of its own. */
+bool split_output;
 
 struct socket_address {
 	std::string addr;
@@ -43,6 +61,7 @@ struct socket_address {
 struct config {
 	std::vector<std::string> symbols;
 	size_t max_orders;
+	size_t threads;
 	const char *proto;
 	const char *multicast_addr;
 	int multicast_port;
@@ -50,20 +69,98 @@ struct config {
 	const char *format;
 	const char *input;
 	const char *output;
+	const char *load_checkpoint;
+	const char *save_checkpoint;
+	const char *index;
+	const char *symbol_index;
+	const char *record;
+	const char *batch;
+	const char *sizing_hints;
+	size_t max_sessions;
+	helix_read_mode_t read_mode;
+	bool capture_time;
+	double pace;
+	helix_pacing_clock_t pace_clock;
+	bool pace_packets;
+	uint64_t seek;
 };
 
+/*
+ * Statistics and trace state of a symbol. Symbols are numbered in the order
+ * they are specified, and the number indexes the symbol table of a session.
+ */
+struct symbol_stats {
+	std::string	symbol;
+	size_t		max_price_levels = 0;
+	size_t		max_order_count = 0;
+	uint64_t	quotes = 0;
+	uint64_t	trades = 0;
+	uint64_t	volume_shs = 0;
+	double		volume_ccy = 0.0;
+	double		high = -INFINITY;
+	double		low = +INFINITY;
+	/* Top of the order book when it was last traced. */
+	uint64_t	bid_price = 0;
+	uint64_t	bid_size = 0;
+	uint64_t	ask_price = UINT64_MAX;
+	uint64_t	ask_size = 0;
+};
+
+std::unordered_map<std::string, uint32_t> symbol_ids;
+
 struct trace_session {
        socket_address addr;
        uv_udp_t request_socket;
-       uint64_t	bid_price = 0;
-       uint64_t	bid_size  = 0;
-       uint64_t	ask_price = UINT64_MAX;
-       uint64_t	ask_size  = 0;
+       std::vector<symbol_stats> symbols;
+       /* Symbol ids of the order books that events were seen for. */
+       std::unordered_map<helix_order_book_t, uint32_t> book_ids;
+       /* Symbol of the first event that was not subscribed to, if any. */
+       std::string unknown_symbol;
 };
 
+/*
+ * Event that the formats print, copied out of the session by the event
+ * callback so that it can be formatted on another thread.
+ */
+struct trace_record {
+	char		symbol[24];
+	uint64_t	timestamp;
+	uint64_t	bid_price;
+	uint64_t	bid_size;
+	uint64_t	ask_price;
+	uint64_t	ask_size;
+	uint64_t	trade_price;
+	uint64_t	trade_size;
+	double		vwap;
+	uint32_t	symbol_id;
+	uint32_t	mask;
+	char		trade_sign;
+};
+
+/* Longest formatted record. */
+#define MAX_RECORD_LEN		512
+
+/* Number of records between the event callback and the formatter thread. */
+#define RECORD_RING_SIZE	(64 * 1024)
+
+/* Number of records that the formatter thread formats at a time. */
+#define RECORD_BATCH_SIZE	1024
+
+/* Time that the formatter thread sleeps when there are no records. */
+#define FORMATTER_POLL_US	100
+
+/* Interval of retransmission timeout checks while the feed is quiet. */
+#define RETRANSMIT_POLL_MS	1
+
 struct trace_fmt_ops {
-	void (*fmt_header)(void);
-	void (*fmt_event)(helix_session_t session, helix_event_t event);
+	/* Format the header into @buf, returns its length. */
+	size_t (*fmt_header)(char *buf);
+	/* Format a record into @buf, which has room for MAX_RECORD_LEN bytes, returns its length. */
+	size_t (*fmt_record)(const trace_record *rec, char *buf);
+	/* Format the header of the statistics of symbols into @buf, returns its length. */
+	size_t (*fmt_stats_header)(char *buf);
+	/* Format the statistics of a symbol into @buf, which has room for MAX_RECORD_LEN bytes, returns its length. */
+	size_t (*fmt_stats)(const symbol_stats *stats, char *buf);
 };
 
 socket_address parse_socket_address(std::string raw_addr)
@@ -100,14 +197,13 @@ const char trade_sign(helix_trade_sign_t sign)
 	}
 }
 
-static bool is_order_book_changed(helix_session_t session, helix_event_t event)
+static bool is_order_book_changed(const symbol_stats *stats, helix_event_t event)
 {
 	auto event_mask = helix_event_mask(event);
 	if (event_mask & HELIX_EVENT_TRADE) {
 		return true;
 	}
 	if (event_mask & HELIX_EVENT_ORDER_BOOK_UPDATE) {
-		auto* ts = reinterpret_cast<trace_session*>(helix_session_data(session));
 		auto ob = helix_event_order_book(event);
 		auto bid_price = helix_order_book_bid_price(ob, 0);
 		auto bid_size = helix_order_book_bid_size(ob, 0);
@@ -116,222 +212,916 @@ static bool is_order_book_changed(helix_session_t session, helix_event_t event)
 		if (!bid_price || !ask_size) {
 			return false;
 		}
-		return bid_price != ts->bid_price || bid_size != ts->bid_size || ask_price != ts->ask_price || ask_size != ts->ask_size;
+		return bid_price != stats->bid_price || bid_size != stats->bid_size || ask_price != stats->ask_price || ask_size != stats->ask_size;
 	}
 	return false;
 }
 
-static void fmt_pretty_header(void)
+static size_t fmt_pretty_header(char *buf)
 {
+	return 0;
 }
 
-static void fmt_pretty_event(helix_session_t session, helix_event_t event)
+static size_t fmt_pretty_record(const trace_record *rec, char *buf)
 {
-	auto* ts = reinterpret_cast<trace_session*>(helix_session_data(session));
-	auto timestamp = helix_event_timestamp(event);
-	if (!helix_session_is_rth_timestamp(session, timestamp) || !is_order_book_changed(session, event)) {
-		return;
-	}
-	uint64_t timestamp_in_sec = timestamp / 1000;
+	char *p = buf;
+	uint64_t timestamp_in_sec = rec->timestamp / 1000;
 	uint64_t hours   = timestamp_in_sec / 60 / 60;
 	uint64_t minutes = (timestamp_in_sec - (hours * 60 * 60)) / 60;
 	uint64_t seconds = (timestamp_in_sec - (hours * 60 * 60) - (minutes * 60));
-	uint64_t milliseconds = timestamp % 1000;
-	fprintf(output, "%s | %02" PRIu64":%02" PRIu64":%02" PRIu64".%03" PRIu64 " |",
-		helix_event_symbol(event),
+	uint64_t milliseconds = rec->timestamp % 1000;
+	p += sprintf(p, "%s | %02" PRIu64":%02" PRIu64":%02" PRIu64".%03" PRIu64 " |",
+		rec->symbol,
 		hours, minutes, seconds, milliseconds);
-	auto event_mask = helix_event_mask(event);
-	if (event_mask & HELIX_EVENT_ORDER_BOOK_UPDATE) {
-		auto ob = helix_event_order_book(event);
-
-		auto bid_price = helix_order_book_bid_price(ob, 0);
-		auto bid_size = helix_order_book_bid_size(ob, 0);
-		auto ask_price = helix_order_book_ask_price(ob, 0);
-		auto ask_size = helix_order_book_ask_size(ob, 0);
-
-		fprintf(output, "%6" PRIu64"  %6.3f  %6.3f  %-6" PRIu64" |",
-			bid_size,
-			(double)bid_price/10000.0,
-			(double)ask_price/10000.0,
-			ask_size
+	if (rec->mask & HELIX_EVENT_ORDER_BOOK_UPDATE) {
+		p += sprintf(p, "%6" PRIu64"  %6.3f  %6.3f  %-6" PRIu64" |",
+			rec->bid_size,
+			(double)rec->bid_price/10000.0,
+			(double)rec->ask_price/10000.0,
+			rec->ask_size
 			);
-
-		ts->bid_price = bid_price;
-		ts->bid_size = bid_size;
-		ts->ask_price = ask_price;
-		ts->ask_size = ask_size;
 	} else {
-		fprintf(output, "                               |");
+		p += sprintf(p, "                               |");
 	}
-	if (event_mask & HELIX_EVENT_TRADE) {
-		auto trade = helix_event_trade(event);
-		fprintf(output, " %6.3f %6" PRIu64 " | %c | %6.3f |",
-			helix_trade_price(trade)/10000.0,
-			helix_trade_size(trade),
-			trade_sign(helix_trade_sign(trade)),
-			volume_ccy / (double)volume_shs
+	if (rec->mask & HELIX_EVENT_TRADE) {
+		p += sprintf(p, " %6.3f %6" PRIu64 " | %c | %6.3f |",
+			rec->trade_price/10000.0,
+			rec->trade_size,
+			rec->trade_sign,
+			rec->vwap
 			);
 	} else {
-		fprintf(output, "               |   |        |");
+		p += sprintf(p, "               |   |        |");
 	}
-	std::string sweep_event;
-	if (event_mask & HELIX_EVENT_SWEEP) {
-		sweep_event = " Y |";
+	if (rec->mask & HELIX_EVENT_SWEEP) {
+		p += sprintf(p, " Y |");
 	} else {
-		sweep_event = "   |";
-        }
-	fprintf(output, "%s", sweep_event.c_str());
-	fprintf(output, "\n");
-	if (flush) {
-		fflush(output);
+		p += sprintf(p, "   |");
 	}
+	*p++ = '\n';
+	return p - buf;
 }
 
-struct trace_fmt_ops fmt_pretty_ops = {
-	.fmt_header	= fmt_pretty_header,
-	.fmt_event	= fmt_pretty_event,
-};
+static double stats_vwap(const symbol_stats *stats)
+{
+	return stats->volume_ccy / (double)stats->volume_shs;
+}
 
-static void fmt_csv_header(void)
+static size_t fmt_pretty_stats_header(char *buf)
 {
-	fprintf(output, "Symbol,Timestamp,BidPrice,BidSize,AskPrice,AskSize,LastPrice,LastSize,LastSign,VWAP,SweepEvent\n");
-	if (flush) fflush(output);
+	return sprintf(buf, "%-8s | %10s | %9s | %12s | %16s | %8s | %8s | %8s | %6s | %8s |\n",
+		"Symbol", "Quotes", "Trades", "Volume", "Notional", "VWAP", "High", "Low", "Levels", "Orders");
 }
 
-static void fmt_csv_event(helix_session_t session, helix_event_t event)
+static size_t fmt_pretty_stats(const symbol_stats *stats, char *buf)
 {
-	auto* ts = reinterpret_cast<trace_session*>(helix_session_data(session));
-	auto timestamp = helix_event_timestamp(event);
-	if (!helix_session_is_rth_timestamp(session, timestamp) || !is_order_book_changed(session, event)) {
-		return;
+	char *p = buf;
+	p += sprintf(p, "%-8s | %10" PRIu64 " | %9" PRIu64 " | %12" PRIu64 " | %16.4f |",
+		stats->symbol.c_str(),
+		stats->quotes,
+		stats->trades,
+		stats->volume_shs,
+		stats->volume_ccy
+		);
+	if (stats->trades) {
+		p += sprintf(p, " %8.3f | %8.3f | %8.3f |", stats_vwap(stats), stats->high, stats->low);
+	} else {
+		p += sprintf(p, "          |          |          |");
 	}
-	auto symbol = helix_event_symbol(event);
-	fprintf(output, "%s,%" PRIu64 ",", symbol, timestamp);
-	auto event_mask = helix_event_mask(event);
-	if (event_mask & HELIX_EVENT_ORDER_BOOK_UPDATE) {
-		auto ob = helix_event_order_book(event);
+	p += sprintf(p, " %6zu | %8zu |\n", stats->max_price_levels, stats->max_order_count);
+	return p - buf;
+}
 
-		auto bid_price = helix_order_book_bid_price(ob, 0);
-		auto bid_size = helix_order_book_bid_size(ob, 0);
-		auto ask_price = helix_order_book_ask_price(ob, 0);
-		auto ask_size = helix_order_book_ask_size(ob, 0);
+struct trace_fmt_ops fmt_pretty_ops = {
+	.fmt_header		= fmt_pretty_header,
+	.fmt_record		= fmt_pretty_record,
+	.fmt_stats_header	= fmt_pretty_stats_header,
+	.fmt_stats		= fmt_pretty_stats,
+};
 
-		fprintf(output, "%f,%" PRIu64",%f,%" PRIu64",",
-			(double)bid_price/10000.0,
-			bid_size,
-			(double)ask_price/10000.0,
-			ask_size
-			);
+static size_t fmt_csv_header(char *buf)
+{
+	return sprintf(buf, "Symbol,Timestamp,BidPrice,BidSize,AskPrice,AskSize,LastPrice,LastSize,LastSign,VWAP,SweepEvent\n");
+}
 
-		ts->bid_price = bid_price;
-		ts->bid_size = bid_size;
-		ts->ask_price = ask_price;
-		ts->ask_size = ask_size;
+static size_t fmt_csv_record(const trace_record *rec, char *buf)
+{
+	char *p = buf;
+	p += sprintf(p, "%s,%" PRIu64 ",", rec->symbol, rec->timestamp);
+	if (rec->mask & HELIX_EVENT_ORDER_BOOK_UPDATE) {
+		p += sprintf(p, "%f,%" PRIu64",%f,%" PRIu64",",
+			(double)rec->bid_price/10000.0,
+			rec->bid_size,
+			(double)rec->ask_price/10000.0,
+			rec->ask_size
+			);
 	} else {
-		fprintf(output, ",,,,");
+		p += sprintf(p, ",,,,");
 	}
-	if (event_mask & HELIX_EVENT_TRADE) {
-		auto trade = helix_event_trade(event);
-		fprintf(output, "%f,%" PRIu64 ",%c,%f,",
-			helix_trade_price(trade)/10000.0,
-			helix_trade_size(trade),
-			trade_sign(helix_trade_sign(trade)),
-			volume_ccy / (double)volume_shs
+	if (rec->mask & HELIX_EVENT_TRADE) {
+		p += sprintf(p, "%f,%" PRIu64 ",%c,%f,",
+			rec->trade_price/10000.0,
+			rec->trade_size,
+			rec->trade_sign,
+			rec->vwap
 			);
 	} else {
-		fprintf(output, ",,,,");
+		p += sprintf(p, ",,,,");
 	}
-	std::string sweep_event;
-	if (event_mask & HELIX_EVENT_SWEEP) {
-		sweep_event = "Y";
+	if (rec->mask & HELIX_EVENT_SWEEP) {
+		*p++ = 'Y';
 	}
-	fprintf(output, "%s", sweep_event.c_str());
-	fprintf(output, "\n");
-	if (flush) {
-		fflush(output);
+	*p++ = '\n';
+	return p - buf;
+}
+
+static size_t fmt_csv_stats_header(char *buf)
+{
+	return sprintf(buf, "Symbol,Quotes,Trades,Volume,Notional,VWAP,High,Low,MaxLevels,MaxOrders\n");
+}
+
+static size_t fmt_csv_stats(const symbol_stats *stats, char *buf)
+{
+	char *p = buf;
+	p += sprintf(p, "%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%f,",
+		stats->symbol.c_str(),
+		stats->quotes,
+		stats->trades,
+		stats->volume_shs,
+		stats->volume_ccy
+		);
+	if (stats->trades) {
+		p += sprintf(p, "%f,%f,%f,", stats_vwap(stats), stats->high, stats->low);
+	} else {
+		p += sprintf(p, ",,,");
 	}
+	p += sprintf(p, "%zu,%zu\n", stats->max_price_levels, stats->max_order_count);
+	return p - buf;
 }
 
 struct trace_fmt_ops fmt_csv_ops = {
-	.fmt_header	= fmt_csv_header,
-	.fmt_event	= fmt_csv_event,
+	.fmt_header		= fmt_csv_header,
+	.fmt_record		= fmt_csv_record,
+	.fmt_stats_header	= fmt_csv_stats_header,
+	.fmt_stats		= fmt_csv_stats,
+};
+
+/*
+ * Columns of the binary format. Prices are in units of 1/10000, and fields
+ * that an event does not have, as told by its event mask, are zero.
+ */
+enum {
+	COL_SYMBOL,
+	COL_TIMESTAMP,
+	COL_BID_PRICE,
+	COL_BID_SIZE,
+	COL_ASK_PRICE,
+	COL_ASK_SIZE,
+	COL_LAST_PRICE,
+	COL_LAST_SIZE,
+	COL_LAST_SIGN,
+	COL_VWAP,
+	COL_EVENT,
+	NR_COLUMNS,
+};
+
+static const helix_column_t binary_columns[NR_COLUMNS] = {
+	{"Symbol",    4, 1},
+	{"Timestamp", 8, 1},
+	{"BidPrice",  8, 10000},
+	{"BidSize",   8, 1},
+	{"AskPrice",  8, 10000},
+	{"AskSize",   8, 1},
+	{"LastPrice", 8, 10000},
+	{"LastSize",  8, 1},
+	{"LastSign",  1, 1},
+	{"VWAP",      8, 10000},
+	{"Event",     1, 1},
+};
+
+helix_column_writer_t column_writer;
+
+static size_t fmt_binary_header(char *buf)
+{
+	return 0;
+}
+
+/* The binary format is written by the column writer, not to the output buffers. */
+static size_t fmt_binary_record(const trace_record *rec, char *buf)
+{
+	uint64_t row[NR_COLUMNS] = {};
+	row[COL_SYMBOL] = helix_column_writer_intern(column_writer, rec->symbol);
+	row[COL_TIMESTAMP] = rec->timestamp;
+	row[COL_EVENT] = rec->mask;
+	if (rec->mask & HELIX_EVENT_ORDER_BOOK_UPDATE) {
+		row[COL_BID_PRICE] = rec->bid_price;
+		row[COL_BID_SIZE] = rec->bid_size;
+		row[COL_ASK_PRICE] = rec->ask_price;
+		row[COL_ASK_SIZE] = rec->ask_size;
+	}
+	if (rec->mask & HELIX_EVENT_TRADE) {
+		row[COL_LAST_PRICE] = rec->trade_price;
+		row[COL_LAST_SIZE] = rec->trade_size;
+		row[COL_LAST_SIGN] = rec->trade_sign;
+		row[COL_VWAP] = llround(rec->vwap * 10000.0);
+	}
+	helix_column_writer_append(column_writer, row);
+	return 0;
+}
+
+/* Statistics are not written in the binary format. */
+struct trace_fmt_ops fmt_binary_ops = {
+	.fmt_header		= fmt_binary_header,
+	.fmt_record		= fmt_binary_record,
+	.fmt_stats_header	= NULL,
+	.fmt_stats		= NULL,
 };
 
 struct trace_fmt_ops *fmt_ops;
 
-static void process_ob_event(helix_session_t session, helix_order_book_t ob, helix_event_mask_t event_mask)
+/*
+ * Formatted output is collected in buffers that are written out together
+ * with writev() when they are all full, or whenever the formatter runs out
+ * of records if the output is flushed. When output is split by symbol, the
+ * file of every symbol gets a buffer of its own.
+ */
+#define OUTPUT_BUFFER_SIZE	(64 * 1024)
+#define NR_OUTPUT_BUFFERS	16
+#define NR_SYMBOL_OUTPUT_BUFFERS	1
+
+struct output_buffer {
+	char data[OUTPUT_BUFFER_SIZE];
+	size_t len;
+};
+
+struct output_stream {
+	FILE *file;
+	std::unique_ptr<output_buffer[]> buffers;
+	size_t nr_buffers;
+	size_t current;
+};
+
+static output_stream main_output;
+/* Output file of every symbol when output is split by symbol. */
+static std::vector<output_stream *> symbol_outputs;
+uint64_t output_records;
+uint64_t output_bytes;
+
+static void output_init(struct output_stream *out, FILE *file, size_t nr_buffers)
+{
+	out->file = file;
+	out->buffers.reset(new output_buffer[nr_buffers]);
+	for (size_t i = 0; i < nr_buffers; i++) {
+		out->buffers[i].len = 0;
+	}
+	out->nr_buffers = nr_buffers;
+	out->current = 0;
+}
+
+static void output_flush(struct output_stream *out)
+{
+	struct iovec iov[NR_OUTPUT_BUFFERS];
+	size_t count = 0;
+	for (size_t i = 0; i <= out->current && i < out->nr_buffers; i++) {
+		if (out->buffers[i].len) {
+			iov[count].iov_base = out->buffers[i].data;
+			iov[count].iov_len = out->buffers[i].len;
+			count++;
+		}
+		out->buffers[i].len = 0;
+	}
+	out->current = 0;
+	struct iovec *next = iov;
+	while (count) {
+		ssize_t nr = writev(fileno(out->file), next, count);
+		if (nr < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "error: %s\n", strerror(errno));
+			/* The formatter thread cannot join itself, and nothing more can be written. */
+			_exit(1);
+		}
+		while (count && (size_t)nr >= next->iov_len) {
+			nr -= next->iov_len;
+			next++;
+			count--;
+		}
+		if (count) {
+			next->iov_base = (char *)next->iov_base + nr;
+			next->iov_len -= nr;
+		}
+	}
+}
+
+static void output_flush_all(void)
+{
+	if (split_output) {
+		for (auto* out : symbol_outputs) {
+			output_flush(out);
+		}
+	} else {
+		output_flush(&main_output);
+	}
+}
+
+/* Returns room for a formatted record in the buffers of @out. */
+static struct output_buffer *output_reserve(struct output_stream *out)
+{
+	if (OUTPUT_BUFFER_SIZE - out->buffers[out->current].len < MAX_RECORD_LEN) {
+		if (++out->current == out->nr_buffers) {
+			output_flush(out);
+		}
+	}
+	return &out->buffers[out->current];
+}
+
+static void output_header(struct output_stream *out)
+{
+	struct output_buffer *buf = output_reserve(out);
+	size_t len = fmt_ops->fmt_header(buf->data + buf->len);
+	buf->len += len;
+	output_bytes += len;
+}
+
+static void output_record(const trace_record *rec)
+{
+	struct output_stream *out = split_output ? symbol_outputs[rec->symbol_id] : &main_output;
+	struct output_buffer *buf = output_reserve(out);
+	size_t len = fmt_ops->fmt_record(rec, buf->data + buf->len);
+	buf->len += len;
+	output_bytes += len;
+	output_records++;
+}
+
+/* Write the statistics of every symbol as the output. */
+static void output_stats(const std::vector<symbol_stats>& symbols)
+{
+	struct output_buffer *buf = output_reserve(&main_output);
+	buf->len += fmt_ops->fmt_stats_header(buf->data + buf->len);
+	for (auto&& stats : symbols) {
+		buf = output_reserve(&main_output);
+		buf->len += fmt_ops->fmt_stats(&stats, buf->data + buf->len);
+	}
+	output_flush(&main_output);
+}
+
+/*
+ * Unless output is formatted inline, the event callback copies records into
+ * a ring, from which a formatter thread formats them, so that formatting and
+ * writing never hold up the session.
+ */
+bool format_inline;
+std::unique_ptr<helix::spsc_ring<trace_record>> record_ring;
+std::atomic<bool> formatter_stop;
+std::thread formatter;
+trace_record inline_record;
+
+static void run_formatter(void)
+{
+	for (;;) {
+		/* Every record published before the stop flag is visible once the flag is. */
+		bool stop = formatter_stop.load(std::memory_order_acquire);
+		size_t count = record_ring->consume([](trace_record& rec) {
+			output_record(&rec);
+		}, RECORD_BATCH_SIZE);
+		if (count) {
+			continue;
+		}
+		if (stop) {
+			break;
+		}
+		if (flush) {
+			output_flush_all();
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(FORMATTER_POLL_US));
+	}
+	output_flush_all();
+}
+
+/* Time when output started, for the throughput report. */
+std::chrono::steady_clock::time_point output_start;
+bool output_started;
+
+static void start_output(void)
+{
+	output_start = std::chrono::steady_clock::now();
+	output_started = true;
+	if (split_output) {
+		for (auto* out : symbol_outputs) {
+			output_header(out);
+		}
+	} else {
+		output_header(&main_output);
+	}
+	if (format_inline) {
+		if (flush) {
+			output_flush_all();
+		}
+	} else {
+		record_ring.reset(new helix::spsc_ring<trace_record>{RECORD_RING_SIZE});
+		formatter = std::thread{run_formatter};
+	}
+}
+
+static void stop_output(void)
+{
+	output_started = false;
+	if (formatter.joinable()) {
+		formatter_stop.store(true, std::memory_order_release);
+		formatter.join();
+	} else {
+		output_flush_all();
+	}
+}
+
+/*
+ * Exit on an error. Once output has started, the formatter thread is joined
+ * and the records that are formatted so far are written out first, because
+ * exiting with the thread running terminates the program and loses them.
+ * So are the packets of a recording.
+ */
+static void die(void)
+{
+	if (capture) {
+		helix_capture_close(capture);
+	}
+	if (output_started) {
+		stop_output();
+		if (column_writer) {
+			helix_column_writer_close(column_writer);
+		}
+	}
+	exit(1);
+}
+
+static trace_record *alloc_record(void)
+{
+	if (format_inline) {
+		return &inline_record;
+	}
+	trace_record *rec;
+	while (!(rec = record_ring->try_alloc())) {
+		std::this_thread::yield();
+	}
+	return rec;
+}
+
+static void emit_record(trace_record *rec)
+{
+	if (format_inline) {
+		output_record(rec);
+		if (flush) {
+			output_flush_all();
+		}
+	} else {
+		record_ring->publish();
+	}
+}
+
+static void trace_event(helix_session_t session, helix_event_t event, symbol_stats *stats, uint32_t symbol_id)
+{
+	auto timestamp = helix_event_timestamp(event);
+	if (!helix_session_is_rth_timestamp(session, timestamp) || !is_order_book_changed(stats, event)) {
+		return;
+	}
+	trace_record *rec = alloc_record();
+	snprintf(rec->symbol, sizeof(rec->symbol), "%s", helix_event_symbol(event));
+	rec->timestamp = timestamp;
+	rec->symbol_id = symbol_id;
+	rec->mask = helix_event_mask(event);
+	if (rec->mask & HELIX_EVENT_ORDER_BOOK_UPDATE) {
+		auto ob = helix_event_order_book(event);
+
+		stats->bid_price = rec->bid_price = helix_order_book_bid_price(ob, 0);
+		stats->bid_size = rec->bid_size = helix_order_book_bid_size(ob, 0);
+		stats->ask_price = rec->ask_price = helix_order_book_ask_price(ob, 0);
+		stats->ask_size = rec->ask_size = helix_order_book_ask_size(ob, 0);
+	}
+	if (rec->mask & HELIX_EVENT_TRADE) {
+		auto trade = helix_event_trade(event);
+		rec->trade_price = helix_trade_price(trade);
+		rec->trade_size = helix_trade_size(trade);
+		rec->trade_sign = trade_sign(helix_trade_sign(trade));
+		rec->vwap = stats_vwap(stats);
+	}
+	emit_record(rec);
+}
+
+static void process_ob_event(symbol_stats *stats, helix_order_book_t ob, helix_event_mask_t event_mask)
 {
 	size_t bid_levels = helix_order_book_bid_levels(ob);
 	size_t ask_levels = helix_order_book_ask_levels(ob);
 	size_t order_count = helix_order_book_order_count(ob);
 
-	max_price_levels = bid_levels > max_price_levels ? bid_levels : max_price_levels;
-	max_price_levels = ask_levels > max_price_levels ? ask_levels : max_price_levels;
-	max_order_count = order_count > max_order_count ? order_count : max_order_count;
-	quotes++;
+	stats->max_price_levels = bid_levels > stats->max_price_levels ? bid_levels : stats->max_price_levels;
+	stats->max_price_levels = ask_levels > stats->max_price_levels ? ask_levels : stats->max_price_levels;
+	stats->max_order_count = order_count > stats->max_order_count ? order_count : stats->max_order_count;
+	stats->quotes++;
 }
 
-static void process_trade_event(helix_session_t session, helix_trade_t trade, helix_event_mask_t event_mask)
+static void process_trade_event(symbol_stats *stats, helix_trade_t trade, helix_event_mask_t event_mask)
 {
 	double trade_price = helix_trade_price(trade)/10000.0;
 	uint64_t trade_size = helix_trade_size(trade);
-	volume_shs += trade_size;
-	volume_ccy += (double)trade_size * trade_price;
-	high = trade_price > high ? trade_price : high;
-	low = trade_price < low ? trade_price : low;
-	trades++;
+	stats->volume_shs += trade_size;
+	stats->volume_ccy += (double)trade_size * trade_price;
+	stats->high = trade_price > stats->high ? trade_price : stats->high;
+	stats->low = trade_price < stats->low ? trade_price : stats->low;
+	stats->trades++;
+}
+
+/*
+ * Look up the id of the symbol of an event, or return false if the symbol
+ * is not subscribed to. Symbols of events may be padded with spaces (ITCH
+ * 5.0), unlike the symbols that were subscribed to. The id is looked up by
+ * name once per order book and cached by the order book.
+ */
+static bool lookup_symbol(trace_session *ts, helix_event_t event, uint32_t *symbol_id)
+{
+	helix_order_book_t ob = helix_event_order_book(event);
+	if (ob) {
+		auto it = ts->book_ids.find(ob);
+		if (it != ts->book_ids.end()) {
+			*symbol_id = it->second;
+			return true;
+		}
+	}
+	const char *symbol = helix_event_symbol(event);
+	size_t len = strlen(symbol);
+	while (len && symbol[len - 1] == ' ') {
+		len--;
+	}
+	auto it = symbol_ids.find(std::string(symbol, len));
+	if (it == symbol_ids.end()) {
+		if (ts->unknown_symbol.empty()) {
+			ts->unknown_symbol = symbol;
+		}
+		return false;
+	}
+	if (ob) {
+		ts->book_ids.emplace(ob, it->second);
+	}
+	*symbol_id = it->second;
+	return true;
+}
+
+/*
+ * Events for symbols that are not subscribed to are skipped by the event
+ * callback, and reported once the session has returned.
+ */
+static bool has_unknown_symbol(const trace_session *ts, const char *name)
+{
+	if (ts->unknown_symbol.empty()) {
+		return false;
+	}
+	fprintf(stderr, "error: %s: event for symbol '%s', which is not subscribed to\n", name, ts->unknown_symbol.c_str());
+	return true;
+}
+
+/* Add the statistics of a symbol to @total, which may be of other symbols or files. */
+static void merge_stats(symbol_stats *total, const symbol_stats *stats)
+{
+	total->max_price_levels = std::max(total->max_price_levels, stats->max_price_levels);
+	total->max_order_count = std::max(total->max_order_count, stats->max_order_count);
+	total->quotes += stats->quotes;
+	total->trades += stats->trades;
+	total->volume_shs += stats->volume_shs;
+	total->volume_ccy += stats->volume_ccy;
+	total->high = std::max(total->high, stats->high);
+	total->low = std::min(total->low, stats->low);
 }
 
 static void process_event(helix_session_t session, helix_event_t event)
 {
+	std::unique_lock<std::mutex> guard{event_lock, std::defer_lock};
+	if (parallel) {
+		guard.lock();
+	}
+
+	if (helix_event_timestamp(event) < seek_timestamp) {
+		return;
+	}
+
+	auto* ts = reinterpret_cast<trace_session*>(helix_session_data(session));
+	uint32_t symbol_id;
+	if (!lookup_symbol(ts, event, &symbol_id)) {
+		return;
+	}
+	symbol_stats *stats = &ts->symbols[symbol_id];
 	helix_event_mask_t mask = helix_event_mask(event);
 
 	if (mask & HELIX_EVENT_ORDER_BOOK_UPDATE) {
 		helix_order_book_t ob = helix_event_order_book(event);
-		process_ob_event(session, ob, mask);
+		process_ob_event(stats, ob, mask);
 	}
 	if (mask & HELIX_EVENT_TRADE) {
 		helix_trade_t trade = helix_event_trade(event);
-		process_trade_event(session, trade, mask);
+		process_trade_event(stats, trade, mask);
+	}
+	if (!stats_only) {
+		trace_event(session, event, stats, symbol_id);
 	}
-	fmt_ops->fmt_event(session, event);
 }
 
 static void recv_packet(uv_udp_t* handle, ssize_t nread, const uv_buf_t* buf, const struct sockaddr* addr, unsigned flags)
 {
 	if (nread > 0) {
-		int nr = helix_session_process_packet(reinterpret_cast<helix_session_t>(handle->data), buf->base, nread);
+		if (capture) {
+			struct timespec now;
+			clock_gettime(CLOCK_REALTIME, &now);
+			helix_capture_record(capture, (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec, 0, buf->base, nread);
+		}
+		auto session = reinterpret_cast<helix_session_t>(handle->data);
+		int nr = helix_session_process_packet(session, buf->base, nread);
 		if (nr < 0) {
 			fprintf(stderr, "error: %s\n", helix_strerror(nr));
-			exit(1);
+			die();
+		}
+		if (has_unknown_symbol(reinterpret_cast<trace_session*>(helix_session_data(session)), "feed")) {
+			die();
 		}
 	}
 }
 
+static void poll_retransmit(uv_timer_t* handle)
+{
+	auto session = reinterpret_cast<helix_session_t>(handle->data);
+	int err = helix_session_poll_retransmit(session);
+	if (err) {
+		fprintf(stderr, "error: %s\n", helix_strerror(err));
+		die();
+	}
+}
+
+/*
+ * A request that is queued for sending owns a copy of its packet, because
+ * the session may send more requests before the event loop sends this one.
+ */
+struct udp_send_request {
+	uv_udp_send_t req;
+	std::vector<char> buf;
+};
+
 static void udp_send_done(uv_udp_send_t* req, int status)
 {
-	delete req;
+	delete reinterpret_cast<udp_send_request*>(req->data);
 }
 
 static void process_send(helix_session_t session, char* base, size_t len)
 {
 	auto* ts = reinterpret_cast<trace_session*>(helix_session_data(session));
 
-	static char tx_buf[1024];
-	memcpy(tx_buf, base, len);
-
-	uv_udp_send_t *send_req = new uv_udp_send_t;
-	uv_buf_t msg = uv_buf_init(tx_buf, len);
+	auto* send_req = new udp_send_request;
+	send_req->req.data = send_req;
+	send_req->buf.assign(base, base + len);
+	uv_buf_t msg = uv_buf_init(send_req->buf.data(), len);
 
 	struct sockaddr_in saddr;
 	uv_ip4_addr(ts->addr.addr.c_str(), ts->addr.port, &saddr);
-	uv_udp_send(send_req, &ts->request_socket, &msg, 1, (const struct sockaddr *)&saddr, udp_send_done);
+	int err = uv_udp_send(&send_req->req, &ts->request_socket, &msg, 1, (const struct sockaddr *)&saddr, udp_send_done);
+	/* A request that cannot be sent is sent again when it times out. */
+	if (err) {
+		delete send_req;
+	}
+}
+
+static void stop_tracing(uv_signal_t* handle, int signum)
+{
+	uv_stop(uv_default_loop());
 }
 
 static void libuv_error(const char *s, int err)
 {
 	fprintf(stderr, "error: %s: %s (%s)\n", s, uv_strerror(err), uv_err_name(err));
-	exit(1);
+	die();
+}
+
+/*
+ * Replay a file. Sessions for file formats process as many messages as they
+ * can frame from the buffer in one call (a batch for SoupFILE), and return
+ * the number of bytes consumed, or zero at the end of the session. Parallel
+ * sessions are still processing the last messages when the input ends, so
+ * the session is finished before its results are read.
+ */
+static void replay_file(helix_session_t session, const char *filename, const char *p, size_t size)
+{
+	int err;
+
+	while (size > 0) {
+		int nr;
+
+		nr = helix_session_process_packet(session, p, size);
+		if (!nr)
+			break;
+		if (nr < 0) {
+			fprintf(stderr, "error: %s: %s\n", filename, helix_strerror(nr));
+			die();
+		}
+		p += nr;
+		size -= nr;
+	}
+	err = helix_session_finish(session);
+	if (err) {
+		fprintf(stderr, "error: %s: %s\n", filename, helix_strerror(err));
+		die();
+	}
+}
+
+static bool has_suffix(const char *s, const char *suffix)
+{
+	size_t len = strlen(s), suffix_len = strlen(suffix);
+
+	return len >= suffix_len && !strcmp(s + len - suffix_len, suffix);
+}
+
+/*
+ * Captures hold the datagrams of a MoldUDP feed, which are replayed through
+ * the session as if they were received live.
+ */
+static bool is_helix_capture(const char *filename)
+{
+	return has_suffix(filename, ".hcap");
+}
+
+static bool is_capture(const char *filename)
+{
+	return has_suffix(filename, ".pcap") || has_suffix(filename, ".pcapng") || is_helix_capture(filename);
+}
+
+/*
+ * A batch replays every file of a list with a session of its own, and
+ * gathers the statistics of every file into a symbol table of the session.
+ */
+struct batch_context {
+	const struct config *cfg;
+	helix_sizing_hints_t sizing_hints;
+	std::vector<trace_session> sessions;
+};
+
+/*
+ * Subscribe a session to the symbols of the configuration. Returns zero on
+ * success, or prints the error and returns it.
+ */
+static int subscribe_symbols(helix_session_t session, const struct config *cfg)
+{
+	for (auto&& symbol : cfg->symbols) {
+		int err = helix_session_subscribe(session, symbol.c_str(), cfg->max_orders);
+		if (err) {
+			fprintf(stderr, "error: symbol '%s': %s\n", symbol.c_str(), helix_strerror(err));
+			return err;
+		}
+	}
+	return 0;
+}
+
+static helix_session_t create_batch_session(helix_protocol_t proto, size_t index, const char *filename, void *data)
+{
+	auto* ctx = reinterpret_cast<batch_context*>(data);
+	helix_session_t session = helix_session_create(proto, process_event, &ctx->sessions[index]);
+	if (!session) {
+		return NULL;
+	}
+	if (ctx->sizing_hints) {
+		helix_session_set_sizing_hints(session, ctx->sizing_hints);
+	}
+	if (subscribe_symbols(session, ctx->cfg)) {
+		helix_session_destroy(session);
+		return NULL;
+	}
+	return session;
+}
+
+/*
+ * Read the list of files of a batch. Every line is a filename, optionally
+ * preceded by the protocol to replay it with, which defaults to the one of
+ * the '-P' option. Empty lines and lines that start with '#' are skipped.
+ */
+static void read_batch_list(const struct config *cfg, std::vector<std::pair<std::string, std::string>>& files)
+{
+	FILE *list = fopen(cfg->batch, "r");
+	if (!list) {
+		fprintf(stderr, "error: %s: %s\n", cfg->batch, strerror(errno));
+		exit(1);
+	}
+	char line[4096];
+	unsigned lineno = 0;
+	while (fgets(line, sizeof(line), list)) {
+		char first[4096], second[4096];
+		lineno++;
+		int nr = sscanf(line, "%4095s %4095s", first, second);
+		if (nr <= 0 || first[0] == '#') {
+			continue;
+		}
+		if (nr == 2) {
+			files.emplace_back(first, second);
+		} else if (cfg->proto) {
+			files.emplace_back(cfg->proto, first);
+		} else {
+			fprintf(stderr, "error: %s:%u: no protocol for %s. Use the '-P' option to specify it.\n", cfg->batch, lineno, first);
+			exit(1);
+		}
+	}
+	fclose(list);
+}
+
+/*
+ * Replay a batch, and merge the statistics of its files into @symbols.
+ * Returns the number of files that failed.
+ */
+static size_t trace_batch(const struct config *cfg, std::vector<symbol_stats>& symbols)
+{
+	std::vector<std::pair<std::string, std::string>> files;
+	read_batch_list(cfg, files);
+
+	helix_batch_t batch = helix_batch_create(cfg->threads, cfg->max_sessions, cfg->read_mode);
+	if (!batch) {
+		fprintf(stderr, "error: unable to create batch\n");
+		exit(1);
+	}
+	std::unordered_map<std::string, helix_protocol_t> protocols;
+	for (auto&& file : files) {
+		auto it = protocols.find(file.first);
+		if (it == protocols.end()) {
+			if (strstr(file.first.c_str(), "moldudp")) {
+				fprintf(stderr, "error: protocol '%s' cannot be replayed in a batch\n", file.first.c_str());
+				exit(1);
+			}
+			if (cfg->sizing_hints && file.first != "nasdaq-binaryfile-itch50") {
+				fprintf(stderr, "error: protocol '%s' cannot be sized by sizing hints\n", file.first.c_str());
+				exit(1);
+			}
+			helix_protocol_t proto = helix_protocol_lookup(file.first.c_str());
+			if (!proto) {
+				fprintf(stderr, "error: protocol '%s' is not supported\n", file.first.c_str());
+				exit(1);
+			}
+			/* Check the symbols before any file is replayed. */
+			helix_session_t session = helix_session_create(proto, process_event, NULL);
+			if (!session) {
+				fprintf(stderr, "error: unable to create new session\n");
+				exit(1);
+			}
+			if (subscribe_symbols(session, cfg)) {
+				exit(1);
+			}
+			helix_session_destroy(session);
+			it = protocols.emplace(file.first, proto).first;
+		}
+		if (helix_batch_add(batch, it->second, file.second.c_str())) {
+			fprintf(stderr, "error: %s: unable to add to batch\n", file.second.c_str());
+			exit(1);
+		}
+	}
+
+	batch_context ctx;
+	ctx.cfg = cfg;
+	ctx.sizing_hints = NULL;
+	if (cfg->sizing_hints) {
+		int err = helix_sizing_hints_load(cfg->sizing_hints, &ctx.sizing_hints);
+		if (err) {
+			fprintf(stderr, "error: %s: %s\n", cfg->sizing_hints, helix_strerror(err));
+			exit(1);
+		}
+	}
+	ctx.sessions.resize(files.size());
+	for (auto&& ts : ctx.sessions) {
+		ts.symbols = symbols;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	size_t failed = helix_batch_run(batch, create_batch_session, &ctx);
+	double batch_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t bytes = 0, steals = 0;
+	for (size_t i = 0; i < files.size(); i++) {
+		helix_batch_file_stats_t stats = helix_batch_file_stats(batch, i);
+		const char *filename = files[i].second.c_str();
+		if (stats.error) {
+			fprintf(stderr, "error: %s: %s\n", filename, helix_strerror(stats.error));
+			continue;
+		}
+		if (has_unknown_symbol(&ctx.sessions[i], filename)) {
+			failed++;
+			continue;
+		}
+		double sec = stats.duration_ns / 1e9;
+		fprintf(stderr, "%s: %.1f MiB in %.3f s, %.1f MiB/s, worker %zu%s\n",
+			filename, stats.bytes / 1048576.0, sec, stats.bytes / 1048576.0 / sec,
+			stats.worker, stats.stolen ? " (stolen)" : "");
+		bytes += stats.bytes;
+		steals += stats.stolen;
+		for (size_t id = 0; id < symbols.size(); id++) {
+			merge_stats(&symbols[id], &ctx.sessions[i].symbols[id]);
+		}
+	}
+	fprintf(stderr, "batch: %zu files (%zu failed) on %zu workers, %.1f MiB in %.3f s, %.1f MiB/s, %" PRIu64 " stolen\n",
+		files.size(), failed, helix_batch_nr_workers(batch), bytes / 1048576.0, batch_sec, bytes / 1048576.0 / batch_sec, steals);
+	helix_batch_destroy(batch);
+	if (ctx.sizing_hints) {
+		helix_sizing_hints_destroy(ctx.sizing_hints);
+	}
+	return failed;
 }
 
 static void usage(void)
@@ -341,6 +1131,11 @@ static void usage(void)
 		"  options:\n"
 		"    -s, --symbol symbol            Ticker symbol to listen to.\n"
 		"    -m, --max-orders number        Maximum number of orders per symbol (for pre-allocation).\n"
+		"    -H, --sizing-hints filename    Pre-allocate order books by the sizing hints built by helix-index -H,\n"
+		"                                   or by -m if it is larger (nasdaq-binaryfile-itch50). A batch sizes\n"
+		"                                   every file by the same hints, so it should hold a single day.\n"
+		"    -t, --threads number           Number of threads to replay input with (nasdaq-binaryfile-itch50),\n"
+		"                                   with statistics only or an output file per symbol.\n"
 		"    -P, --proto proto              Market data protocol to listen to\n"
 		"          or read from. Supported values:\n"
 		"              nasdaq-nordic-moldudp-itch\n"
@@ -350,9 +1145,31 @@ static void usage(void)
 		"    -a, --multicast-addr addr      UDP multicast address to listen to.\n"
 		"    -p, --multicast-port port      UDP multicast port to listen to.\n"
 		"    -r, --request-server addr:port UDP request server to connect to.\n"
-		"    -i, --input filename           Input filename.\n"
-		"    -o, --output filename          Output filename.\n"
-		"    -f, --format format            Output format (pretty, csv).\n"
+		"    -i, --input filename           Input filename, which may be compressed with gzip (.gz) or zstd (.zst),\n"
+		"                                   or a pcap or pcapng capture (.pcap, .pcapng) of a MoldUDP feed\n"
+		"                                   filtered by the multicast address and port, or a Helix capture (.hcap).\n"
+		"    -o, --output filename          Output filename. A '%%s' in it is replaced with the symbol,\n"
+		"                                   and every symbol is traced to a file of its own.\n"
+		"    -S, --stats-only               Print only the statistics of every symbol, without tracing events.\n"
+		"    -F, --format-inline            Format output on the event thread instead of a formatter thread.\n"
+		"    -f, --format format            Output format (pretty, csv, binary). The binary format is columnar\n"
+		"                                   and needs an output file; see scripts/helix_columns.py.\n"
+		"    -c, --load-checkpoint filename Restore order books from a checkpoint and continue from it.\n"
+		"    -C, --save-checkpoint filename Write a checkpoint of the order books after the input is replayed.\n"
+		"    -T, --seek timestamp           Start tracing at a timestamp, restoring order books from the index.\n"
+		"    -x, --index filename           Replay index built by helix-index (default: input filename with .idx suffix).\n"
+		"    -I, --symbol-index filename    Replay only the messages of the symbols with a per-symbol index\n"
+		"                                   built by helix-index -S (nasdaq-binaryfile-itch50).\n"
+		"    -O, --record filename          Record the received packets of a live feed to a Helix capture.\n"
+		"    -k, --capture-time             Replay a capture at the pace it was captured.\n"
+		"    -w, --pace speed               Replay input in real time by message timestamps, sped up by a factor.\n"
+		"    -W, --pace-clock clock         Clock that paced replay busy-waits on (monotonic, tsc; default: monotonic).\n"
+		"    -g, --pace-packets             Pace only the first message of every packet.\n"
+		"    -R, --read-mode mode           How the input is read (mmap, pread, io_uring; default: mmap).\n"
+		"    -b, --batch filename           Replay every file of a list on a pool of threads (-t, default: one per\n"
+		"                                   core) and print the statistics of every symbol over all of them.\n"
+		"                                   A line of the list is a filename, optionally preceded by a protocol.\n"
+		"    -M, --max-sessions number      Maximum number of files replayed at a time in a batch.\n"
 		"    -h, --help                     display this help and exit\n",
 		program);
 	exit(1);
@@ -361,6 +1178,8 @@ static void usage(void)
 static struct option trace_options[] = {
 	{"symbol",          required_argument, 0, 's'},
 	{"max-orders",      required_argument, 0, 'm'},
+	{"sizing-hints",    required_argument, 0, 'H'},
+	{"threads",         required_argument, 0, 't'},
 	{"proto",           required_argument, 0, 'P'},
 	{"multicast-addr",  required_argument, 0, 'a'},
 	{"multicast-port",  required_argument, 0, 'p'},
@@ -368,6 +1187,21 @@ static struct option trace_options[] = {
 	{"input",           required_argument, 0, 'i'},
 	{"output",          required_argument, 0, 'o'},
 	{"format",          required_argument, 0, 'f'},
+	{"format-inline",   no_argument,       0, 'F'},
+	{"stats-only",      no_argument,       0, 'S'},
+	{"load-checkpoint", required_argument, 0, 'c'},
+	{"save-checkpoint", required_argument, 0, 'C'},
+	{"seek",            required_argument, 0, 'T'},
+	{"index",           required_argument, 0, 'x'},
+	{"symbol-index",    required_argument, 0, 'I'},
+	{"read-mode",       required_argument, 0, 'R'},
+	{"record",          required_argument, 0, 'O'},
+	{"capture-time",    no_argument,       0, 'k'},
+	{"pace",            required_argument, 0, 'w'},
+	{"pace-clock",      required_argument, 0, 'W'},
+	{"pace-packets",    no_argument,       0, 'g'},
+	{"batch",           required_argument, 0, 'b'},
+	{"max-sessions",    required_argument, 0, 'M'},
 	{"help",            no_argument,       0, 'h'},
 	{0, 0, 0, 0}
 };
@@ -375,12 +1209,13 @@ static struct option trace_options[] = {
 static void parse_options(struct config *cfg, int argc, char *argv[])
 {
 	cfg->format = "pretty";
+	cfg->read_mode = HELIX_READ_MMAP;
 
 	for (;;) {
 		int opt_idx = 0;
 		int c;
 
-		c = getopt_long(argc, argv, "s:m:P:a:r:i:o:p:f:h", trace_options, &opt_idx);
+		c = getopt_long(argc, argv, "s:m:H:t:P:a:r:i:o:p:f:FSc:C:T:x:I:R:O:kw:W:gb:M:h", trace_options, &opt_idx);
 		if (c == -1)
 			break;
 
@@ -391,6 +1226,16 @@ static void parse_options(struct config *cfg, int argc, char *argv[])
 		case 'm':
 			cfg->max_orders = strtol(optarg, NULL, 10);
 			break;
+		case 'H':
+			cfg->sizing_hints = optarg;
+			break;
+		case 't':
+			cfg->threads = strtol(optarg, NULL, 10);
+			if (!cfg->threads) {
+				fprintf(stderr, "error: number of threads must be positive\n");
+				exit(1);
+			}
+			break;
 		case 'P':
 			cfg->proto = optarg;
 			break;
@@ -412,6 +1257,71 @@ static void parse_options(struct config *cfg, int argc, char *argv[])
 		case 'f':
 			cfg->format = optarg;
 			break;
+		case 'F':
+			format_inline = true;
+			break;
+		case 'S':
+			stats_only = true;
+			break;
+		case 'c':
+			cfg->load_checkpoint = optarg;
+			break;
+		case 'C':
+			cfg->save_checkpoint = optarg;
+			break;
+		case 'T':
+			cfg->seek = strtoull(optarg, NULL, 10);
+			break;
+		case 'x':
+			cfg->index = optarg;
+			break;
+		case 'I':
+			cfg->symbol_index = optarg;
+			break;
+		case 'O':
+			cfg->record = optarg;
+			break;
+		case 'k':
+			cfg->capture_time = true;
+			break;
+		case 'w':
+			cfg->pace = strtod(optarg, NULL);
+			if (cfg->pace <= 0) {
+				fprintf(stderr, "error: replay speed must be positive\n");
+				exit(1);
+			}
+			break;
+		case 'W':
+			if (!strcmp(optarg, "monotonic")) {
+				cfg->pace_clock = HELIX_PACING_CLOCK_MONOTONIC;
+			} else if (!strcmp(optarg, "tsc")) {
+				cfg->pace_clock = HELIX_PACING_CLOCK_TSC;
+			} else {
+				fprintf(stderr, "error: unsupported pacing clock '%s'\n", optarg);
+				exit(1);
+			}
+			break;
+		case 'g':
+			cfg->pace_packets = true;
+			break;
+		case 'b':
+			cfg->batch = optarg;
+			break;
+		case 'M':
+			cfg->max_sessions = strtol(optarg, NULL, 10);
+			break;
+		case 'R':
+			if (!strcmp(optarg, "mmap")) {
+				cfg->read_mode = HELIX_READ_MMAP;
+			} else if (!strcmp(optarg, "pread")) {
+				cfg->read_mode = HELIX_READ_PREAD;
+			} else if (!strcmp(optarg, "io_uring")) {
+				cfg->read_mode = HELIX_READ_IO_URING;
+			} else {
+				fprintf(stderr, "error: unsupported read mode '%s'\n", optarg);
+				exit(1);
+			}
+			break;
 		case 'h':
 			usage();
 		default:
@@ -428,8 +1338,9 @@ int main(int argc, char *argv[])
 	struct config cfg = {};
 	struct stat input_st;
 	trace_session ts;
-	void *input_mmap;
+	void *input_mmap = NULL;
 	uv_udp_t socket;
+	uv_timer_t retransmit_timer;
 	int input_fd;
 	int err;
 
@@ -442,12 +1353,24 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
-	if (!cfg.proto) {
+	if (cfg.batch) {
+		if (cfg.input || cfg.multicast_addr || cfg.load_checkpoint || cfg.save_checkpoint || cfg.seek
+				|| cfg.symbol_index || cfg.record || cfg.pace) {
+			fprintf(stderr, "error: a batch cannot be combined with an input, a live feed, checkpoints, seeking or pacing\n");
+			exit(1);
+		}
+		/* A batch only gathers statistics. */
+		stats_only = true;
+	} else if (!cfg.threads) {
+		cfg.threads = 1;
+	}
+
+	if (!cfg.proto && !cfg.batch) {
 		fprintf(stderr, "error: multicast protocol is not specified. Use the '-P' option to specify it.\n");
 		exit(1);
 	}
 
-	if (!cfg.input) {
+	if (!cfg.input && !cfg.batch) {
 		if (!cfg.request_server) {
 			fprintf(stderr, "error: no request server specified. Use the '-r' option to specify it.\n");
 			exit(1);
@@ -459,12 +1382,59 @@ int main(int argc, char *argv[])
 		fmt_ops = &fmt_pretty_ops;
 	} else if (!strcmp(cfg.format, "csv")) {
 		fmt_ops = &fmt_csv_ops;
+	} else if (!strcmp(cfg.format, "binary")) {
+		fmt_ops = &fmt_binary_ops;
 	} else {
 		fprintf(stderr, "error: %s: unsupported format\n", cfg.format);
 		exit(1);
 	}
 
-	if (cfg.output) {
+	for (auto&& symbol : cfg.symbols) {
+		if (symbol_ids.count(symbol)) {
+			continue;
+		}
+		symbol_ids.emplace(symbol, ts.symbols.size());
+		ts.symbols.emplace_back();
+		ts.symbols.back().symbol = symbol;
+	}
+
+	split_output = cfg.output && strstr(cfg.output, "%s");
+
+	if (stats_only && (fmt_ops == &fmt_binary_ops || split_output)) {
+		fprintf(stderr, "error: statistics are printed to a single output file in the pretty or csv format\n");
+		exit(1);
+	}
+
+	if (split_output) {
+		if (fmt_ops == &fmt_binary_ops) {
+			fprintf(stderr, "error: the binary format cannot be split by symbol, which it has a column for\n");
+			exit(1);
+		}
+		for (auto&& stats : ts.symbols) {
+			std::string filename = cfg.output;
+			for (size_t pos; (pos = filename.find("%s")) != std::string::npos; ) {
+				filename.replace(pos, 2, stats.symbol);
+			}
+			FILE *file = fopen(filename.c_str(), "w");
+			if (!file) {
+				fprintf(stderr, "error: %s: %s\n", filename.c_str(), strerror(errno));
+				exit(1);
+			}
+			symbol_outputs.push_back(new output_stream);
+			output_init(symbol_outputs.back(), file, NR_SYMBOL_OUTPUT_BUFFERS);
+		}
+		flush = false;
+	} else if (fmt_ops == &fmt_binary_ops) {
+		if (!cfg.output) {
+			fprintf(stderr, "error: the binary format needs an output file. Use the '-o' option to specify it.\n");
+			exit(1);
+		}
+		column_writer = helix_column_writer_create(cfg.output, binary_columns, NR_COLUMNS);
+		if (!column_writer) {
+			fprintf(stderr, "error: %s: unable to create output file\n", cfg.output);
+			exit(1);
+		}
+	} else if (cfg.output) {
 		output = fopen(cfg.output, "w");
 		flush = false;
 		if (!output) {
@@ -475,6 +1445,17 @@ int main(int argc, char *argv[])
 		output = stdout;
 		flush = true;
 	}
+	if (output) {
+		output_init(&main_output, output, NR_OUTPUT_BUFFERS);
+	}
+
+	if (cfg.batch) {
+		size_t failed = trace_batch(&cfg, ts.symbols);
+		output_stats(ts.symbols);
+		if (cfg.output)
+			fclose(output);
+		return failed ? 1 : 0;
+	}
 
 	proto = helix_protocol_lookup(cfg.proto);
 	if (!proto) {
@@ -482,22 +1463,133 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
-	session = helix_session_create(proto, process_event, &ts);
+	/* Sizing hints are measured by a pre-scan of an ITCH 5.0 BinaryFILE. */
+	if (cfg.sizing_hints && strcmp(cfg.proto, "nasdaq-binaryfile-itch50")) {
+		fprintf(stderr, "error: protocol '%s' cannot be sized by sizing hints\n", cfg.proto);
+		exit(1);
+	}
+
+	if (cfg.symbol_index &&(cfg.threads > 1 || cfg.load_checkpoint || cfg.seek)) {
+		fprintf(stderr, "error: a per-symbol index cannot be combined with threads, checkpoints or seeking\n");
+		exit(1);
+	}
+
+	/*
+	 * Every thread of a parallel session has order books of its own, which
+	 * are not written to or restored from checkpoints.
+	 */
+	if (cfg.threads > 1 && (cfg.load_checkpoint || cfg.save_checkpoint)) {
+		fprintf(stderr, "error: checkpoints cannot be combined with threads\n");
+		exit(1);
+	}
+
+	if (cfg.input && is_capture(cfg.input)) {
+		if (!strstr(cfg.proto, "moldudp")) {
+			fprintf(stderr, "error: protocol '%s' cannot be replayed from a capture\n", cfg.proto);
+			exit(1);
+		}
+		if (cfg.symbol_index || cfg.seek) {
+			fprintf(stderr, "error: a capture cannot be replayed with a per-symbol index or seeking\n");
+			exit(1);
+		}
+	}
+
+	if (cfg.record && cfg.input) {
+		fprintf(stderr, "error: only a live feed can be recorded\n");
+		exit(1);
+	}
+
+	if (cfg.pace && (!cfg.input || cfg.threads > 1 || cfg.capture_time)) {
+		fprintf(stderr, "error: paced replay requires an input file and cannot be combined with threads or capture time\n");
+		exit(1);
+	}
+
+	/*
+	 * Threads replay the symbols in parallel, so only the events of each
+	 * symbol are in the order of a serial replay.
+	 */
+	if (cfg.threads > 1 && !stats_only && !split_output) {
+		fprintf(stderr, "error: replay with threads needs statistics only (-S) or an output file per symbol (%%s)\n");
+		exit(1);
+	}
+
+	/*
+	 * Compressed input is decompressed by the session's file reader, but
+	 * cannot be mapped whole. Compression is detected from the contents of
+	 * the file, whatever its name.
+	 */
+	if (cfg.input && helix_file_is_compressed(cfg.input) && (cfg.threads > 1 || cfg.symbol_index)) {
+		fprintf(stderr, "error: compressed input cannot be replayed with threads or a per-symbol index\n");
+		exit(1);
+	}
+
+	if (cfg.threads > 1) {
+		session = helix_session_create_parallel(proto, process_event, &ts, cfg.threads);
+		if (!session) {
+			fprintf(stderr, "error: protocol '%s' does not support multiple threads\n", cfg.proto);
+			exit(1);
+		}
+		parallel = true;
+	} else {
+		session = helix_session_create(proto, process_event, &ts);
+	}
 	if (!session) {
 		fprintf(stderr, "error: unable to create new session\n");
 		exit(1);
 	}
 
-	for (auto&& symbol : cfg.symbols) {
-		helix_session_subscribe(session, symbol.c_str(), cfg.max_orders);
+	if (cfg.sizing_hints) {
+		err = helix_session_load_sizing_hints(session, cfg.sizing_hints);
+		if (err) {
+			fprintf(stderr, "error: %s: %s\n", cfg.sizing_hints, helix_strerror(err));
+			exit(1);
+		}
 	}
 
-	helix_session_set_send_callback(session, process_send);
+	if (subscribe_symbols(session, &cfg)) {
+		exit(1);
+	}
 
-	if (cfg.input) {
-		const char* p;
-		size_t size;
+	/* Retransmissions can only be requested from a live feed. */
+	if (!cfg.input) {
+		err = helix_session_set_send_callback(session, process_send);
+		if (err) {
+			fprintf(stderr, "error: protocol '%s' cannot request retransmissions with multiple threads\n", cfg.proto);
+			exit(1);
+		}
+	}
 
+	if (cfg.pace) {
+		err = helix_session_set_pacing(session, cfg.pace, cfg.pace_clock, cfg.pace_packets);
+		if (err) {
+			fprintf(stderr, "error: unable to pace replay: %s\n", helix_strerror(err));
+			exit(1);
+		}
+	}
+
+	if (cfg.load_checkpoint) {
+		err = helix_session_load_checkpoint(session, cfg.load_checkpoint);
+		if (err) {
+			fprintf(stderr, "error: %s: %s\n", cfg.load_checkpoint, helix_strerror(err));
+			exit(1);
+		}
+	}
+
+	if (cfg.seek) {
+		if (!cfg.input) {
+			fprintf(stderr, "error: seeking requires an input file. Use the '-i' option to specify it.\n");
+			exit(1);
+		}
+		std::string index = cfg.index ? cfg.index : std::string(cfg.input) + ".idx";
+		err = helix_session_seek(session, index.c_str(), cfg.seek);
+		if (err) {
+			fprintf(stderr, "error: %s: %s\n", index.c_str(), helix_strerror(err));
+			exit(1);
+		}
+		seek_timestamp = cfg.seek;
+	}
+
+	if (cfg.input) {
 		input_fd = open(cfg.input, O_RDONLY);
 		if (input_fd < 0) {
 			fprintf(stderr, "error: %s: %s\n", cfg.input, strerror(errno));
@@ -507,43 +1599,99 @@ int main(int argc, char *argv[])
 			fprintf(stderr, "error: %s: %s\n", cfg.input, strerror(errno));
 			exit(1);
 		}
-		input_mmap = mmap(NULL, input_st.st_size, PROT_READ, MAP_SHARED, input_fd, 0);
-		if (input_mmap == MAP_FAILED) {
-			fprintf(stderr, "error: %s: %s\n", cfg.input, strerror(errno));
-			exit(1);
+		if (!stats_only) {
+			start_output();
 		}
 
-		fmt_ops->fmt_header();
+		if (is_capture(cfg.input)) {
+			if (is_helix_capture(cfg.input)) {
+				err = helix_session_replay_capture(session, cfg.input, cfg.capture_time);
+			} else {
+				err = helix_session_replay_pcap(session, cfg.input, cfg.multicast_addr, cfg.multicast_port, cfg.capture_time);
+			}
+			if (err) {
+				fprintf(stderr, "error: %s: %s\n", cfg.input, helix_strerror(err));
+				die();
+			}
+		} else {
+			/*
+			 * A session restored from a checkpoint continues where the checkpoint
+			 * was taken. The position of compressed input is in the decompressed
+			 * input, which is only known once it is decompressed.
+			 */
+			uint64_t start = helix_session_position(session);
+			if (!helix_file_is_compressed(cfg.input) && start > (uint64_t)input_st.st_size) {
+				fprintf(stderr, "error: %s: checkpoint position %" PRIu64 " is past the end of the file\n", cfg.input, start);
+				die();
+			}
 
-		p = reinterpret_cast<char*>(input_mmap);
-		size = input_st.st_size;
-		while (size > 0) {
-			int nr;
+			/*
+			 * Parallel sessions and sparse replay address the whole file, so
+			 * they get it mapped whole. Otherwise the input is streamed.
+			 */
+			if (cfg.threads > 1 || cfg.symbol_index) {
+				input_mmap = mmap(NULL, input_st.st_size, PROT_READ, MAP_SHARED, input_fd, 0);
+				if (input_mmap == MAP_FAILED) {
+					fprintf(stderr, "error: %s: %s\n", cfg.input, strerror(errno));
+					die();
+				}
+				if (cfg.symbol_index) {
+					std::vector<const char*> symbols;
+					for (auto&& symbol : cfg.symbols) {
+						symbols.push_back(symbol.c_str());
+					}
+					err = helix_session_replay_symbols(session, cfg.symbol_index, symbols.data(), symbols.size(), reinterpret_cast<char*>(input_mmap), input_st.st_size);
+					if (err) {
+						fprintf(stderr, "error: %s: %s\n", cfg.symbol_index, helix_strerror(err));
+						die();
+					}
+				} else {
+					replay_file(session, cfg.input, reinterpret_cast<char*>(input_mmap) + start, input_st.st_size - start);
+				}
+			} else {
+				err = helix_session_replay_file(session, cfg.input, cfg.read_mode, 0, start);
+				if (err) {
+					fprintf(stderr, "error: %s: %s\n", cfg.input, helix_strerror(err));
+					die();
+				}
+			}
+		}
 
-			nr = helix_session_process_packet(session, p, size);
-			if (!nr)
-				break;
-			if (nr < 0) {
-				fprintf(stderr, "error: %s: %s\n", cfg.input, helix_strerror(nr));
-				exit(1);
+		if (has_unknown_symbol(&ts, cfg.input)) {
+			die();
+		}
+
+		if (cfg.save_checkpoint) {
+			err = helix_session_save_checkpoint(session, cfg.save_checkpoint);
+			if (err) {
+				fprintf(stderr, "error: %s: %s\n", cfg.save_checkpoint, helix_strerror(err));
+				die();
 			}
-			p += nr;
-			size -= nr;
 		}
 
-		if (munmap(input_mmap, input_st.st_size) < 0) {
+		if (cfg.pace) {
+			helix_pacing_stats_t stats = helix_session_pacing_stats(session);
+			fprintf(stderr, "pacing: %" PRIu64 " releases, %" PRIu64 " late, error p50 %" PRIu64 " ns, p90 %" PRIu64 " ns, p99 %" PRIu64 " ns, p99.9 %" PRIu64 " ns, max %" PRIu64 " ns\n",
+				stats.releases, stats.late, stats.p50_ns, stats.p90_ns, stats.p99_ns, stats.p999_ns, stats.max_ns);
+		}
+
+		/* Wait for worker threads to finish before the input is unmapped. */
+		helix_session_destroy(session);
+
+		if (input_mmap && munmap(input_mmap, input_st.st_size) < 0) {
 			fprintf(stderr, "error: %s: %s\n", cfg.input, strerror(errno));
-			exit(1);
+			die();
 		}
+		close(input_fd);
 	} else {
 		if (!cfg.multicast_addr) {
 			fprintf(stderr, "error: multicast address is not specified. Use the '-a' option to specify it.\n");
-			exit(1);
+			die();
 		}
 
 		if (!cfg.multicast_port) {
 			fprintf(stderr, "error: multicast port is not specified. Use the '-p' option to specify it.\n");
-			exit(1);
+			die();
 		}
 
 		err = uv_udp_init(uv_default_loop(), &socket);
@@ -583,14 +1731,97 @@ int main(int argc, char *argv[])
 			libuv_error("uv_udp_recv_start", err);
 		}
 
-		fmt_ops->fmt_header();
+		/* Lost responses are requested again even if the feed goes quiet. */
+		err = uv_timer_init(uv_default_loop(), &retransmit_timer);
+		if (err) {
+			libuv_error("uv_timer_init", err);
+		}
+		retransmit_timer.data = session;
+		err = uv_timer_start(&retransmit_timer, poll_retransmit, RETRANSMIT_POLL_MS, RETRANSMIT_POLL_MS);
+		if (err) {
+			libuv_error("uv_timer_start", err);
+		}
+
+		/*
+		 * A recording or binary output is stopped with a signal, after which
+		 * the packets and rows that are still buffered are written out. So is
+		 * gathering statistics, which are printed when it stops.
+		 */
+		uv_signal_t sigint, sigterm;
+		if (cfg.record) {
+			capture = helix_capture_open(cfg.record);
+			if (!capture) {
+				fprintf(stderr, "error: %s: unable to open capture\n", cfg.record);
+				die();
+			}
+		}
+		if (capture || column_writer || stats_only) {
+			uv_signal_init(uv_default_loop(), &sigint);
+			uv_signal_start(&sigint, stop_tracing, SIGINT);
+			uv_signal_init(uv_default_loop(), &sigterm);
+			uv_signal_start(&sigterm, stop_tracing, SIGTERM);
+		}
+
+		if (!stats_only) {
+			start_output();
+		}
 
 		uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+		if (capture) {
+			uint64_t dropped = helix_capture_dropped(capture);
+			err = helix_capture_close(capture);
+			capture = NULL;
+			if (err) {
+				fprintf(stderr, "error: %s: %s\n", cfg.record, helix_strerror(err));
+				die();
+			}
+			if (dropped) {
+				fprintf(stderr, "warning: %s: %" PRIu64 " packets were dropped\n", cfg.record, dropped);
+			}
+		}
 	}
 
+	if (stats_only) {
+		output_stats(ts.symbols);
+	} else {
+		stop_output();
+	}
+	auto output_end = std::chrono::steady_clock::now();
+
 	if (cfg.output && output)
 		fclose(output);
 
-	fprintf(stderr, "quotes: %" PRId64  ", trades: %" PRId64 " , max levels: %zu, max orders: %zu\n", quotes, trades, max_price_levels, max_order_count);
-	fprintf(stderr, "volume (mio): %.4lf, notional (mio): %.4lf, VWAP: %.3lf, high: %.3lf, low: %.3lf\n", (double)volume_shs * 1e-6, volume_ccy * 1e-6, (volume_ccy / (double)volume_shs), high, low);
+	for (auto* out : symbol_outputs) {
+		fclose(out->file);
+		delete out;
+	}
+
+	if (column_writer) {
+		err = helix_column_writer_close(column_writer);
+		if (err) {
+			fprintf(stderr, "error: %s: %s\n", cfg.output, helix_strerror(err));
+			die();
+		}
+	}
+
+	if (stats_only) {
+		return 0;
+	}
+
+	symbol_stats total;
+	for (auto&& stats : ts.symbols) {
+		merge_stats(&total, &stats);
+		if (ts.symbols.size() > 1) {
+			fprintf(stderr, "%s: quotes: %" PRId64 ", trades: %" PRId64 ", volume (mio): %.4lf, notional (mio): %.4lf, VWAP: %.3lf, high: %.3lf, low: %.3lf\n",
+				stats.symbol.c_str(), stats.quotes, stats.trades, (double)stats.volume_shs * 1e-6, stats.volume_ccy * 1e-6, stats_vwap(&stats), stats.high, stats.low);
+		}
+	}
+	fprintf(stderr, "quotes: %" PRId64  ", trades: %" PRId64 " , max levels: %zu, max orders: %zu\n", total.quotes, total.trades, total.max_price_levels, total.max_order_count);
+	fprintf(stderr, "volume (mio): %.4lf, notional (mio): %.4lf, VWAP: %.3lf, high: %.3lf, low: %.3lf\n", (double)total.volume_shs * 1e-6, total.volume_ccy * 1e-6, stats_vwap(&total), total.high, total.low);
+	double output_sec = std::chrono::duration<double>(output_end - output_start).count();
+	fprintf(stderr, "output (%s): %" PRIu64 " records, %.1f MiB in %.3f s, %.0f records/s, %.1f MiB/s\n",
+		format_inline ? "inline" : "formatter thread",
+		output_records, output_bytes / 1048576.0, output_sec,
+		output_records / output_sec, output_bytes / 1048576.0 / output_sec);
 }
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+
+"""Reader of the columnar binary output format of helix-trace.
+
+A file starts with a header and a descriptor of every column, followed by
+blocks of rows. Every block holds the strings that were interned since the
+previous block and then the values of every column, so a column of a block
+is mapped straight into an array.
+"""
+
+import numpy as np
+import argparse
+
+MAGIC = b'HELIXCOL'
+VERSION = 1
+BLOCK_MAGIC = 0x4b4c4248
+
+EVENT_ORDER_BOOK_UPDATE = 1 << 0
+EVENT_TRADE = 1 << 1
+EVENT_SWEEP = 1 << 2
+
+_file_header = np.dtype([('magic', 'S8'), ('version', '<u4'), ('nr_columns', '<u4'), ('block_rows', '<u4'), ('reserved', '<u4')])
+_column_descriptor = np.dtype([('name', 'S16'), ('width', '<u4'), ('scale', '<u4')])
+_block_header = np.dtype([('magic', '<u4'), ('nr_rows', '<u4'), ('nr_strings', '<u4'), ('strings_len', '<u4')])
+
+def _padded(n):
+    return (n + 7) & ~7
+
+class ColumnFile:
+    """Columns of a file as arrays of raw integer values.
+
+    Columns of a file of one block are views of the mapping; columns of
+    files of several blocks are concatenated from them.
+    """
+
+    def __init__(self, filename):
+        buf = np.memmap(filename, dtype=np.uint8, mode='r')
+        header = np.frombuffer(buf, _file_header, count=1)[0]
+        if header['magic'] != MAGIC or header['version'] != VERSION:
+            raise ValueError('%s: not a Helix column file' % filename)
+        offset = _file_header.itemsize
+        descriptors = np.frombuffer(buf, _column_descriptor, count=header['nr_columns'], offset=offset)
+        offset += descriptors.nbytes
+        self.names = [d['name'].decode() for d in descriptors]
+        self.scales = {d['name'].decode(): int(d['scale']) for d in descriptors}
+        dtypes = [np.dtype('<u%d' % d['width']) for d in descriptors]
+        self.strings = []
+        parts = [[] for _ in descriptors]
+        while offset < len(buf):
+            block = np.frombuffer(buf, _block_header, count=1, offset=offset)[0]
+            if block['magic'] != BLOCK_MAGIC:
+                raise ValueError('%s: corrupt block at offset %d' % (filename, offset))
+            offset += _block_header.itemsize
+            if block['nr_strings']:
+                strings = bytes(buf[offset:offset + block['strings_len']]).split(b'\0')
+                self.strings += [s.decode() for s in strings[:block['nr_strings']]]
+            offset += int(block['strings_len'])
+            nr_rows = int(block['nr_rows'])
+            for i, dtype in enumerate(dtypes):
+                parts[i].append(np.frombuffer(buf, dtype, count=nr_rows, offset=offset))
+                offset += _padded(nr_rows * dtype.itemsize)
+        self.columns = {}
+        for name, dtype, p in zip(self.names, dtypes, parts):
+            if len(p) == 1:
+                self.columns[name] = p[0]
+            elif p:
+                self.columns[name] = np.concatenate(p)
+            else:
+                self.columns[name] = np.empty(0, dtype)
+
+    def __getitem__(self, name):
+        return self.columns[name]
+
+    def __len__(self):
+        return len(self.columns[self.names[0]]) if self.names else 0
+
+    def scaled(self, name, mask=None):
+        """Returns a column as real values, with NaN in rows where @mask is false."""
+        values = self.columns[name] / float(self.scales[name])
+        if mask is not None:
+            values[~mask] = np.nan
+        return values
+
+    def symbols(self):
+        """Returns the symbol of every row."""
+        return np.array(self.strings)[self.columns['Symbol']]
+
+def read(filename):
+    return ColumnFile(filename)
+
+def is_column_file(filename):
+    with open(filename, 'rb') as f:
+        return f.read(len(MAGIC)) == MAGIC
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Print a helix-trace binary output file as CSV.')
+    parser.add_argument("input", help="input filename")
+    args = parser.parse_args()
+
+    data = read(args.input)
+    event = data['Event']
+    quote = (event & EVENT_ORDER_BOOK_UPDATE) != 0
+    trade = (event & EVENT_TRADE) != 0
+    print(','.join(data.names))
+
+    def field(name, i):
+        scale = data.scales[name]
+        return '%f' % (data[name][i] / scale) if scale > 1 else str(data[name][i])
+
+    for i in range(len(data)):
+        fields = [data.strings[data['Symbol'][i]], str(data['Timestamp'][i])]
+        fields += [field(name, i) if quote[i] else '' for name in ['BidPrice', 'BidSize', 'AskPrice', 'AskSize']]
+        fields += [field(name, i) if trade[i] else '' for name in ['LastPrice', 'LastSize']]
+        fields.append(chr(data['LastSign'][i]) if trade[i] else '')
+        fields.append(field('VWAP', i) if trade[i] else '')
+        fields.append(str(event[i]))
+        print(','.join(fields))
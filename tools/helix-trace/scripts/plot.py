@@ -3,16 +3,33 @@
 import matplotlib.pyplot as plt
 import numpy as np
 import argparse
+import helix_columns
 
 def fill_missing(data):
     mask = np.isnan(data)
     data[mask] = np.interp(np.flatnonzero(mask), np.flatnonzero(~mask), data[~mask])
 
 parser = argparse.ArgumentParser()
-parser.add_argument("input", help="input filename")
+parser.add_argument("input", help="input filename, in CSV or binary format")
 args = parser.parse_args()
 
-data = np.genfromtxt(args.input, delimiter=',', names=True)
+def read_columns(filename):
+    columns = helix_columns.read(filename)
+    event = columns['Event']
+    quote = (event & helix_columns.EVENT_ORDER_BOOK_UPDATE) != 0
+    trade = (event & helix_columns.EVENT_TRADE) != 0
+    return {
+        'Timestamp': columns['Timestamp'].astype(np.float64),
+        'LastPrice': columns.scaled('LastPrice', trade),
+        'VWAP':      columns.scaled('VWAP', trade),
+        'BidPrice':  columns.scaled('BidPrice', quote),
+        'AskPrice':  columns.scaled('AskPrice', quote),
+    }
+
+if helix_columns.is_column_file(args.input):
+    data = read_columns(args.input)
+else:
+    data = np.genfromtxt(args.input, delimiter=',', names=True)
 fig = plt.figure()
 ax = fig.add_subplot(111)
 